@@ -73,6 +73,12 @@ public:
 	virtual void SetAmbientStreamVolume(int stream, int volume) = 0;
 	virtual void QueueBuffer(int stream, unsigned short bits,
 				int channels, short* memory, int size, int samplerate) = 0;
+	/** called once per frame, for the work the driver does in the background */
+	virtual void Update() { }
+	/** loads the sound ahead of its first use, if the driver caches sounds */
+	virtual void Preload(const char* /*ResRef*/) { }
+	/** prints the statistics of the sound cache */
+	virtual void PrintStats() { }
 
 protected:
 	AmbientMgr* ambim;
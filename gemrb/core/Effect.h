@@ -27,10 +27,13 @@
 #ifndef EFFECT_H
 #define EFFECT_H
 
+#include "exports.h"
 #include "ie_types.h"
 
 #include "Region.h"
 
+#include <cstddef>
+
 class Actor;
 
 //local variables in creatures are stored in fake opcodes
@@ -78,7 +81,7 @@ class Actor;
  */
 
 // the same as ITMFeature and SPLFeature
-struct Effect {
+struct GEM_EXPORT Effect {
 	ieDword Opcode;
 	ieDword Target;
 	ieDword Power;
@@ -131,6 +134,9 @@ public:
 			PosY=p.y;
 		}
 	}
+	// allocated from a slab (see EffectQueue.cpp), arrays still use the heap
+	static void* operator new(size_t size);
+	static void operator delete(void* fx, size_t size);
 };
 
 // FIXME: what about area spells? They can have map & coordinates as target
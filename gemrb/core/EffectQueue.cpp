@@ -28,6 +28,8 @@
 #include "SymbolMgr.h"
 #include "Scriptable/Actor.h"
 #include "Spell.h"  //needs for the source flags bitfield
+#include "System/Profiler.h"
+#include "System/SlabAllocator.h"
 
 #include <cstdio>
 
@@ -43,6 +45,18 @@ static EffectDesc *effectnames = NULL;
 static int effectnames_count = 0;
 static int pstflags = false;
 
+static SlabAllocator effectSlab("Effect", sizeof(Effect), PROFILE_ALLOC_EFFECTS);
+
+void* Effect::operator new(size_t size)
+{
+	return effectSlab.Alloc(size);
+}
+
+void Effect::operator delete(void* fx, size_t size)
+{
+	effectSlab.Free(fx, size);
+}
+
 bool EffectQueue::match_ids(Actor *target, int table, ieDword value)
 {
 	if( value == 0) {
@@ -290,6 +304,10 @@ void EffectQueue_RegisterOpcodes(int count, const EffectDesc* opcodes)
 EffectQueue::EffectQueue()
 {
 	Owner = NULL;
+	version = 1;
+	stableVersion = 0;
+	stableUntil = 0;
+	memset( byOpcode, 0, sizeof( byOpcode ) );
 }
 
 EffectQueue::~EffectQueue()
@@ -299,6 +317,9 @@ EffectQueue::~EffectQueue()
 	for ( f = effects.begin(); f != effects.end(); f++ ) {
 		delete (*f);
 	}
+	for (int i = 0; i < MAX_EFFECTS; i++) {
+		delete byOpcode[i];
+	}
 }
 
 Effect *EffectQueue::CreateEffect(ieDword opcode, ieDword param1, ieDword param2, ieWord timing)
@@ -431,6 +452,91 @@ void EffectQueue::AddEffect(Effect* fx, bool insert)
 	} else {
 		effects.push_back( new_fx );
 	}
+	IndexEffect(new_fx, insert);
+	version++;
+}
+
+//the opcode index keeps the order of the effect list
+void EffectQueue::IndexEffect(Effect *fx, bool insert)
+{
+	if( fx->Opcode>=MAX_EFFECTS) {
+		return;
+	}
+	std::vector< Effect* > *list = byOpcode[fx->Opcode];
+	if( !list) {
+		list = byOpcode[fx->Opcode] = new std::vector< Effect* >();
+	}
+	if( insert) {
+		list->insert( list->begin(), fx );
+	} else {
+		list->push_back( fx );
+	}
+}
+
+//removes the effect from the index of the given opcode
+bool EffectQueue::UnindexEffect(Effect *fx, ieDword opcode) const
+{
+	if( opcode>=MAX_EFFECTS || !byOpcode[opcode]) {
+		return false;
+	}
+	std::vector< Effect* > *list = byOpcode[opcode];
+	std::vector< Effect* >::iterator f;
+	for ( f = list->begin(); f != list->end(); f++ ) {
+		if( *f==fx) {
+			list->erase( f );
+			return true;
+		}
+	}
+	return false;
+}
+
+void EffectQueue::UnindexEffect(Effect *fx) const
+{
+	if( UnindexEffect(fx, fx->Opcode)) {
+		return;
+	}
+	//the opcode changed behind our back, don't leave a dangling pointer
+	for (ieDword i = 0; i < MAX_EFFECTS; i++) {
+		if( UnindexEffect(fx, i)) {
+			return;
+		}
+	}
+}
+
+//moves an effect which turned into another opcode (eg. powerword stun)
+void EffectQueue::ReindexEffect(Effect *fx, ieDword opcode) const
+{
+	//not one of ours
+	if( !UnindexEffect(fx, opcode)) {
+		return;
+	}
+	version++;
+	if( fx->Opcode>=MAX_EFFECTS) {
+		return;
+	}
+	std::vector< Effect* > *list = byOpcode[fx->Opcode];
+	if( !list) {
+		list = byOpcode[fx->Opcode] = new std::vector< Effect* >();
+	}
+	//rebuilt to keep the order of the effect list
+	list->clear();
+	std::list< Effect* >::const_iterator f;
+	for ( f = effects.begin(); f != effects.end(); f++ ) {
+		if( (*f)->Opcode==fx->Opcode) {
+			list->push_back( *f );
+		}
+	}
+}
+
+static const std::vector< Effect* > no_effects;
+
+//the effects with the given opcode, in the order they are applied
+const std::vector< Effect* > &EffectQueue::OpcodeEffects(ieDword opcode) const
+{
+	if( opcode>=MAX_EFFECTS || !byOpcode[opcode]) {
+		return no_effects;
+	}
+	return *byOpcode[opcode];
 }
 
 //This method can remove an effect described by a pointer to it, or
@@ -443,8 +549,10 @@ bool EffectQueue::RemoveEffect(Effect* fx)
 		Effect* fx2 = *f;
 
 		if( (fx==fx2) || !memcmp( fx, fx2, invariant_size)) {
+			UnindexEffect(fx2);
 			delete fx2;
 			effects.erase( f );
+			version++;
 			return true;
 		}
 	}
@@ -453,12 +561,37 @@ bool EffectQueue::RemoveEffect(Effect* fx)
 
 //this is where we reapply all effects when loading a saved game
 //The effects are already in the fxqueue of the target
+//it also notes if the queue has only static effects that didn't change
+//their timing, so the actor can skip the next refresh
 void EffectQueue::ApplyAllEffects(Actor* target) const
 {
+	PROFILE_SCOPE(PROFILE_EFFECTS);
+	bool stable = true;
+	ieDword until = 0xffffffff;
 	std::list< Effect* >::const_iterator f;
 	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		ApplyEffect( target, *f, 0 );
+		Effect *fx = *f;
+		ieDword timing = fx->TimingMode;
+		ApplyEffect( target, fx, 0 );
+		if (!stable) {
+			continue;
+		}
+		if (fx->TimingMode!=timing || fx->Opcode>=MAX_EFFECTS || !(Opcodes[fx->Opcode].Flags&EFFECT_STATIC)) {
+			stable = false;
+			continue;
+		}
+		//these will trigger or expire at their duration
+		if (DelayType(fx->TimingMode&0xff)!=PERMANENT && fx->Duration<until) {
+			until = fx->Duration;
+		}
 	}
+	stableVersion = stable?version:0;
+	stableUntil = until;
+}
+
+bool EffectQueue::IsStable(ieDword gametime) const
+{
+	return stableVersion==version && gametime<stableUntil;
 }
 
 void EffectQueue::Cleanup()
@@ -467,8 +600,10 @@ void EffectQueue::Cleanup()
 
 	for ( f = effects.begin(); f != effects.end(); ) {
 		if( (*f)->TimingMode == FX_DURATION_JUST_EXPIRED) {
+			UnindexEffect(*f);
 			delete *f;
 			effects.erase(f++);
+			version++;
 		} else {
 			f++;
 		}
@@ -1149,7 +1284,11 @@ int EffectQueue::ApplyEffect(Actor* target, Effect* fx, ieDword first_apply, ieD
 			}
 		}
 
+		ieDword opcode = fx->Opcode;
 		res=fn( Owner, target, fx );
+		if( fx->Opcode!=opcode) {
+			ReindexEffect(fx, opcode);
+		}
 
 		//if there is no owner, we assume it is the target
 		switch( res ) {
@@ -1186,9 +1325,7 @@ int EffectQueue::ApplyEffect(Actor* target, Effect* fx, ieDword first_apply, ieD
 	return res;
 }
 
-// looks for opcode with param2
-
-#define MATCH_OPCODE() if((*f)->Opcode!=opcode) { continue; }
+// the opcode is matched by walking only the effects of that opcode
 
 // useful for: remove equipped item
 #define MATCH_SLOTCODE() if((*f)->InventorySlot!=slotcode) { continue; }
@@ -1210,16 +1347,23 @@ inline bool IsLive(ieByte timingmode)
 #define MATCH_SOURCE() if( strnicmp( (*f)->Source, Removed, 8) ) { continue; }
 #define MATCH_TIMING() if( (*f)->TimingMode!=timing) { continue; }
 
+//marks an effect for removal (by Cleanup)
+void EffectQueue::ExpireEffect(Effect *fx) const
+{
+	fx->TimingMode = FX_DURATION_JUST_EXPIRED;
+	version++;
+}
+
 //call this from an applied effect, after it returns, these effects
 //will be killed along with it
 void EffectQueue::RemoveAllEffects(ieDword opcode) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const std::vector< Effect* > &list = OpcodeEffects(opcode);
+	std::vector< Effect* >::const_iterator f;
+	for ( f = list.begin(); f != list.end(); f++ ) {
 		MATCH_LIVE_FX();
 
-		(*f)->TimingMode = FX_DURATION_JUST_EXPIRED;
+		ExpireEffect(*f);
 	}
 }
 
@@ -1231,7 +1375,7 @@ void EffectQueue::RemoveEquippingEffects(ieDwordSigned slotcode) const
 		if( !IsEquipped((*f)->TimingMode)) continue;
 		MATCH_SLOTCODE();
 
-		(*f)->TimingMode = FX_DURATION_JUST_EXPIRED;
+		ExpireEffect(*f);
 	}
 }
 
@@ -1242,7 +1386,7 @@ void EffectQueue::RemoveAllEffectsWithProjectile(ieDword projectile) const
 	for ( f = effects.begin(); f != effects.end(); f++ ) {
 		MATCH_PROJECTILE();
 
-		(*f)->TimingMode = FX_DURATION_JUST_EXPIRED;
+		ExpireEffect(*f);
 	}
 }
 
@@ -1254,7 +1398,7 @@ void EffectQueue::RemoveAllEffects(const ieResRef Removed) const
 		MATCH_LIVE_FX();
 		MATCH_SOURCE();
 
-		(*f)->TimingMode = FX_DURATION_JUST_EXPIRED;
+		ExpireEffect(*f);
 	}
 }
 
@@ -1266,7 +1410,7 @@ void EffectQueue::RemoveAllEffects(const ieResRef Removed, ieByte timing) const
 		MATCH_TIMING();
 		MATCH_SOURCE();
 
-		(*f)->TimingMode = FX_DURATION_JUST_EXPIRED;
+		ExpireEffect(*f);
 	}
 }
 
@@ -1283,13 +1427,13 @@ void EffectQueue::RemoveAllEffects(EffectRef &effect_reference) const
 //Removes all effects with a matching resource field
 void EffectQueue::RemoveAllEffectsWithResource(ieDword opcode, const ieResRef resource) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const std::vector< Effect* > &list = OpcodeEffects(opcode);
+	std::vector< Effect* >::const_iterator f;
+	for ( f = list.begin(); f != list.end(); f++ ) {
 		MATCH_LIVE_FX();
 		MATCH_RESOURCE();
 
-		(*f)->TimingMode = FX_DURATION_JUST_EXPIRED;
+		ExpireEffect(*f);
 	}
 }
 
@@ -1303,9 +1447,9 @@ void EffectQueue::RemoveAllEffectsWithResource(EffectRef &effect_reference, cons
 //(works only if a higher stat means good for the target)
 void EffectQueue::RemoveAllDetrimentalEffects(ieDword opcode, ieDword current) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const std::vector< Effect* > &list = OpcodeEffects(opcode);
+	std::vector< Effect* >::const_iterator f;
+	for ( f = list.begin(); f != list.end(); f++ ) {
 		MATCH_LIVE_FX();
 		switch((*f)->Parameter2) {
 		case 0:case 3:
@@ -1320,7 +1464,7 @@ void EffectQueue::RemoveAllDetrimentalEffects(ieDword opcode, ieDword current) c
 		default:
 			break;
 		}
-		(*f)->TimingMode = FX_DURATION_JUST_EXPIRED;
+		ExpireEffect(*f);
 	}
 }
 
@@ -1330,13 +1474,13 @@ void EffectQueue::RemoveAllDetrimentalEffects(ieDword opcode, ieDword current) c
 //opcode need to be removed (see removal of portrait icon)
 void EffectQueue::RemoveAllEffectsWithParam(ieDword opcode, ieDword param2) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const std::vector< Effect* > &list = OpcodeEffects(opcode);
+	std::vector< Effect* >::const_iterator f;
+	for ( f = list.begin(); f != list.end(); f++ ) {
 		MATCH_LIVE_FX();
 		MATCH_PARAM2();
 
-		(*f)->TimingMode = FX_DURATION_JUST_EXPIRED;
+		ExpireEffect(*f);
 	}
 }
 
@@ -1357,7 +1501,7 @@ void EffectQueue::RemoveExpiredEffects(ieDword futuretime) const
 		//it should remove them as well, i think
 		if( DelayType( ((*f)->TimingMode) )!=PERMANENT ) {
 			if( (*f)->Duration<=GameTime) {
-				(*f)->TimingMode = FX_DURATION_JUST_EXPIRED;
+				ExpireEffect(*f);
 			}
 		}
 	}
@@ -1370,7 +1514,7 @@ void EffectQueue::RemoveAllNonPermanentEffects() const
 	std::list< Effect* >::const_iterator f;
 	for ( f = effects.begin(); f != effects.end(); f++ ) {
 		if( IsRemovable((*f)->TimingMode) ) {
-			(*f)->TimingMode = FX_DURATION_JUST_EXPIRED;
+			ExpireEffect(*f);
 		}
 	}
 }
@@ -1421,7 +1565,7 @@ void EffectQueue::RemoveLevelEffects(ieResRef &Removed, ieDword level, ieDword F
 				continue;
 			}
 		}
-		(*f)->TimingMode = FX_DURATION_JUST_EXPIRED;
+		ExpireEffect(*f);
 		if( Flags&RL_REMOVEFIRST) {
 			memcpy(Removed,(*f)->Source, sizeof(Removed));
 		}
@@ -1430,9 +1574,9 @@ void EffectQueue::RemoveLevelEffects(ieResRef &Removed, ieDword level, ieDword F
 
 Effect *EffectQueue::HasOpcode(ieDword opcode) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const std::vector< Effect* > &list = OpcodeEffects(opcode);
+	std::vector< Effect* >::const_iterator f;
+	for ( f = list.begin(); f != list.end(); f++ ) {
 		MATCH_LIVE_FX();
 
 		return (*f);
@@ -1451,9 +1595,9 @@ Effect *EffectQueue::HasEffect(EffectRef &effect_reference) const
 
 Effect *EffectQueue::HasOpcodeWithParam(ieDword opcode, ieDword param2) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const std::vector< Effect* > &list = OpcodeEffects(opcode);
+	std::vector< Effect* >::const_iterator f;
+	for ( f = list.begin(); f != list.end(); f++ ) {
 		MATCH_LIVE_FX();
 		MATCH_PARAM2();
 
@@ -1476,9 +1620,9 @@ Effect *EffectQueue::HasEffectWithParam(EffectRef &effect_reference, ieDword par
 
 Effect *EffectQueue::HasOpcodeWithParamPair(ieDword opcode, ieDword param1, ieDword param2) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const std::vector< Effect* > &list = OpcodeEffects(opcode);
+	std::vector< Effect* >::const_iterator f;
+	for ( f = list.begin(); f != list.end(); f++ ) {
 		MATCH_LIVE_FX();
 		MATCH_PARAM2();
 		//0 is always accepted as first parameter
@@ -1504,9 +1648,9 @@ Effect *EffectQueue::HasEffectWithParamPair(EffectRef &effect_reference, ieDword
 int EffectQueue::SpecificDamageBonus(ieDword opcode, ieDword param2) const
 {
 	int bonus = 0;
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const std::vector< Effect* > &list = OpcodeEffects(opcode);
+	std::vector< Effect* >::const_iterator f;
+	for ( f = list.begin(); f != list.end(); f++ ) {
 		MATCH_LIVE_FX();
 		MATCH_PARAM2();
 		bonus += (signed) (*f)->Parameter1;
@@ -1527,14 +1671,15 @@ int EffectQueue::SpecificDamageBonus(ieDword damage_type) const
 //this could be used for stoneskins and mirror images as well
 void EffectQueue::DecreaseParam1OfEffect(ieDword opcode, ieDword amount) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const std::vector< Effect* > &list = OpcodeEffects(opcode);
+	std::vector< Effect* >::const_iterator f;
+	for ( f = list.begin(); f != list.end(); f++ ) {
 		MATCH_LIVE_FX();
 		ieDword value = (*f)->Parameter1;
 		if( value>amount) value-=amount;
 		else value = 0;
 		(*f)->Parameter1=value;
+		version++;
 	}
 }
 
@@ -1554,9 +1699,9 @@ static const int ids_stats[7]={IE_EA, IE_GENERAL, IE_RACE, IE_CLASS, IE_SPECIFIC
 int EffectQueue::BonusAgainstCreature(ieDword opcode, Actor *actor) const
 {
 	int sum = 0;
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const std::vector< Effect* > &list = OpcodeEffects(opcode);
+	std::vector< Effect* >::const_iterator f;
+	for ( f = list.begin(); f != list.end(); f++ ) {
 		MATCH_LIVE_FX();
 		if( (*f)->Parameter1) {
 			ieDword ids = (*f)->Parameter2;
@@ -1584,9 +1729,9 @@ int EffectQueue::BonusAgainstCreature(EffectRef &effect_reference, Actor *actor)
 
 bool EffectQueue::WeaponImmunity(ieDword opcode, int enchantment, ieDword weapontype) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const std::vector< Effect* > &list = OpcodeEffects(opcode);
+	std::vector< Effect* >::const_iterator f;
+	for ( f = list.begin(); f != list.end(); f++ ) {
 		MATCH_LIVE_FX();
 		//
 		int magic = (int) (*f)->Parameter1;
@@ -1627,9 +1772,9 @@ void EffectQueue::AddWeaponEffects(EffectQueue *fxqueue, EffectRef &fx_ref) cons
 	ieDword opcode = fx_ref.opcode;
 	Point p(-1,-1);
 
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const std::vector< Effect* > &list = OpcodeEffects(opcode);
+	std::vector< Effect* >::const_iterator f;
+	for ( f = list.begin(); f != list.end(); f++ ) {
 		MATCH_LIVE_FX();
 		//
 		Effect *fx = core->GetEffect( (*f)->Resource, (*f)->Power, p);
@@ -1651,9 +1796,9 @@ int EffectQueue::DisabledSpellcasting(int types) const
 	unsigned int spelltype_mask = 0;
 	bool iwd2 = !!core->HasFeature(GF_ENHANCED_EFFECTS);
 	ieDword opcode = fx_disable_spellcasting_ref.opcode;
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const std::vector< Effect* > &list = OpcodeEffects(opcode);
+	std::vector< Effect* >::const_iterator f;
+	for ( f = list.begin(); f != list.end(); f++ ) {
 		MATCH_LIVE_FX();
 
 		if (iwd2) {
@@ -1695,9 +1840,9 @@ int EffectQueue::DisabledSpellcasting(int types) const
 //useful for immunity vs spell, can't use item, etc.
 Effect *EffectQueue::HasOpcodeWithResource(ieDword opcode, const ieResRef resource) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const std::vector< Effect* > &list = OpcodeEffects(opcode);
+	std::vector< Effect* >::const_iterator f;
+	for ( f = list.begin(); f != list.end(); f++ ) {
 		MATCH_LIVE_FX();
 		MATCH_RESOURCE();
 
@@ -1715,9 +1860,9 @@ Effect *EffectQueue::HasEffectWithResource(EffectRef &effect_reference, const ie
 //used in contingency/sequencer code (cannot have the same contingency twice)
 Effect *EffectQueue::HasOpcodeWithSource(ieDword opcode, const ieResRef Removed) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const std::vector< Effect* > &list = OpcodeEffects(opcode);
+	std::vector< Effect* >::const_iterator f;
+	for ( f = list.begin(); f != list.end(); f++ ) {
 		MATCH_LIVE_FX();
 		MATCH_SOURCE();
 
@@ -1833,8 +1978,10 @@ const Effect *EffectQueue::GetNextSavedEffect(std::list< Effect* >::const_iterat
 	return NULL;
 }
 
+//the caller may change the effect
 Effect *EffectQueue::GetNextEffect(std::list< Effect* >::const_iterator &f) const
 {
+	version++;
 	if( f!=effects.end()) return *f++;
 	return NULL;
 }
@@ -1843,10 +1990,10 @@ ieDword EffectQueue::CountEffects(ieDword opcode, ieDword param1, ieDword param2
 {
 	ieDword cnt = 0;
 
-	std::list< Effect* >::const_iterator f;
+	const std::vector< Effect* > &list = OpcodeEffects(opcode);
+	std::vector< Effect* >::const_iterator f;
 
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	for ( f = list.begin(); f != list.end(); f++ ) {
 		if( param1!=0xffffffff)
 			MATCH_PARAM1();
 		if( param2!=0xffffffff)
@@ -1861,13 +2008,14 @@ ieDword EffectQueue::CountEffects(ieDword opcode, ieDword param1, ieDword param2
 
 void EffectQueue::ModifyEffectPoint(ieDword opcode, ieDword x, ieDword y) const
 {
-	std::list< Effect* >::const_iterator f;
+	const std::vector< Effect* > &list = OpcodeEffects(opcode);
+	std::vector< Effect* >::const_iterator f;
 
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	for ( f = list.begin(); f != list.end(); f++ ) {
 		(*f)->PosX=x;
 		(*f)->PosY=y;
 		(*f)->Parameter3=0;
+		version++;
 		return;
 	}
 }
@@ -35,6 +35,7 @@
 
 #include <cstdlib>
 #include <list>
+#include <vector>
 
 class Actor;
 class Map;
@@ -157,7 +158,9 @@ enum EffectFlags {
 	EFFECT_NORMAL = 0,
 	EFFECT_DICED = 1,
 	EFFECT_NO_LEVEL_CHECK = 2,
-	EFFECT_NO_ACTOR = 4
+	EFFECT_NO_ACTOR = 4,
+	//only modifies stats, the same way every time it is applied
+	EFFECT_STATIC = 8
 };
 
 /** Initializes table of available spell Effects used by all the queues. */
@@ -182,8 +185,17 @@ class GEM_EXPORT EffectQueue {
 private:
 	/** List of Effects applied on the Actor */
 	std::list< Effect* > effects;
+	/** The same effects by opcode, in the same order (allocated on demand),
+	 * some effects change their opcode when they are applied */
+	mutable std::vector< Effect* > *byOpcode[MAX_EFFECTS];
 	/** Actor which is target of the Effects */
 	Scriptable* Owner;
+	/** Increased whenever an effect is added, removed or changed */
+	mutable ieDword version;
+	/** The version at which ApplyAllEffects found only static effects */
+	mutable ieDword stableVersion;
+	/** Game time at which the first of those effects expires or triggers */
+	mutable ieDword stableUntil;
 
 public:
 	EffectQueue();
@@ -208,6 +220,10 @@ public:
 
 	int AddAllEffects(Actor* target, const Point &dest) const;
 	void ApplyAllEffects(Actor* target) const;
+	/** returns true if reapplying the effects would give the same stats
+	 * as the last ApplyAllEffects, until the queue changes */
+	bool IsStable(ieDword gametime) const;
+	ieDword GetVersion() const { return version; }
 	/** remove effects marked for removal */
 	void Cleanup();
 
@@ -298,6 +314,12 @@ private:
 	//use the effect reference style calls from outside
 	static Effect *CreateEffect(ieDword opcode, ieDword param1, ieDword param2, ieWord timing);
 	static Effect *CreateEffectCopy(Effect *oldfx, ieDword opcode, ieDword param1, ieDword param2);
+	void ExpireEffect(Effect *fx) const;
+	const std::vector< Effect* > &OpcodeEffects(ieDword opcode) const;
+	void IndexEffect(Effect *fx, bool insert);
+	void UnindexEffect(Effect *fx) const;
+	bool UnindexEffect(Effect *fx, ieDword opcode) const;
+	void ReindexEffect(Effect *fx, ieDword opcode) const;
 	void RemoveAllDetrimentalEffects(ieDword opcode, ieDword current) const;
 	void RemoveAllEffectsWithParam(ieDword opcode, ieDword param2) const;
 	Effect *HasOpcode(ieDword opcode) const;
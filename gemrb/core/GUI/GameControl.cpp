@@ -83,6 +83,10 @@ static const Color gray = {
 //Animation* effect;
 
 #define FORMATIONSIZE 10
+
+//the scrolling speed is in pixels per this many ms (the old fixed frame
+//length), so it doesn't depend on the frame rate
+#define SCROLL_FRAME 33
 typedef Point formation_type[FORMATIONSIZE];
 ieDword formationcount;
 static formation_type *formations=NULL;
@@ -131,6 +135,8 @@ GameControl::GameControl(void)
 	pfs.null();
 	lastCursor = IE_CURSOR_NORMAL;
 	moveX = moveY = 0;
+	scrollX = scrollY = 0;
+	lastDrawTime = 0;
 	scrolling = false;
 #ifdef TOUCHSCREEN
 	touched=false;
@@ -387,10 +393,23 @@ void GameControl::Draw(unsigned short x, unsigned short y)
 		return;
 	}
 
+	unsigned long time, elapsed;
+	GetTime( time );
+	elapsed = time - lastDrawTime;
+	//first frame or after a long pause: move a single step
+	if (!lastDrawTime || elapsed > 4*SCROLL_FRAME) {
+		elapsed = SCROLL_FRAME;
+	}
+	lastDrawTime = time;
+
 	Region viewport = video->GetViewport();
 	if (moveX || moveY) {
-		viewport.x += moveX;
-		viewport.y += moveY;
+		scrollX += moveX * (int) elapsed;
+		scrollY += moveY * (int) elapsed;
+		viewport.x += scrollX / SCROLL_FRAME;
+		viewport.y += scrollY / SCROLL_FRAME;
+		scrollX %= SCROLL_FRAME;
+		scrollY %= SCROLL_FRAME;
 		Point mapsize = area->TMap->GetMapSize();
 		if ( viewport.x < 0 )//if we are at top of the map
 			viewport.x = 0;
@@ -406,6 +425,8 @@ void GameControl::Draw(unsigned short x, unsigned short y)
 		core->timer->SetMoveViewPort( viewport.x, viewport.y, 0, false );
 		// move it directly ourselves, since we might be paused
 		video->MoveViewportTo( viewport.x, viewport.y );
+	} else {
+		scrollX = scrollY = 0;
 	}
 	video->DrawRect( screen, black, true );
 
@@ -1317,6 +1338,10 @@ void GameControl::OnMouseOver(unsigned short x, unsigned short y)
 	if (overInfoPoint) {
 		//nextCursor = overInfoPoint->Cursor;
 		nextCursor = GetCursorOverInfoPoint(overInfoPoint);
+		//the player is likely to go there, start loading it
+		if (overInfoPoint->Type == ST_TRAVEL && overInfoPoint->Destination[0]) {
+			gamedata->PrefetchArea(overInfoPoint->Destination);
+		}
 	}
 
 	if (overDoor) {
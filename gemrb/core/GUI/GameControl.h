@@ -128,6 +128,9 @@ private:
 	int target_mode;
 	unsigned char lastCursor;
 	short moveX, moveY;
+	//moveX/moveY are per SCROLL_FRAME, the remainders carry over
+	int scrollX, scrollY;
+	unsigned long lastDrawTime;
 	int numScrollCursor;
 	bool scrolling;
 	unsigned short lastMouseX, lastMouseY;
@@ -789,6 +789,9 @@ int Game::LoadMap(const char* ResRef, bool loadscreen)
 			newMap->AddActor( NPCs[i] );
 		}
 	}
+	if (core->PreloadSounds) {
+		newMap->PreloadSounds();
+	}
 	if (hide) {
 		core->UnhideGCWindow();
 	}
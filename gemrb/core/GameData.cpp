@@ -68,6 +68,7 @@ GEM_EXPORT GameData* gamedata;
 GameData::GameData()
 {
 	factory = new Factory();
+	prefetchedArea[0] = 0;
 }
 
 GameData::~GameData()
@@ -484,3 +485,69 @@ void* GameData::GetFactoryResource(const char* resname, SClass_ID type,
 		return NULL;
 	}
 }
+
+void GameData::PrefetchArea(const ieResRef area)
+{
+	//this is called every time a travel region is hovered
+	if (!strnicmp(prefetchedArea, area, 8)) {
+		return;
+	}
+	strnlwrcpy(prefetchedArea, area, 8);
+
+	Game *game = core->GetGame();
+	if (game && game->FindMap(area) >= 0) {
+		return;
+	}
+
+	DataStream *str = GetResource(area, IE_ARE_CLASS_ID, true);
+	if (!str) {
+		return;
+	}
+	char Signature[8];
+	ieResRef WEDResRef;
+	ieDword ActorOffset;
+	ieWord ActorCount;
+	int bigheader = 0;
+
+	str->Read( Signature, 8 );
+	if (strncmp( Signature, "AREAV9.1", 8 ) == 0) {
+		bigheader = 16;
+	} else if (strncmp( Signature, "AREAV1.0", 8 ) != 0) {
+		delete str;
+		return;
+	}
+	str->ReadResRef( WEDResRef );
+	str->Seek( 0x54 + bigheader, GEM_STREAM_START );
+	str->ReadDword( &ActorOffset );
+	str->ReadWord( &ActorCount );
+
+	std::vector<std::string> creatures;
+	for (unsigned int i = 0; i < ActorCount; i++) {
+		ieResRef CreResRef;
+		ieDword CreSize;
+		str->Seek( ActorOffset + i * 0x110 + 0x80, GEM_STREAM_START );
+		str->ReadResRef( CreResRef );
+		str->Seek( 4, GEM_CURRENT_POS );
+		str->ReadDword( &CreSize );
+		//embedded creatures come with the area
+		if (!CreSize && CreResRef[0]) {
+			creatures.push_back(CreResRef);
+		}
+	}
+	delete str;
+
+	//the same order as AREImporter loads them
+	Prefetch(area, IE_ARE_CLASS_ID);
+	Prefetch(WEDResRef, IE_WED_CLASS_ID);
+	Prefetch(WEDResRef, IE_TIS_CLASS_ID);
+	Prefetch(WEDResRef, IE_MOS_CLASS_ID);
+	static const char *bitmaps[] = { "SR", "HT", "LM" };
+	for (unsigned int i = 0; i < sizeof(bitmaps)/sizeof(bitmaps[0]); i++) {
+		ieResRef TmpResRef;
+		snprintf( TmpResRef, 9, "%s%s", WEDResRef, bitmaps[i]);
+		Prefetch(TmpResRef, IE_BMP_CLASS_ID);
+	}
+	for (size_t i = 0; i < creatures.size(); i++) {
+		Prefetch(creatures[i].c_str(), IE_CRE_CLASS_ID);
+	}
+}
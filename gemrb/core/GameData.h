@@ -90,6 +90,9 @@ public:
 	/** returns factory resource, currently works only with animations */
 	void* GetFactoryResource(const char* resname, SClass_ID type,
 		unsigned char mode = IE_NORMAL, bool silent=false);
+
+	/** starts reading the files the area will need in the background */
+	void PrefetchArea(const ieResRef area);
 private:
 	Cache ItemCache;
 	Cache SpellCache;
@@ -97,6 +100,7 @@ private:
 	Cache PaletteCache;
 	Factory* factory;
 	std::vector<Table> tables;
+	ieResRef prefetchedArea;
 };
 
 extern GEM_EXPORT GameData * gamedata;
@@ -1871,197 +1871,144 @@ Trigger *GenerateTriggerCore(const char *src, const char *str, int trIndex, int
 	return newTrigger;
 }
 
-void SetVariable(Scriptable* Sender, const char* VarName, const char* Context, ieDword value)
+//parses the scope of a variable, triggers do it only once
+static void ResolveVariable(const char* Context, ScriptVariable &var)
 {
-	char newVarName[8+33];
-
-	if (InDebug&ID_VARIABLES) {
-		print( "Setting variable(\"%s%s\", %d)\n", Context,
-			VarName, value );
+	strncpy( var.area, Context, 6 );
+	var.area[6]=0;
+	if (strnicmp( var.area, "MYAREA", 6 ) == 0) {
+		var.scope = VAR_MYAREA;
+	} else if (strnicmp( var.area, "LOCALS", 6 ) == 0) {
+		var.scope = VAR_LOCALS;
+	} else if (HasKaputz && !strnicmp(var.area,"KAPUTZ",6) ) {
+		var.scope = VAR_KAPUTZ;
+	} else if (strnicmp(var.area,"GLOBAL",6) ) {
+		var.scope = VAR_AREA;
+	} else {
+		var.scope = VAR_GLOBAL;
 	}
+}
 
-	strncpy( newVarName, Context, 6 );
-	newVarName[6]=0;
-	if (strnicmp( newVarName, "MYAREA", 6 ) == 0) {
-		Sender->GetCurrentArea()->locals->SetAt( VarName, value, NoCreate );
-		return;
-	}
-	if (strnicmp( newVarName, "LOCALS", 6 ) == 0) {
-		Sender->locals->SetAt( VarName, value, NoCreate );
-		return;
+//the scope is in front of the name (some HoW triggers use a : after it)
+static void ResolveMergedVariable(const char* VarName, ScriptVariable &var)
+{
+	ResolveVariable(VarName, var);
+	var.offset = 6;
+	if (VarName[6]==':') {
+		var.offset++;
 	}
+}
+
+static Variables *GetVariables(Scriptable* Sender, const ScriptVariable &var)
+{
 	Game *game = core->GetGame();
-	if (HasKaputz && !strnicmp(newVarName,"KAPUTZ",6) ) {
-		game->kaputz->SetAt( VarName, value );
-		return;
+	switch (var.scope) {
+	case VAR_GLOBAL:
+		return game->locals;
+	case VAR_LOCALS:
+		return Sender->locals;
+	case VAR_MYAREA:
+		return Sender->GetCurrentArea()->locals;
+	case VAR_KAPUTZ:
+		return game->kaputz;
+	default:
+		//areas come and go, so these are always searched
+		Map *map=game->GetMap(game->FindMap(var.area));
+		return map ? map->locals : NULL;
 	}
+}
 
-	if (strnicmp(newVarName,"GLOBAL",6) ) {
-		Map *map=game->GetMap(game->FindMap(newVarName));
-		if (map) {
-			map->locals->SetAt( VarName, value, NoCreate);
-		}
-		else if (InDebug&ID_VARIABLES) {
-			printMessage("GameScript", "Invalid variable %s %s in setvariable\n", YELLOW,
-				Context, VarName);
-		}
+static void SetVariableCore(Scriptable* Sender, const char* VarName, const char* Context, const ScriptVariable &var, ieDword value, bool nocreate)
+{
+	Variables *locals = GetVariables(Sender, var);
+	if (locals) {
+		locals->SetAt( VarName+var.offset, value, nocreate );
 	}
-	else {
-		game->locals->SetAt( VarName, ( ieDword ) value, NoCreate );
+	else if (InDebug&ID_VARIABLES) {
+		printMessage("GameScript", "Invalid variable %s%s in setvariable\n", YELLOW,
+			Context, VarName);
 	}
 }
 
-void SetVariable(Scriptable* Sender, const char* VarName, ieDword value)
+void SetVariable(Scriptable* Sender, const char* VarName, const char* Context, ieDword value)
 {
-	char newVarName[8];
-	const char *poi;
+	ScriptVariable var;
 
-	poi = &VarName[6];
-	//some HoW triggers use a : to separate the scope from the variable name
-	if (*poi==':') {
-		poi++;
+	if (InDebug&ID_VARIABLES) {
+		print( "Setting variable(\"%s%s\", %d)\n", Context,
+			VarName, value );
 	}
+	var.offset = 0;
+	ResolveVariable(Context, var);
+	//the kaputz variables are created on demand
+	SetVariableCore(Sender, VarName, Context, var, value, var.scope!=VAR_KAPUTZ);
+}
+
+void SetVariable(Scriptable* Sender, const char* VarName, ieDword value)
+{
+	ScriptVariable var;
 
 	if (InDebug&ID_VARIABLES) {
 		print( "Setting variable(\"%s\", %d)\n", VarName, value );
 	}
-	strncpy( newVarName, VarName, 6 );
-	newVarName[6]=0;
-	if (strnicmp( newVarName, "MYAREA", 6 ) == 0) {
-		Sender->GetCurrentArea()->locals->SetAt( poi, value, NoCreate );
-		return;
-	}
-	if (strnicmp( newVarName, "LOCALS", 6 ) == 0) {
-		Sender->locals->SetAt( poi, value, NoCreate );
-		return;
-	}
-	Game *game = core->GetGame();
-	if (HasKaputz && !strnicmp(newVarName,"KAPUTZ",6) ) {
-		game->kaputz->SetAt( poi, value, NoCreate );
-		return;
-	}
-	if (strnicmp(newVarName,"GLOBAL",6) ) {
-		Map *map=game->GetMap(game->FindMap(newVarName));
-		if (map) {
-			map->locals->SetAt( poi, value, NoCreate);
-		}
-		else if (InDebug&ID_VARIABLES) {
-			printMessage("GameScript", "Invalid variable %s in setvariable\n", YELLOW,
-				VarName);
-		}
-	}
-	else {
-		game->locals->SetAt( poi, ( ieDword ) value, NoCreate );
-	}
+	ResolveMergedVariable(VarName, var);
+	SetVariableCore(Sender, VarName, "", var, value, NoCreate);
 }
 
-ieDword CheckVariable(Scriptable* Sender, const char* VarName, bool *valid)
+static ieDword CheckVariableCore(Scriptable* Sender, const char* VarName, const char* Context, ScriptVariable &var, bool *valid)
 {
-	char newVarName[8];
-	const char *poi;
 	ieDword value = 0;
 
-	strncpy( newVarName, VarName, 6 );
-	newVarName[6]=0;
-	poi = &VarName[6];
-	//some HoW triggers use a : to separate the scope from the variable name
-	if (*poi==':') {
-		poi++;
-	}
-
-	if (strnicmp( newVarName, "MYAREA", 6 ) == 0) {
-		Sender->GetCurrentArea()->locals->Lookup( poi, value );
-		if (InDebug&ID_VARIABLES) {
-			print("CheckVariable %s: %d\n",VarName, value);
-		}
-		return value;
-	}
-	if (strnicmp( newVarName, "LOCALS", 6 ) == 0) {
-		Sender->locals->Lookup( poi, value );
-		if (InDebug&ID_VARIABLES) {
-			print("CheckVariable %s: %d\n",VarName, value);
+	Variables *locals = GetVariables(Sender, var);
+	if (locals) {
+		locals->Lookup( VarName+var.offset, value, var.handle );
+	} else {
+		if (valid) {
+			*valid=false;
 		}
-		return value;
-	}
-	Game *game = core->GetGame();
-	if (HasKaputz && !strnicmp(newVarName,"KAPUTZ",6) ) {
-		game->kaputz->Lookup( poi, value );
 		if (InDebug&ID_VARIABLES) {
-			print("CheckVariable %s: %d\n",VarName, value);
-		}
-		return value;
-	}
-	if (strnicmp(newVarName,"GLOBAL",6) ) {
-		Map *map=game->GetMap(game->FindMap(newVarName));
-		if (map) {
-			map->locals->Lookup( poi, value);
-		} else {
-			if (valid) {
-				*valid=false;
-			}
-			if (InDebug&ID_VARIABLES) {
-				printMessage("GameScript", "Invalid variable %s in checkvariable\n", YELLOW,
-					VarName);
-			}
+			printMessage("GameScript", "Invalid variable %s%s in checkvariable\n", YELLOW,
+				Context, VarName);
 		}
-	} else {
-		game->locals->Lookup( poi, value );
 	}
 	if (InDebug&ID_VARIABLES) {
-		print("CheckVariable %s: %d\n",VarName, value);
+		print("CheckVariable %s%s: %d\n",Context, VarName, value);
 	}
 	return value;
 }
 
-ieDword CheckVariable(Scriptable* Sender, const char* VarName, const char* Context, bool *valid)
+ieDword CheckVariable(Scriptable* Sender, const char* VarName, ScriptVariable &var, bool *valid)
 {
-	char newVarName[8];
-	ieDword value = 0;
-
-	strncpy(newVarName, Context, 6);
-	newVarName[6]=0;
-	if (strnicmp( newVarName, "MYAREA", 6 ) == 0) {
-		Sender->GetCurrentArea()->locals->Lookup( VarName, value );
-		if (InDebug&ID_VARIABLES) {
-			print("CheckVariable %s%s: %d\n",Context, VarName, value);
-		}
-		return value;
-	}
-	if (strnicmp( newVarName, "LOCALS", 6 ) == 0) {
-		Sender->locals->Lookup( VarName, value );
-		if (InDebug&ID_VARIABLES) {
-			print("CheckVariable %s%s: %d\n",Context, VarName, value);
-		}
-		return value;
-	}
-	Game *game = core->GetGame();
-	if (HasKaputz && !strnicmp(newVarName,"KAPUTZ",6) ) {
-		game->kaputz->Lookup( VarName, value );
-		if (InDebug&ID_VARIABLES) {
-			print("CheckVariable %s%s: %d\n",Context, VarName, value);
-		}
-		return value;
+	if (var.scope == VAR_UNRESOLVED) {
+		ResolveMergedVariable(VarName, var);
 	}
-	if (strnicmp(newVarName,"GLOBAL",6) ) {
-		Map *map=game->GetMap(game->FindMap(newVarName));
-		if (map) {
-			map->locals->Lookup( VarName, value);
-		} else {
-			if (valid) {
-				*valid=false;
-			}
-			if (InDebug&ID_VARIABLES) {
-				printMessage("GameScript", "Invalid variable %s %s in checkvariable\n", YELLOW,
-					Context, VarName);
-			}
-		}
-	} else {
-		game->locals->Lookup( VarName, value );
-	}
-	if (InDebug&ID_VARIABLES) {
-		print("CheckVariable %s%s: %d\n",Context, VarName, value);
+	return CheckVariableCore(Sender, VarName, "", var, valid);
+}
+
+ieDword CheckVariable(Scriptable* Sender, const char* VarName, const char* Context, ScriptVariable &var, bool *valid)
+{
+	if (var.scope == VAR_UNRESOLVED) {
+		var.offset = 0;
+		ResolveVariable(Context, var);
 	}
-	return value;
+	return CheckVariableCore(Sender, VarName, Context, var, valid);
+}
+
+//without a trigger the variable is resolved every time
+ieDword CheckVariable(Scriptable* Sender, const char* VarName, bool *valid)
+{
+	ScriptVariable var;
+
+	memset( &var, 0, sizeof( var ) );
+	return CheckVariable(Sender, VarName, var, valid);
+}
+
+ieDword CheckVariable(Scriptable* Sender, const char* VarName, const char* Context, bool *valid)
+{
+	ScriptVariable var;
+
+	memset( &var, 0, sizeof( var ) );
+	return CheckVariable(Sender, VarName, Context, var, valid);
 }
 
 int DiffCore(ieDword a, ieDword b, int diffmode)
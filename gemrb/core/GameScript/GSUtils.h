@@ -34,6 +34,7 @@
 #define ID_VARIABLES 4
 #define ID_ACTIONS   8
 #define ID_TRIGGERS  16
+#define ID_COMPILED  32
 
 extern Holder<SymbolMgr> triggersTable;
 extern Holder<SymbolMgr> actionsTable;
@@ -125,6 +126,9 @@ GEM_EXPORT void SetVariable(Scriptable* Sender, const char* VarName, const char*
 GEM_EXPORT void MoveBetweenAreasCore(Actor* actor, const char *area, const Point &position, int face, bool adjust);
 GEM_EXPORT ieDword CheckVariable(Scriptable* Sender, const char* VarName, bool *valid = NULL);
 GEM_EXPORT ieDword CheckVariable(Scriptable* Sender, const char* VarName, const char* Context, bool *valid = NULL);
+//the same for trigger parameters, remembering the variable
+ieDword CheckVariable(Scriptable* Sender, const char* VarName, ScriptVariable &var, bool *valid = NULL);
+ieDword CheckVariable(Scriptable* Sender, const char* VarName, const char* Context, ScriptVariable &var, bool *valid = NULL);
 Action* GenerateActionCore(const char *src, const char *str, unsigned short actionID);
 Trigger *GenerateTriggerCore(const char *src, const char *str, int trIndex, int negate);
 unsigned int GetSpellDistance(const ieResRef spellres, Scriptable *Sender);
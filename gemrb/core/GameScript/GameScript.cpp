@@ -29,6 +29,8 @@
 #include "GameData.h"
 #include "Interface.h"
 #include "PluginMgr.h"
+#include "System/Profiler.h"
+#include "System/SlabAllocator.h"
 
 //debug flags
 // 1 - cache
@@ -36,6 +38,7 @@
 // 4 - globals
 // 8 - action execution
 //16 - trigger evaluation
+//32 - compare the compiled conditions with the original ones (except TF_VOLATILE)
 
 //Make this an ordered list, so we could use bsearch!
 static const TriggerLink triggernames[] = {
@@ -54,7 +57,7 @@ static const TriggerLink triggernames[] = {
 	{"areatype", GameScript::AreaType, 0},
 	{"atlocation", GameScript::AtLocation, 0},
 	{"assaltedby", GameScript::AttackedBy, 0},//pst
-	{"attackedby", GameScript::AttackedBy, 0},
+	{"attackedby", GameScript::AttackedBy, TF_VOLATILE},
 	{"becamevisible", GameScript::BecameVisible, 0},
 	{"bitcheck", GameScript::BitCheck,TF_MERGESTRINGS},
 	{"bitcheckexact", GameScript::BitCheckExact,TF_MERGESTRINGS},
@@ -119,7 +122,7 @@ static const TriggerLink triggernames[] = {
 	{"fallenpaladin", GameScript::FallenPaladin, 0},
 	{"fallenranger", GameScript::FallenRanger, 0},
 	{"false", GameScript::False, 0},
-	{"forcemarkedspell", GameScript::ForceMarkedSpell_Trigger, 0},
+	{"forcemarkedspell", GameScript::ForceMarkedSpell_Trigger, TF_VOLATILE},
 	{"frame", GameScript::Frame, 0},
 	{"g", GameScript::G_Trigger, 0},
 	{"gender", GameScript::Gender, 0},
@@ -224,12 +227,12 @@ static const TriggerLink triggernames[] = {
 	{"isweaponranged", GameScript::IsWeaponRanged, 0},
 	{"isweather", GameScript::IsWeather, 0}, //gemrb extension
 	{"itemisidentified", GameScript::ItemIsIdentified, 0},
-	{"joins", GameScript::Joins, 0},
+	{"joins", GameScript::Joins, TF_VOLATILE},
 	{"kit", GameScript::Kit, 0},
 	{"knowspell", GameScript::KnowSpell, 0}, //gemrb specific
 	{"lastmarkedobject", GameScript::LastMarkedObject_Trigger, 0},
 	{"lastpersontalkedto", GameScript::LastPersonTalkedTo, 0}, //pst
-	{"leaves", GameScript::Leaves, 0},
+	{"leaves", GameScript::Leaves, TF_VOLATILE},
 	{"level", GameScript::Level, 0},
 	{"levelgt", GameScript::LevelGT, 0},
 	{"levelinclass", GameScript::LevelInClass, 0}, //iwd2
@@ -328,7 +331,7 @@ static const TriggerLink triggernames[] = {
 	{"randomnum", GameScript::RandomNum, 0},
 	{"randomnumgt", GameScript::RandomNumGT, 0},
 	{"randomnumlt", GameScript::RandomNumLT, 0},
-	{"randomstatcheck", GameScript::RandomStatCheck, 0},
+	{"randomstatcheck", GameScript::RandomStatCheck, TF_VOLATILE},
 	{"range", GameScript::Range, 0},
 	{"reaction", GameScript::Reaction, 0},
 	{"reactiongt", GameScript::ReactionGT, 0},
@@ -343,19 +346,19 @@ static const TriggerLink triggernames[] = {
 	{"school", GameScript::School, 0}, //similar to kit
 	{"see", GameScript::See, 0},
 	{"sequence", GameScript::Sequence, 0},
-	{"setlastmarkedobject", GameScript::SetLastMarkedObject, 0},
-	{"setmarkedspell", GameScript::SetMarkedSpell_Trigger, 0},
+	{"setlastmarkedobject", GameScript::SetLastMarkedObject, TF_VOLATILE},
+	{"setmarkedspell", GameScript::SetMarkedSpell_Trigger, TF_VOLATILE},
 	{"specifics", GameScript::Specifics, 0},
-	{"spellcast", GameScript::SpellCast, 0},
-	{"spellcastinnate", GameScript::SpellCastInnate, 0},
-	{"spellcastonme", GameScript::SpellCastOnMe, 0},
-	{"spellcastpriest", GameScript::SpellCastPriest, 0},
+	{"spellcast", GameScript::SpellCast, TF_VOLATILE},
+	{"spellcastinnate", GameScript::SpellCastInnate, TF_VOLATILE},
+	{"spellcastonme", GameScript::SpellCastOnMe, TF_VOLATILE},
+	{"spellcastpriest", GameScript::SpellCastPriest, TF_VOLATILE},
 	{"statecheck", GameScript::StateCheck, 0},
 	{"stealfailed", GameScript::StealFailed, 0},
 	{"storehasitem", GameScript::StoreHasItem, 0},
-	{"stuffglobalrandom", GameScript::StuffGlobalRandom, 0},//hm, this is a trigger
+	{"stuffglobalrandom", GameScript::StuffGlobalRandom, TF_VOLATILE},//hm, this is a trigger
 	{"subrace", GameScript::SubRace, 0},
-	{"systemvariable", GameScript::SystemVariable_Trigger, 0}, //gemrb
+	{"systemvariable", GameScript::SystemVariable_Trigger, TF_VOLATILE}, //gemrb
 	{"targetunreachable", GameScript::TargetUnreachable, 0},
 	{"team", GameScript::Team, 0},
 	{"time", GameScript::Time, 0},
@@ -364,7 +367,7 @@ static const TriggerLink triggernames[] = {
 	{"timeofday", GameScript::TimeOfDay, 0},
 	{"timeractive", GameScript::TimerActive, 0},
 	{"timerexpired", GameScript::TimerExpired, 0},
-	{"tookdamage", GameScript::TookDamage, 0},
+	{"tookdamage", GameScript::TookDamage, TF_VOLATILE},
 	{"totalitemcnt", GameScript::TotalItemCnt, 0}, //iwd2
 	{"totalitemcntexclude", GameScript::TotalItemCntExclude, 0}, //iwd2
 	{"totalitemcntexcludegt", GameScript::TotalItemCntExcludeGT, 0}, //iwd2
@@ -374,7 +377,7 @@ static const TriggerLink triggernames[] = {
 	{"traptriggered", GameScript::TrapTriggered, 0},
 	{"trigger", GameScript::TriggerTrigger, 0},
 	{"triggerclick", GameScript::Clicked, 0}, //not sure
-	{"triggersetglobal", GameScript::TriggerSetGlobal,0}, //iwd2, but never used
+	{"triggersetglobal", GameScript::TriggerSetGlobal, TF_VOLATILE}, //iwd2, but never used
 	{"true", GameScript::True, 0},
 	{"turnedby", GameScript::TurnedBy, 0},
 	{"unlocked", GameScript::Unlocked, 0},
@@ -1659,9 +1662,68 @@ Script* GameScript::CacheScript(ieResRef ResRef, bool AIScript)
 		stream->ReadLine( line, 10 );
 	}
 	delete( stream );
+	CompileScript( newScript );
 	return newScript;
 }
 
+static const char* TriggerName(unsigned short triggerID)
+{
+	const char *name = triggersTable->GetValue(triggerID);
+	if (!name) {
+		name = triggersTable->GetValue(triggerID|0x4000);
+	}
+	return name;
+}
+
+//unknown triggers are reported once and evaluate to false
+static TriggerFunction ResolveTrigger(unsigned short triggerID)
+{
+	TriggerFunction func = triggers[triggerID];
+	if (!func) {
+		triggers[triggerID] = GameScript::False;
+		printMessage("GameScript"," ",YELLOW);
+		print("Unhandled trigger code: 0x%04x %s\n",
+			triggerID, TriggerName(triggerID) );
+		return GameScript::False;
+	}
+	return func;
+}
+
+//flattens the conditions of the script into the code array, so Update
+//doesn't have to chase the blocks, conditions and trigger vectors
+void GameScript::CompileScript(Script* script)
+{
+	std::vector<ScriptOp> &code = script->code;
+	code.clear();
+	for (size_t a = 0; a < script->responseBlocks.size(); a++) {
+		ResponseBlock* rB = script->responseBlocks[a];
+		size_t start = code.size();
+		if (rB->condition) {
+			std::vector<Trigger*> &tr = rB->condition->triggers;
+			for (size_t i = 0; i < tr.size(); i++) {
+				ScriptOp op;
+				op.function = ResolveTrigger(tr[i]->triggerID);
+				op.trigger = tr[i];
+				op.block = NULL;
+				op.end = 0;
+				op.negate = (tr[i]->flags & NEGATE_TRIGGER) != 0;
+				code.push_back( op );
+			}
+		}
+		unsigned int end = (unsigned int) code.size();
+		for (size_t i = start; i < end; i++) {
+			code[i].end = end;
+		}
+		ScriptOp op;
+		op.function = NULL;
+		op.trigger = NULL;
+		op.block = rB;
+		op.end = end;
+		op.negate = false;
+		code.push_back( op );
+	}
+}
+
 static int ParseInt(const char*& src)
 {
 	char number[33];
@@ -1690,6 +1752,40 @@ static void ParseString(const char*& src, char* tmp)
 		src++;
 }
 
+static SlabAllocator objectSlab("Object", sizeof(Object), PROFILE_ALLOC_OBJECTS);
+static SlabAllocator triggerSlab("Trigger", sizeof(Trigger), PROFILE_ALLOC_TRIGGERS);
+static SlabAllocator actionSlab("Action", sizeof(Action), PROFILE_ALLOC_ACTIONS);
+
+void* Object::operator new(size_t size)
+{
+	return objectSlab.Alloc(size);
+}
+
+void Object::operator delete(void* object, size_t size)
+{
+	objectSlab.Free(object, size);
+}
+
+void* Trigger::operator new(size_t size)
+{
+	return triggerSlab.Alloc(size);
+}
+
+void Trigger::operator delete(void* trigger, size_t size)
+{
+	triggerSlab.Free(trigger, size);
+}
+
+void* Action::operator new(size_t size)
+{
+	return actionSlab.Alloc(size);
+}
+
+void Action::operator delete(void* action, size_t size)
+{
+	actionSlab.Free(action, size);
+}
+
 static Object* DecodeObject(const char* line)
 {
 	int i;
@@ -1789,6 +1885,17 @@ static Condition* ReadCondition(DataStream* stream)
  * (should start false and be passed to next script's Update),
  * and done is set to whether we processed a block without Continue()
  */
+//the triggers of a block which can't be evaluated twice
+static bool IsVolatile(const ScriptOp* op, const ScriptOp* end)
+{
+	for (; op < end; op++) {
+		if (triggerflags[op->trigger->triggerID] & TF_VOLATILE) {
+			return true;
+		}
+	}
+	return false;
+}
+
 bool GameScript::Update(bool *continuing, bool *done)
 {
 	if (!MySelf)
@@ -1812,9 +1919,26 @@ bool GameScript::Update(bool *continuing, bool *done)
 	if (continuing) continueExecution = *continuing;
 
 	RandomNumValue=rand();
-	for (size_t a = 0; a < script->responseBlocks.size(); a++) {
-		ResponseBlock* rB = script->responseBlocks[a];
-		if (rB->condition->Evaluate(MySelf)) {
+	size_t blocks = script->responseBlocks.size();
+	const ScriptOp* code = blocks ? &script->code[0] : NULL;
+	const ScriptOp* op = code;
+	for (size_t a = 0; a < blocks; a++) {
+		//the end of the block holds the response
+		const ScriptOp* end = op->function ? code + op->end : op;
+		ResponseBlock* rB = end->block;
+		bool result = EvaluateCondition(MySelf, op);
+		//this evaluates the conditions again, so blocks with triggers
+		//rolling dice or changing the scriptable are skipped; other
+		//random triggers (not using RandomNumValue) may still differ
+		if ((InDebug&ID_COMPILED) && !IsVolatile(op, end)) {
+			bool original = !rB->condition || rB->condition->Evaluate(MySelf);
+			if (original != result) {
+				printMessage("GameScript", "Compiled condition of block %d in %s differs: %d instead of %d\n",
+					LIGHT_RED, (int) a, Name, result, original);
+			}
+		}
+		op = end + 1;
+		if (result) {
 			//if this isn't a continue-d block, we have to clear the queue
 			//we cannot clear the queue and cannot execute the new block
 			//if we already have stuff on the queue!
@@ -2022,6 +2146,52 @@ int GameScript::EvaluateString(Scriptable* Sender, char* String)
 	return 0;
 }
 
+//the same as Condition::Evaluate, on the compiled triggers of a block
+bool GameScript::EvaluateCondition(Scriptable* Sender, const ScriptOp* op)
+{
+	int ORcount = 0;
+	unsigned int result = 0;
+	bool subresult = true;
+
+	for (; op->function; op++) {
+		//do not evaluate triggers in an Or() block if one of them
+		//was already True()
+		if (!ORcount || !subresult) {
+			if (InDebug&ID_TRIGGERS) {
+				result = op->trigger->Evaluate(Sender);
+			} else {
+				result = op->function(Sender, op->trigger);
+				if (op->negate) {
+					result = !result;
+				}
+			}
+		}
+		if (result > 1) {
+			//we started an Or() block
+			if (ORcount) {
+				printMessage( "GameScript","Unfinished OR block encountered!\n",YELLOW );
+			}
+			ORcount = result;
+			subresult = false;
+			continue;
+		}
+		if (ORcount) {
+			subresult |= ( result != 0 );
+			if (--ORcount) {
+				continue;
+			}
+			result = subresult;
+		}
+		if (!result) {
+			return false;
+		}
+	}
+	if (ORcount) {
+		printMessage( "GameScript","Unfinished OR block encountered!\n",YELLOW );
+	}
+	return true;
+}
+
 bool Condition::Evaluate(Scriptable* Sender)
 {
 	int ORcount = 0;
@@ -2069,21 +2239,15 @@ int Trigger::Evaluate(Scriptable* Sender)
 		return 0;
 	}
 	TriggerFunction func = triggers[triggerID];
-	const char *tmpstr=triggersTable->GetValue(triggerID);
-	if (!tmpstr) {
-		tmpstr=triggersTable->GetValue(triggerID|0x4000);
-	}
 	if (!func) {
-		triggers[triggerID] = GameScript::False;
-		printMessage("GameScript"," ",YELLOW);
-		print("Unhandled trigger code: 0x%04x %s\n",
-			triggerID, tmpstr );
+		ResolveTrigger(triggerID);
 		return 0;
 	}
+	//the name is looked up only for debugging, it is a linear search
 	if (InDebug&ID_TRIGGERS) {
 		printMessage("GameScript"," ",YELLOW);
 		print( "Executing trigger code: 0x%04x %s\n",
-				triggerID, tmpstr );
+				triggerID, TriggerName(triggerID) );
 	}
 	int ret = func( Sender, this );
 	if (flags & NEGATE_TRIGGER) {
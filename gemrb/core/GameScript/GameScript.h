@@ -193,12 +193,33 @@ public:
 		delete this;
 	}
 	bool isNull();
+	//script objects come from slabs, see GameScript.cpp
+	static void* operator new(size_t size);
+	static void operator delete(void* object, size_t size);
+};
+
+//the scopes of script variables
+#define VAR_UNRESOLVED 0
+#define VAR_GLOBAL     1
+#define VAR_LOCALS     2
+#define VAR_MYAREA     3
+#define VAR_KAPUTZ     4
+#define VAR_AREA       5
+
+/** a variable used by a trigger, the scope is parsed and the variable
+ * is looked up only the first time, see CheckVariable */
+struct ScriptVariable {
+	char scope;
+	char offset; //of the name in the parameter
+	char area[7];
+	Variables::Handle handle;
 };
 
 class GEM_EXPORT Trigger {
 public:
 	Trigger()
 	{
+		memset( variables, 0, sizeof( variables ) );
 		flags = 0;
 		objectParameter = NULL;
 		string0Parameter[0] = 0;
@@ -226,6 +247,7 @@ public:
 	char string0Parameter[65];
 	char string1Parameter[65];
 	Object* objectParameter;
+	ScriptVariable variables[2];
 private:
 	volatile unsigned long canary;
 public:
@@ -251,6 +273,8 @@ public:
 		canary = 0xdddddddd;
 		delete this;
 	}
+	static void* operator new(size_t size);
+	static void operator delete(void* trigger, size_t size);
 };
 
 class GEM_EXPORT Condition {
@@ -372,6 +396,8 @@ public:
 			abort();
 		}
 	}
+	static void* operator new(size_t size);
+	static void operator delete(void* action, size_t size);
 };
 
 class GEM_EXPORT Response {
@@ -468,6 +494,19 @@ public:
 	}
 };
 
+typedef int (* TriggerFunction)(Scriptable*, Trigger*);
+
+/** One instruction of a compiled script: the triggers of a block's
+ * condition follow each other, then an op without function ends the block.
+ * The trigger functions are resolved when the script is cached. */
+struct ScriptOp {
+	TriggerFunction function; //NULL at the end of a block
+	Trigger* trigger;         //the parameters of the function
+	ResponseBlock* block;     //end of a block only
+	unsigned int end;         //triggers: the index of the end of their block
+	bool negate;
+};
+
 class GEM_EXPORT Script {
 public:
 	Script()
@@ -485,6 +524,8 @@ public:
 	}
 public:
 	std::vector<ResponseBlock*> responseBlocks;
+	/** the conditions of the response blocks, in a single array */
+	std::vector<ScriptOp> code;
 private:
 	volatile unsigned long canary;
 public:
@@ -496,7 +537,6 @@ public:
 	}
 };
 
-typedef int (* TriggerFunction)(Scriptable*, Trigger*);
 typedef void (* ActionFunction)(Scriptable*, Action*);
 typedef Targets* (* ObjectFunction)(Scriptable *, Targets*, int ga_flags);
 typedef int (* IDSFunction)(Actor *, int parameter);
@@ -504,6 +544,7 @@ typedef int (* IDSFunction)(Actor *, int parameter);
 #define TF_NONE 	0
 #define TF_CONDITION    1 //this isn't a trigger, just a condition (0x4000)
 #define TF_MERGESTRINGS 8 //same value as actions' mergestring
+#define TF_VOLATILE     16 //rolls dice or changes the scriptable, see ID_COMPILED
 
 struct TriggerLink {
 	const char* Name;
@@ -597,6 +638,8 @@ private: //Internal Functions
 	ResponseSet* ReadResponseSet(DataStream* stream);
 	Response* ReadResponse(DataStream* stream);
 	Trigger* ReadTrigger(DataStream* stream);
+	static void CompileScript(Script* script);
+	static bool EvaluateCondition(Scriptable* Sender, const ScriptOp* op);
 	static int ParseInt(const char*& src);
 	static void ParseString(const char*& src, char* tmp);
 private: //Internal variables
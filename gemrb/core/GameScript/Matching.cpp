@@ -182,10 +182,25 @@ static Targets* EvaluateObject(Map *map, Scriptable* Sender, Object* oC, int ga_
 	Targets *tgts = NULL;
 
 	//we need to get a subset of actors from the large array
-	//if this gets slow, we will need some index tables
-	int i = map->GetActorCount(true);
-	while (i--) {
-		Actor *ac = map->GetActor(i, true);
+	//actors only see targets in their visual range, so ask the spatial index
+	static std::vector<Actor*> candidates;
+	if (Sender->Type == ST_ACTOR) {
+		int range = 1024;
+		if (((Actor *) Sender)->Modified[IE_VISUALRANGE] < 1024) {
+			range = ((Actor *) Sender)->Modified[IE_VISUALRANGE] + 1;
+		}
+		Region rgn(Sender->Pos.x - range*16, Sender->Pos.y - range*12, range*32, range*24);
+		map->GetActorsNear(rgn, candidates);
+	} else {
+		candidates.clear();
+		int i = map->GetActorCount(true);
+		while (i--) {
+			candidates.push_back(map->GetActor(i, true));
+		}
+	}
+
+	for (size_t i = 0; i < candidates.size(); i++) {
+		Actor *ac = candidates[i];
 		if (!ac) continue; // is this check really needed?
 		// don't return Sender in IDS targeting!
 		if (ac == Sender) continue;
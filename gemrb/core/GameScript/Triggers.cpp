@@ -439,7 +439,7 @@ int GameScript::BitCheck(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value = CheckVariable(Sender, parameters->string0Parameter, parameters->variables[0], &valid );
 	if (valid) {
 		if ( value & parameters->int0Parameter ) return 1;
 	}
@@ -450,7 +450,7 @@ int GameScript::BitCheckExact(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value = CheckVariable(Sender, parameters->string0Parameter, parameters->variables[0], &valid );
 	if (valid) {
 		ieDword tmp = (ieDword) parameters->int0Parameter ;
 		if ((value & tmp) == tmp) return 1;
@@ -464,7 +464,7 @@ int GameScript::BitGlobal_Trigger(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value = CheckVariable(Sender, parameters->string0Parameter, parameters->variables[0], &valid );
 	if (valid) {
 		HandleBitMod(value, parameters->int0Parameter, parameters->int1Parameter);
 		if (value!=0) return 1;
@@ -476,10 +476,10 @@ int GameScript::GlobalOrGlobal_Trigger(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, parameters->variables[0], &valid );
 	if (valid) {
 		if ( value1 ) return 1;
-		ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, &valid );
+		ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, parameters->variables[1], &valid );
 		if (valid) {
 			if ( value2 ) return 1;
 		}
@@ -491,9 +491,9 @@ int GameScript::GlobalAndGlobal_Trigger(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value1 = CheckVariable( Sender, parameters->string0Parameter, &valid );
+	ieDword value1 = CheckVariable( Sender, parameters->string0Parameter, parameters->variables[0], &valid );
 	if (valid && value1) {
-		ieDword value2 = CheckVariable( Sender, parameters->string1Parameter, &valid );
+		ieDword value2 = CheckVariable( Sender, parameters->string1Parameter, parameters->variables[1], &valid );
 		if (valid && value2) return 1;
 	}
 	return 0;
@@ -503,9 +503,9 @@ int GameScript::GlobalBAndGlobal_Trigger(Scriptable* Sender, Trigger* parameters
 {
 	bool valid=true;
 
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, parameters->variables[0], &valid );
 	if (valid) {
-		ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, &valid );
+		ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, parameters->variables[1], &valid );
 		if (valid) {
 			if ((value1& value2 ) != 0) return 1;
 		}
@@ -517,9 +517,9 @@ int GameScript::GlobalBAndGlobalExact(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, parameters->variables[0], &valid );
 	if (valid) {
-		ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, &valid );
+		ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, parameters->variables[1], &valid );
 		if (valid) {
 			if (( value1& value2 ) == value2) return 1;
 		}
@@ -531,9 +531,9 @@ int GameScript::GlobalBitGlobal_Trigger(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, parameters->variables[0], &valid );
 	if (valid) {
-		ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, &valid );
+		ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, parameters->variables[1], &valid );
 		if (valid) {
 			HandleBitMod( value1, value2, parameters->int1Parameter);
 			if (value1!=0) return 1;
@@ -555,7 +555,7 @@ int GameScript::Xor(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value = CheckVariable(Sender, parameters->string0Parameter, parameters->variables[0], &valid );
 	if (valid) {
 		if (( value ^ parameters->int0Parameter ) != 0) return 1;
 	}
@@ -609,7 +609,7 @@ int GameScript::NumDeadLT(Scriptable* Sender, Trigger* parameters)
 
 int GameScript::G_Trigger(Scriptable* Sender, Trigger* parameters)
 {
-	ieDwordSigned value = CheckVariable(Sender, parameters->string0Parameter, "GLOBAL" );
+	ieDwordSigned value = CheckVariable(Sender, parameters->string0Parameter, "GLOBAL", parameters->variables[0] );
 	return ( value == parameters->int0Parameter );
 }
 
@@ -617,7 +617,7 @@ int GameScript::Global(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDwordSigned value = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDwordSigned value = CheckVariable(Sender, parameters->string0Parameter, parameters->variables[0], &valid );
 	if (valid) {
 		if ( value == parameters->int0Parameter ) return 1;
 	}
@@ -626,7 +626,7 @@ int GameScript::Global(Scriptable* Sender, Trigger* parameters)
 
 int GameScript::GLT_Trigger(Scriptable* Sender, Trigger* parameters)
 {
-	ieDwordSigned value = CheckVariable(Sender, parameters->string0Parameter,"GLOBAL" );
+	ieDwordSigned value = CheckVariable(Sender, parameters->string0Parameter, "GLOBAL", parameters->variables[0] );
 	return ( value < parameters->int0Parameter );
 }
 
@@ -634,7 +634,7 @@ int GameScript::GlobalLT(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDwordSigned value = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDwordSigned value = CheckVariable(Sender, parameters->string0Parameter, parameters->variables[0], &valid );
 	if (valid) {
 		if ( value < parameters->int0Parameter ) return 1;
 	}
@@ -643,7 +643,7 @@ int GameScript::GlobalLT(Scriptable* Sender, Trigger* parameters)
 
 int GameScript::GGT_Trigger(Scriptable* Sender, Trigger* parameters)
 {
-	ieDwordSigned value = CheckVariable(Sender, parameters->string0Parameter, "GLOBAL" );
+	ieDwordSigned value = CheckVariable(Sender, parameters->string0Parameter, "GLOBAL", parameters->variables[0] );
 	return ( value > parameters->int0Parameter );
 }
 
@@ -651,7 +651,7 @@ int GameScript::GlobalGT(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDwordSigned value = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDwordSigned value = CheckVariable(Sender, parameters->string0Parameter, parameters->variables[0], &valid );
 	if (valid) {
 		if ( value > parameters->int0Parameter ) return 1;
 	}
@@ -662,9 +662,9 @@ int GameScript::GlobalLTGlobal(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDwordSigned value1 = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDwordSigned value1 = CheckVariable(Sender, parameters->string0Parameter, parameters->variables[0], &valid );
 	if (valid) {
-		ieDwordSigned value2 = CheckVariable(Sender, parameters->string1Parameter, &valid );
+		ieDwordSigned value2 = CheckVariable(Sender, parameters->string1Parameter, parameters->variables[1], &valid );
 		if (valid) {
 			if ( value1 < value2 ) return 1;
 		}
@@ -676,9 +676,9 @@ int GameScript::GlobalGTGlobal(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDwordSigned value1 = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDwordSigned value1 = CheckVariable(Sender, parameters->string0Parameter, parameters->variables[0], &valid );
 	if (valid) {
-		ieDwordSigned value2 = CheckVariable(Sender, parameters->string1Parameter, &valid );
+		ieDwordSigned value2 = CheckVariable(Sender, parameters->string1Parameter, parameters->variables[1], &valid );
 		if (valid) {
 			if ( value1 > value2 ) return 1;
 		}
@@ -688,43 +688,43 @@ int GameScript::GlobalGTGlobal(Scriptable* Sender, Trigger* parameters)
 
 int GameScript::GlobalsEqual(Scriptable* Sender, Trigger* parameters)
 {
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, "GLOBAL" );
-	ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, "GLOBAL" );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, "GLOBAL", parameters->variables[0] );
+	ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, "GLOBAL", parameters->variables[1] );
 	return ( value1 == value2 );
 }
 
 int GameScript::GlobalsGT(Scriptable* Sender, Trigger* parameters)
 {
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, "GLOBAL" );
-	ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, "GLOBAL" );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, "GLOBAL", parameters->variables[0] );
+	ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, "GLOBAL", parameters->variables[1] );
 	return ( value1 > value2 );
 }
 
 int GameScript::GlobalsLT(Scriptable* Sender, Trigger* parameters)
 {
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, "GLOBAL" );
-	ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, "GLOBAL" );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, "GLOBAL", parameters->variables[0] );
+	ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, "GLOBAL", parameters->variables[1] );
 	return ( value1 < value2 );
 }
 
 int GameScript::LocalsEqual(Scriptable* Sender, Trigger* parameters)
 {
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, "LOCALS" );
-	ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, "LOCALS" );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, "LOCALS", parameters->variables[0] );
+	ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, "LOCALS", parameters->variables[1] );
 	return ( value1 == value2 );
 }
 
 int GameScript::LocalsGT(Scriptable* Sender, Trigger* parameters)
 {
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, "LOCALS" );
-	ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, "LOCALS" );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, "LOCALS", parameters->variables[0] );
+	ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, "LOCALS", parameters->variables[1] );
 	return ( value1 > value2 );
 }
 
 int GameScript::LocalsLT(Scriptable* Sender, Trigger* parameters)
 {
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, "LOCALS" );
-	ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, "LOCALS" );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, "LOCALS", parameters->variables[0] );
+	ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, "LOCALS", parameters->variables[1] );
 	return ( value1 < value2 );
 }
 
@@ -732,7 +732,7 @@ int GameScript::RealGlobalTimerExact(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, parameters->string1Parameter, &valid );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, parameters->string1Parameter, parameters->variables[0], &valid );
 	if (valid && value1) {
 		ieDword value2 = core->GetGame()->RealTime;
 		if ( value1 == value2 ) return 1;
@@ -744,7 +744,7 @@ int GameScript::RealGlobalTimerExpired(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, parameters->string1Parameter, &valid );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, parameters->string1Parameter, parameters->variables[0], &valid );
 	if (valid && value1) {
 		if ( value1 < core->GetGame()->RealTime ) return 1;
 	}
@@ -755,7 +755,7 @@ int GameScript::RealGlobalTimerNotExpired(Scriptable* Sender, Trigger* parameter
 {
 	bool valid=true;
 
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, parameters->string1Parameter, &valid );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, parameters->string1Parameter, parameters->variables[0], &valid );
 	if (valid && value1) {
 		if ( value1 > core->GetGame()->RealTime ) return 1;
 	}
@@ -766,7 +766,7 @@ int GameScript::GlobalTimerExact(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, parameters->string1Parameter, &valid );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, parameters->string1Parameter, parameters->variables[0], &valid );
 	if (valid) {
 		if ( value1 == core->GetGame()->GameTime ) return 1;
 	}
@@ -777,7 +777,7 @@ int GameScript::GlobalTimerExpired(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, parameters->string1Parameter, &valid );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, parameters->string1Parameter, parameters->variables[0], &valid );
 	if (valid && value1) {
 		if ( value1 < core->GetGame()->GameTime ) return 1;
 	}
@@ -789,7 +789,7 @@ int GameScript::GlobalTimerNotExpired(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, parameters->string1Parameter, &valid );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, parameters->string1Parameter, parameters->variables[0], &valid );
 	if (valid && value1) {
 	 	if ( value1 > core->GetGame()->GameTime ) return 1;
 	}
@@ -802,7 +802,7 @@ int GameScript::GlobalTimerStarted(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, parameters->string1Parameter, &valid );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, parameters->string1Parameter, parameters->variables[0], &valid );
 	if (valid && value1) {
 		if ( value1 > core->GetGame()->GameTime ) return 1;
 	}
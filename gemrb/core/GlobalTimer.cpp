@@ -25,11 +25,13 @@
 #include "Interface.h"
 #include "Video.h"
 #include "GUI/GameControl.h"
+#include "System/Profiler.h"
 
 GlobalTimer::GlobalTimer(void)
 {
 	//AI_UPDATE_TIME: how many AI updates in a second
 	interval = ( 1000 / AI_UPDATE_TIME );
+	fixedStep = false;
 	Init();
 }
 
@@ -54,17 +56,33 @@ void GlobalTimer::Init()
 	ClearAnimations();
 }
 
+void GlobalTimer::SetFixedStep(bool fixed)
+{
+	fixedStep = fixed;
+	startTime = 0;
+}
+
+void GlobalTimer::GetCurrentTime(unsigned long &thisTime)
+{
+	if (fixedStep) {
+		//pretend exactly one update interval has passed
+		thisTime = startTime + interval;
+	} else {
+		GetTime( thisTime );
+	}
+}
+
 void GlobalTimer::Freeze()
 {
 	unsigned long thisTime;
 	unsigned long advance;
 
-	GetTime( thisTime );
+	GetCurrentTime( thisTime );
 	advance = thisTime - startTime;
 	if ( advance < interval) {
 		return;
 	}
-	startTime = thisTime;
+	startTime = thisTime - advance % interval;
 	Game* game = core->GetGame();
 	if (!game) {
 		return;
@@ -143,6 +161,7 @@ void GlobalTimer::DoStep(int count)
 
 bool GlobalTimer::Update()
 {
+	PROFILE_SCOPE(PROFILE_TIMER);
 	Map *map;
 	Game *game;
 	GameControl* gc;
@@ -155,7 +174,7 @@ bool GlobalTimer::Update()
 
 	UpdateAnimations();
 
-	GetTime( thisTime );
+	GetCurrentTime( thisTime );
 
 	if (!startTime) {
 		startTime = thisTime;
@@ -195,7 +214,9 @@ bool GlobalTimer::Update()
 		game->RealTime++;
 	}
 end:
-	startTime = thisTime;
+	//keep the remainder, so the updates stay on the AI_UPDATE_TIME
+	//schedule no matter how often the frames come
+	startTime = thisTime - advance % interval;
 	return true;
 }
 
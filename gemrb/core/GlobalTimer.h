@@ -40,6 +40,8 @@ class GEM_EXPORT GlobalTimer {
 private:
 	unsigned long startTime;
 	unsigned long interval;
+	//advance exactly one interval per update (benchmarking)
+	bool fixedStep;
 
 	int fadeToCounter, fadeToMax;
 	int fadeFromCounter, fadeFromMax;
@@ -54,12 +56,14 @@ private:
 	Region currentVP;
 
 	void DoFadeStep(ieDword count);
+	void GetCurrentTime(unsigned long &thisTime);
 public:
 	GlobalTimer(void);
 	~GlobalTimer(void);
 public:
 	void Init();
 	void Freeze();
+	void SetFixedStep(bool fixed);
 	bool Update();
 	bool ViewportIsMoving();
 	void DoStep(int count);
@@ -73,12 +73,14 @@
 #include "GUI/WorldMapControl.h"
 #include "Scriptable/Container.h"
 #include "System/FileStream.h"
+#include "System/Profiler.h"
 #include "System/VFS.h"
 
 #if defined(__HAIKU__)
 #include <unistd.h>
 #endif
 
+#include <algorithm>
 #include <cstdlib>
 #include <time.h>
 #include <vector>
@@ -182,7 +184,15 @@ Interface::Interface(int iargc, char* iargv[])
 	GameOnCD = false;
 	SkipIntroVideos = false;
 	DrawFPS = false;
+	MaxFPS = 30;
+	FramePacing = PACE_SLEEP;
 	KeepCache = false;
+	PreloadSounds = false;
+	BenchmarkTicks = 0;
+	BenchmarkSeed = 0;
+	BenchmarkSave[0] = 0;
+	BenchmarkMovie[0] = 0;
+	ProfileTrace[0] = 0;
 	TooltipDelay = 100;
 	IgnoreOriginalINI = 0;
 	FullScreen = 0;
@@ -1081,7 +1091,7 @@ char *Interface::GetMusicPlaylist(int SongType) const {
 
 static const Color white = {0xff,0xff,0xff,0xff};
 static const Color black = {0x00,0x00,0x00,0xff};
-static const Region bg( 0, 0, 100, 30 );
+static const Region bg( 0, 0, 200, 30 );
 
 /** this is the main loop */
 void Interface::Main()
@@ -1092,6 +1102,7 @@ void Interface::Main()
 
 	vars->Lookup("Full Screen", FullScreen);
 	video->CreateDisplay( Width, Height, Bpp, FullScreen);
+	video->SetFrameRate( MaxFPS, FramePacing );
 	video->SetDisplayTitle( GameName, GameType );
 	vars->Lookup("Brightness Correction", brightness);
 	vars->Lookup("Gamma Correction", contrast);
@@ -1103,11 +1114,28 @@ void Interface::Main()
 		TooltipDelay *= TOOLTIP_DELAY_FACTOR/10;
 	}
 
+	if (BenchmarkMovie[0]) {
+		ResourceHolder<MoviePlayer> mp(BenchmarkMovie);
+		if (!mp) {
+			printMessage("Core", "Benchmark movie '%s' not found!\n", LIGHT_RED, BenchmarkMovie);
+		} else {
+			mp->Benchmark();
+		}
+		return;
+	}
+
+	if (BenchmarkTicks) {
+		RunBenchmark();
+		if (ProfileTrace[0]) {
+			Profiler::WriteTrace( ProfileTrace );
+		}
+		return;
+	}
+
 	Font* fps = GetFont( ( unsigned int ) 0 );
-	char fpsstring[40]={"???.??? fps"};
-	unsigned long frame = 0, time, timebase;
+	char fpsstring[64]={"???.? fps"};
+	unsigned long time, timebase;
 	GetTime(timebase);
-	double frames = 0.0;
 	Palette* palette = CreatePalette( white, black );
 	do {
 		//don't change script when quitting is pending
@@ -1122,25 +1150,33 @@ void Interface::Main()
 		HandleGUIBehaviour();
 
 		GameLoop();
+		AudioDriver->Update();
 		DrawWindows();
 		if (DrawFPS) {
-			frame++;
 			GetTime( time );
 			if (time - timebase > 1000) {
-				frames = ( frame * 1000.0 / ( time - timebase ) );
+				//the median and the worst frame times of the last frames
+				const FramePacer& pacer = video->GetFramePacer();
 				timebase = time;
-				frame = 0;
-				sprintf( fpsstring, "%.3f fps", frames );
+				snprintf( fpsstring, sizeof(fpsstring), "%.1f fps, %.1f/%.1f/%.1f ms",
+					pacer.GetFPS(), pacer.GetFrameTime(50) / 1000.0,
+					pacer.GetFrameTime(95) / 1000.0, pacer.GetFrameTime(99) / 1000.0 );
 			}
 			video->DrawRect( bg, black );
 			fps->Print( bg,
 				( unsigned char * ) fpsstring, palette,
 				IE_FONT_ALIGN_LEFT | IE_FONT_ALIGN_MIDDLE, true );
+			//the subsystem timings of the previous frame
+			Profiler::DrawOverlay( video.get(), bg.x+bg.w, bg.y+bg.h/3 );
 		}
 		if (TickHook)
 			TickHook->call();
+		Profiler::EndFrame();
 	} while (video->SwapBuffers() == GEM_OK);
 	gamedata->FreePalette( palette );
+	if (ProfileTrace[0]) {
+		Profiler::WriteTrace( ProfileTrace );
+	}
 }
 
 int Interface::ReadResRefTable(const ieResRef tablename, ieResRef *&data)
@@ -1444,9 +1480,14 @@ int Interface::Init()
 	}
 	plugin->RunInitializers();
 
-	time_t t;
-	t = time( NULL );
-	srand( ( unsigned int ) t );
+	if (BenchmarkTicks) {
+		//benchmark runs have to be repeatable
+		srand( BenchmarkSeed );
+	} else {
+		time_t t;
+		t = time( NULL );
+		srand( ( unsigned int ) t );
+	}
 #ifdef _DEBUG
 	FileStreamPtrCount = 0;
 #endif
@@ -2233,6 +2274,8 @@ bool Interface::LoadConfig(const char* filename)
 #define CONFIG_INT(str, var) \
 		} else if (stricmp(name, str) == 0) { \
 			var ( atoi(value) )
+		CONFIG_INT("BenchmarkSeed", BenchmarkSeed = );
+		CONFIG_INT("BenchmarkTicks", BenchmarkTicks = );
 		CONFIG_INT("Bpp", Bpp = );
 		CONFIG_INT("CaseSensitive", CaseSensitive = );
 		CONFIG_INT("DoubleClickDelay", evntmgr->SetDCDelay);
@@ -2240,12 +2283,16 @@ bool Interface::LoadConfig(const char* filename)
 		CONFIG_INT("EnableCheatKeys", EnableCheatKeys);
 		CONFIG_INT("EndianSwitch", DataStream::SetEndianSwitch);
 		CONFIG_INT("FogOfWar", FogOfWar = );
+		CONFIG_INT("FramePacing", FramePacing = );
 		CONFIG_INT("FullScreen", FullScreen = );
 		CONFIG_INT("GUIEnhancements", GUIEnhancements = );
 		CONFIG_INT("GameOnCD", GameOnCD = );
 		CONFIG_INT("Height", Height = );
 		CONFIG_INT("KeepCache", KeepCache = );
+		CONFIG_INT("MaxFPS", MaxFPS = );
 		CONFIG_INT("MultipleQuickSaves", GameControl::MultipleQuickSaves);
+		CONFIG_INT("PreloadSounds", PreloadSounds = );
+		CONFIG_INT("Profile", Profiler::Enable);
 		CONFIG_INT("RepeatKeyDelay", evntmgr->SetRKDelay);
 		CONFIG_INT("SaveAsOriginal", SaveAsOriginal = );
 		CONFIG_INT("ScriptDebugMode", SetScriptDebugMode);
@@ -2257,6 +2304,8 @@ bool Interface::LoadConfig(const char* filename)
 #define CONFIG_STRING(str, var) \
 		} else if (stricmp(name, str) == 0) { \
 			strncpy(var, value, sizeof(var))
+		CONFIG_STRING("BenchmarkSave", BenchmarkSave);
+		CONFIG_STRING("BenchmarkMovie", BenchmarkMovie);
 		CONFIG_STRING("GameCharactersPath", GameCharactersPath);
 		CONFIG_STRING("GameDataPath", GameDataPath);
 		CONFIG_STRING("GameName", GameName);
@@ -2281,6 +2330,7 @@ bool Interface::LoadConfig(const char* filename)
 		CONFIG_PATH("GemRBOverridePath", GemRBOverridePath);
 		CONFIG_PATH("GemRBPath", GemRBPath);
 		CONFIG_PATH("PluginsPath", PluginsPath);
+		CONFIG_PATH("ProfileTrace", ProfileTrace);
 		CONFIG_PATH("SavePath", SavePath);
 #undef CONFIG_PATH
 		} else if (stricmp( name, "ModPath" ) == 0) {
@@ -3219,6 +3269,7 @@ bool Interface::IsFreezed()
 
 void Interface::GameLoop(void)
 {
+	PROFILE_SCOPE(PROFILE_GAMELOOP);
 	update_scripts = false;
 	GameControl *gc = GetGameControl();
 	if (gc) {
@@ -3239,6 +3290,74 @@ void Interface::GameLoop(void)
 	}
 }
 
+/** loads BenchmarkSave and runs BenchmarkTicks game ticks as fast as
+ * possible, then reports how long they took. The game timer is switched
+ * to fixed steps, so every iteration advances the game by exactly one tick,
+ * no matter how long it took. Use it with VideoDriver=none and
+ * AudioDriver=none to measure the simulation alone. */
+void Interface::RunBenchmark(void)
+{
+	Holder<SaveGame> sg = GetSaveGameIterator()->GetSaveGame(BenchmarkSave);
+	if (!sg) {
+		printMessage("Core", "Benchmark savegame '%s' not found!\n", LIGHT_RED, BenchmarkSave);
+		return;
+	}
+
+	//skip the start script, go straight into the game
+	SetupLoadGame(sg, 0);
+	QuitFlag = QF_LOADGAME|QF_ENTERGAME;
+	HandleFlags();
+	if (!game) {
+		printMessage("Core", "Couldn't load benchmark savegame!\n", LIGHT_RED);
+		return;
+	}
+	timer->SetFixedStep(true);
+
+	std::vector<unsigned long> ticks;
+	ticks.reserve(BenchmarkTicks);
+	unsigned long start, end, total = 0;
+	unsigned int i;
+	for (i = 0; i < BenchmarkTicks; i++) {
+		GetTimeUsec( start );
+		while (QuitFlag) {
+			HandleFlags();
+		}
+		if (!game) {
+			break;
+		}
+		if (EventFlag) {
+			HandleEvents();
+		}
+		HandleGUIBehaviour();
+		GameLoop();
+		DrawWindows();
+		if (video->SwapBuffers() != GEM_OK) {
+			break;
+		}
+		GetTimeUsec( end );
+		ticks.push_back(end - start);
+		total += end - start;
+		Profiler::EndFrame();
+	}
+	timer->SetFixedStep(false);
+
+	if (ticks.empty()) {
+		printMessage("Core", "Benchmark ended before the first tick!\n", LIGHT_RED);
+		return;
+	}
+	unsigned int count = (unsigned int) ticks.size();
+	unsigned int slowest = (unsigned int) (std::max_element(ticks.begin(), ticks.end()) - ticks.begin());
+	std::vector<unsigned long> sorted(ticks);
+	std::sort(sorted.begin(), sorted.end());
+
+	printMessage("Core", "Benchmark: %u ticks of '%s' (seed %u) in %lu ms\n", WHITE,
+		count, BenchmarkSave, BenchmarkSeed, total/1000);
+	printMessage("Core", "Per tick (usec): min %lu, mean %lu, median %lu, 95%% %lu, 99%% %lu, max %lu (tick %u)\n", WHITE,
+		sorted[0], total/count, sorted[count/2], sorted[count*95/100],
+		sorted[count*99/100], sorted[count-1], slowest);
+	Profiler::PrintTotals();
+}
+
 /** handles hardcoded gui behaviour */
 void Interface::HandleGUIBehaviour(void)
 {
@@ -711,6 +711,8 @@ private:
 	GameControl* StartGameControl();
 	/** Executes everything (non graphical) in the main game loop */
 	void GameLoop(void);
+	/** Runs BenchmarkTicks fixed length game ticks on BenchmarkSave */
+	void RunBenchmark(void);
 	/** the internal (without cache) part of GetListFrom2DA */
 	ieDword *GetListFrom2DAInternal(const ieResRef resref);
 public:
@@ -743,8 +745,19 @@ public:
 	int IgnoreOriginalINI;
 	unsigned int FogOfWar;
 	bool CaseSensitive, GameOnCD, SkipIntroVideos, DrawFPS;
+	//frame rate limit (<= 0: none) and PaceMode
+	int MaxFPS, FramePacing;
 	bool GUIEnhancements;
 	bool KeepCache;
+	//decode the ambients and footsteps of an area when it is loaded
+	bool PreloadSounds;
+	//headless benchmark mode (see RunBenchmark)
+	unsigned int BenchmarkTicks, BenchmarkSeed;
+	char BenchmarkSave[_MAX_PATH];
+	//decodes this movie as fast as possible (see MoviePlayer::Benchmark)
+	char BenchmarkMovie[_MAX_PATH];
+	//chrome trace of the profiled scopes is written here on exit
+	char ProfileTrace[_MAX_PATH];
 	Variables *plugin_flags;
 	/** The Main program loop */
 	void Main(void);
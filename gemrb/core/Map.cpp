@@ -48,7 +48,10 @@
 #include "Scriptable/Container.h"
 #include "Scriptable/Door.h"
 #include "Scriptable/InfoPoint.h"
+#include "System/Profiler.h"
+#include "System/SlabAllocator.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cassert>
 
@@ -62,11 +65,20 @@ static int MaxVisibility = 30;
 static int VisibilityPerimeter; //calculated from MaxVisibility
 static int NormalCost = 10;
 static int AdditionalCost = 4;
+//neighbour offsets of the searchmap, diagonals first
+static const int PathDirX[8] = { -1, 1, 1, -1, 0, 1, 0, -1 };
+static const int PathDirY[8] = { -1, -1, 1, 1, -1, 0, 1, 0 };
 static unsigned char Passable[16] = {
 	4, 1, 1, 1, 1, 1, 1, 1, 0, 1, 8, 0, 0, 0, 3, 1
 };
 static Point **VisibilityMasks=NULL;
 
+//passability without the actors, used for the region graph
+static inline bool StaticPassable(unsigned int value)
+{
+	return (value & PATH_MAP_PASSABLE) && !(value & PATH_MAP_DOOR);
+}
+
 static bool PathFinderInited = false;
 static Variables Spawns;
 static int LargeFog;
@@ -307,9 +319,20 @@ Map::Map(void)
 	HeightMap = NULL;
 	SmallMap = NULL;
 	MapSet = NULL;
+	SearchGeneration = 0;
 	SrchMap = NULL;
+	RegionMap = NULL;
+	ClusterRegions = NULL;
+	DirtyClusters = NULL;
+	ClusterWidth = ClusterHeight = 0;
+	RegionsDirty = false;
+	GridWidth = GridHeight = 0;
+	GridOrderCounter = 0;
+	MaxActorSize = 0;
 	Walls = NULL;
 	WallCount = 0;
+	WallGridWidth = WallGridHeight = 0;
+	WallStamp = 0;
 	queue[PR_SCRIPT] = NULL;
 	queue[PR_DISPLAY] = NULL;
 	INISpawn = NULL;
@@ -330,6 +353,7 @@ Map::Map(void)
 	}
 	ExploredBitmap = NULL;
 	VisibleBitmap = NULL;
+	FogDirty = true;
 	version = 0;
 	MasterArea = core->GetGame()->MasterArea(scriptName);
 	Background = NULL;
@@ -342,6 +366,9 @@ Map::~Map(void)
 
 	free( MapSet );
 	free( SrchMap );
+	free( RegionMap );
+	free( ClusterRegions );
+	free( DirtyClusters );
 	delete TMap;
 	delete INISpawn;
 	aniIterator aniidx;
@@ -429,7 +456,7 @@ void Map::AddTileMap(TileMap* tm, Image* lm, Bitmap* sr, Sprite2D* sm, Bitmap* h
 	Width = (unsigned int) (TMap->XCellCount * 4);
 	Height = (unsigned int) (( TMap->YCellCount * 64 + 63) / 12);
 	//Filling Matrices
-	MapSet = (unsigned short *) malloc(sizeof(unsigned short) * Width * Height);
+	MapSet = (PathMapNode *) calloc(Width * Height, sizeof(PathMapNode));
 	//Internal Searchmap
 	int y = sr->GetHeight();
 	SrchMap = (unsigned short *) calloc(Width * Height, sizeof(unsigned short));
@@ -442,6 +469,26 @@ void Map::AddTileMap(TileMap* tm, Image* lm, Bitmap* sr, Sprite2D* sm, Bitmap* h
 
 	//delete the original searchmap
 	delete sr;
+
+	//region graph, built on first use
+	ClusterWidth = (Width + PATH_CLUSTER_SIZE - 1) / PATH_CLUSTER_SIZE;
+	ClusterHeight = (Height + PATH_CLUSTER_SIZE - 1) / PATH_CLUSTER_SIZE;
+	RegionMap = (unsigned char *) calloc(Width * Height, 1);
+	ClusterRegions = (unsigned char *) calloc(ClusterWidth * ClusterHeight, 1);
+	DirtyClusters = (unsigned char *) malloc(ClusterWidth * ClusterHeight);
+	memset( DirtyClusters, 1, ClusterWidth * ClusterHeight );
+	RegionComponent.resize(ClusterWidth * ClusterHeight * PATH_CLUSTER_REGIONS);
+	RegionsDirty = true;
+
+	//actor spatial index
+	GridWidth = (Width * 16 + ACTOR_GRID_SIZE - 1) / ACTOR_GRID_SIZE;
+	GridHeight = (Height * 12 + ACTOR_GRID_SIZE - 1) / ACTOR_GRID_SIZE;
+	ActorGrid.clear();
+	ActorGrid.resize(GridWidth * GridHeight);
+	for (size_t i = 0; i < actors.size(); i++) {
+		actors[i]->GridBucket = (unsigned int) -1;
+		AddToGrid(actors[i]);
+	}
 }
 
 void Map::MoveToNewArea(const char *area, const char *entrance, unsigned int direction, int EveryOne, Actor *actor)
@@ -553,6 +600,10 @@ void Map::UseExit(Actor *actor, InfoPoint *ip)
 	switch(EveryOne) {
 	case CT_GO_CLOSER:
 		displaymsg->DisplayConstantString(STR_WHOLEPARTY,0xffffff); //white
+		//load the area while the rest of the party catches up
+		if (ip->Destination[0]) {
+			gamedata->PrefetchArea(ip->Destination);
+		}
 		if (game->EveryoneStopped()) {
 			ip->Flags&=~TRAP_RESET; //exit triggered
 		}
@@ -603,6 +654,10 @@ void Map::DrawPortal(InfoPoint *ip, int enable)
 
 void Map::UpdateScripts()
 {
+	PROFILE_SCOPE(PROFILE_SCRIPTS);
+	//catch up with position changes that bypassed ActorMoved
+	RefreshGrid();
+
 	bool has_pcs = false;
 	size_t i=actors.size();
 	while (i--) {
@@ -853,6 +908,63 @@ void Map::ResolveTerrainSound(ieResRef &sound, Point &Pos) {
 	}  
 }
 
+//the variants picked by Actor::PlayWalkSound
+static void PreloadWalkSound(Audio *audio, const ieResRef sound, int cnt)
+{
+	if (!sound[0] || sound[0] == '*') {
+		return;
+	}
+	ieResRef variant;
+	strnuprcpy(variant, sound, sizeof(ieResRef)-1);
+	audio->Preload(variant);
+	int len = strlen(variant);
+	if (len >= 8) {
+		return;
+	}
+	for (int i = 1; i < cnt; i++) {
+		variant[len] = i+0x60;
+		variant[len+1] = 0;
+		audio->Preload(variant);
+	}
+}
+
+void Map::PreloadSounds()
+{
+	Audio *audio = core->GetAudioDrv();
+	size_t i;
+
+	for (i = 0; i < ambients.size(); i++) {
+		const std::vector<char *> &sounds = ambients[i]->sounds;
+		for (size_t j = 0; j < sounds.size(); j++) {
+			audio->Preload(sounds[j]);
+		}
+	}
+
+	for (i = 0; i < actors.size(); i++) {
+		CharAnimations *anims = actors[i]->GetAnims();
+		if (!anims) continue;
+		int cnt = anims->GetWalkSoundCount();
+		if (!cnt) continue;
+
+		ieResRef sound;
+		strnuprcpy(sound, anims->GetWalkSound(), sizeof(ieResRef)-1);
+		int j;
+		//terrain dependent footsteps, see ResolveTerrainSound
+		for (j = 0; j < tsndcount; j++) {
+			if (!memcmp(sound, terrainsounds[j].Group, sizeof(ieResRef))) {
+				break;
+			}
+		}
+		if (j < tsndcount) {
+			for (int type = 0; type < 16; type++) {
+				PreloadWalkSound(audio, terrainsounds[j].Sounds[type], cnt);
+			}
+		} else {
+			PreloadWalkSound(audio, sound, cnt);
+		}
+	}
+}
+
 bool Map::DoStepForActor(Actor *actor, int speed, ieDword time) {
 	bool no_more_steps = true;
 
@@ -870,6 +982,7 @@ bool Map::DoStepForActor(Actor *actor, int speed, ieDword time) {
 	if (!(actor->GetBase(IE_STATE_ID)&STATE_CANTMOVE) ) {
 		if (!actor->Immobile()) {
 			no_more_steps = actor->DoStep( speed, time );
+			ActorMoved(actor);
 			if (actor->BlocksSearchMap()) {
 				BlockSearchMap( actor->Pos, actor->size, actor->InParty?PATH_MAP_PC:PATH_MAP_NPC);
 			}
@@ -1032,6 +1145,7 @@ static ieDword oldgametime = 0;
 //Draw the game area (including overlays, actors, animations, weather)
 void Map::DrawMap(Region screen)
 {
+	PROFILE_SCOPE(PROFILE_DRAWMAP);
 	if (!TMap) {
 		return;
 	}
@@ -1257,20 +1371,24 @@ print("Adding %s at height %d, Pos: %d.%d\n", anim->Name, Height, anim->Pos.x, a
 }
 
 //reapplying all of the effects on the actors of this map
-//this might be unnecessary later
+//actors whose effects can't have changed are skipped
 void Map::UpdateEffects()
 {
 	size_t i = actors.size();
 	while (i--) {
-		actors[i]->RefreshEffects(NULL);
+		actors[i]->RefreshEffectsIfChanged();
 	}
 }
 
 void Map::Shout(Actor* actor, int shoutID, unsigned int radius)
 {
-	size_t i=actors.size();
-	while (i--) {
-		Actor *listener = actors[i];
+	if (radius) {
+		GetActorsNear(actor->Pos, radius, NearActors);
+	} else {
+		NearActors.assign(actors.rbegin(), actors.rend());
+	}
+	for (size_t i = 0; i < NearActors.size(); i++) {
+		Actor *listener = NearActors[i];
 
 		if (radius) {
 			if (Distance(actor->Pos, listener->Pos)>radius) {
@@ -1290,9 +1408,9 @@ void Map::Shout(Actor* actor, int shoutID, unsigned int radius)
 bool Map::AnyEnemyNearPoint(const Point &p)
 {
 	ieDword gametime = core->GetGame()->GameTime;
-	size_t i = actors.size();
-	while (i--) {
-		Actor *actor = actors[i];
+	GetActorsNear(p, SPAWN_RANGE, NearActors);
+	for (size_t i = 0; i < NearActors.size(); i++) {
+		Actor *actor = NearActors[i];
 
 		if (actor->Schedule(gametime, true) ) {
 			continue;
@@ -1336,6 +1454,9 @@ void Map::AddActor(Actor* actor)
 	strnlwrcpy(actor->Area, scriptName, 8);
 	actor->SetMap(this);
 	actors.push_back( actor );
+	actor->GridOrder = GridOrderCounter++;
+	actor->GridBucket = (unsigned int) -1;
+	AddToGrid(actor);
 	//if a visible aggressive actor was put on the map, it is an autopause reason
 	//guess game is always loaded? if not, then we'll crash
 	ieDword gametime = core->GetGame()->GameTime;
@@ -1380,6 +1501,7 @@ void Map::DeleteActor(int i)
 		game->LeaveParty( actor );
 		//this frees up the spot under the feet circle
 		ClearSearchMapFor( actor );
+		RemoveFromGrid( actor );
 		//remove the area reference from the actor
 		actor->SetMap(NULL);
 		//don't destroy the object in case it is a persistent object
@@ -1459,9 +1581,9 @@ Actor* Map::GetActorByGlobalID(ieDword objectID)
 Actor* Map::GetActor(const Point &p, int flags)
 {
 	ieDword gametime = core->GetGame()->GameTime;
-	size_t i = actors.size();
-	while (i--) {
-		Actor* actor = actors[i];
+	GetActorsNear(p, 0, NearActors);
+	for (size_t i = 0; i < NearActors.size(); i++) {
+		Actor* actor = NearActors[i];
 
 		if (!actor->IsOver( p ))
 			continue;
@@ -1479,9 +1601,9 @@ Actor* Map::GetActor(const Point &p, int flags)
 Actor* Map::GetActorInRadius(const Point &p, int flags, unsigned int radius)
 {
 	ieDword gametime = core->GetGame()->GameTime;
-	size_t i = actors.size();
-	while (i--) {
-		Actor* actor = actors[i];
+	GetActorsNear(p, radius, NearActors);
+	for (size_t i = 0; i < NearActors.size(); i++) {
+		Actor* actor = NearActors[i];
 
 		if (PersonalDistance( p, actor ) > radius)
 			continue;
@@ -1496,38 +1618,15 @@ Actor* Map::GetActorInRadius(const Point &p, int flags, unsigned int radius)
 	return NULL;
 }
 
-//maybe consider using a simple list
 Actor **Map::GetAllActorsInRadius(const Point &p, int flags, unsigned int radius)
 {
-	ieDword count = 1;
-	size_t i;
-
 	ieDword gametime = core->GetGame()->GameTime;
-	i = actors.size();
-	while (i--) {
-		Actor* actor = actors[i];
+	GetActorsNear(p, radius, NearActors);
 
-		if (PersonalDistance( p, actor ) > radius)
-			continue;
-		if (!actor->ValidTarget(flags) ) {
-			continue;
-		}
-		if (!actor->Schedule(gametime, true) ) {
-			continue;
-		}
-		if (!(flags&GA_NO_LOS)) {
-			if (!IsVisible(actor->Pos, p)) {
-				continue;
-			}
-		}
-		count++;
-	}
-
-	Actor **ret = (Actor **) malloc( sizeof(Actor*) * count);
-	i = actors.size();
+	Actor **ret = (Actor **) malloc( sizeof(Actor*) * (NearActors.size() + 1) );
 	int j = 0;
-	while (i--) {
-		Actor* actor = actors[i];
+	for (size_t i = 0; i < NearActors.size(); i++) {
+		Actor* actor = NearActors[i];
 
 		if (PersonalDistance( p, actor ) > radius)
 			continue;
@@ -1550,6 +1649,109 @@ Actor **Map::GetAllActorsInRadius(const Point &p, int flags, unsigned int radius
 	return ret;
 }
 
+static bool LaterInArea(const Actor *a, const Actor *b)
+{
+	return a->GridOrder > b->GridOrder;
+}
+
+unsigned int Map::GetGridBucket(const Point &p) const
+{
+	int x = p.x / ACTOR_GRID_SIZE;
+	int y = p.y / ACTOR_GRID_SIZE;
+	if (x < 0) x = 0;
+	if (y < 0) y = 0;
+	if (x >= (int) GridWidth) x = GridWidth - 1;
+	if (y >= (int) GridHeight) y = GridHeight - 1;
+	return y * GridWidth + x;
+}
+
+void Map::AddToGrid(Actor *actor)
+{
+	if (!GridWidth) {
+		//no tilemap yet, AddTileMap will add it
+		return;
+	}
+	unsigned int bucket = GetGridBucket(actor->Pos);
+	ActorGrid[bucket].push_back(actor);
+	actor->GridBucket = bucket;
+	if (actor->size > MaxActorSize) {
+		MaxActorSize = actor->size;
+	}
+}
+
+void Map::RemoveFromGrid(Actor *actor)
+{
+	if (actor->GridBucket >= ActorGrid.size()) {
+		return;
+	}
+	std::vector<Actor*> &bucket = ActorGrid[actor->GridBucket];
+	for (size_t i = 0; i < bucket.size(); i++) {
+		if (bucket[i] == actor) {
+			bucket[i] = bucket.back();
+			bucket.pop_back();
+			break;
+		}
+	}
+	actor->GridBucket = (unsigned int) -1;
+}
+
+void Map::ActorMoved(Actor *actor)
+{
+	if (!GridWidth) {
+		return;
+	}
+	if (actor->size > MaxActorSize) {
+		MaxActorSize = actor->size;
+	}
+	unsigned int bucket = GetGridBucket(actor->Pos);
+	if (bucket == actor->GridBucket) {
+		return;
+	}
+	RemoveFromGrid(actor);
+	AddToGrid(actor);
+}
+
+void Map::RefreshGrid()
+{
+	size_t i = actors.size();
+	while (i--) {
+		ActorMoved(actors[i]);
+	}
+}
+
+void Map::GetActorsNear(const Point &p, unsigned int radius, std::vector<Actor*> &buffer)
+{
+	//anything bigger covers the whole area anyway
+	int r = radius > 0x8000 ? 0x8000 : (int) radius;
+	Region rgn(p.x - r, p.y - r, 2 * r + 1, 2 * r + 1);
+	GetActorsNear(rgn, buffer);
+}
+
+void Map::GetActorsNear(const Region &rgn, std::vector<Actor*> &buffer)
+{
+	buffer.clear();
+	if (!GridWidth) {
+		buffer.assign(actors.rbegin(), actors.rend());
+		return;
+	}
+	//the feet circles stick out of the actor position
+	int margin = MaxActorSize * 16;
+	int x0 = (rgn.x - margin) / ACTOR_GRID_SIZE;
+	int y0 = (rgn.y - margin) / ACTOR_GRID_SIZE;
+	int x1 = (rgn.x + rgn.w + margin) / ACTOR_GRID_SIZE;
+	int y1 = (rgn.y + rgn.h + margin) / ACTOR_GRID_SIZE;
+	if (x0 < 0) x0 = 0;
+	if (y0 < 0) y0 = 0;
+	if (x1 >= (int) GridWidth) x1 = GridWidth - 1;
+	if (y1 >= (int) GridHeight) y1 = GridHeight - 1;
+	for (int y = y0; y <= y1; y++) {
+		for (int x = x0; x <= x1; x++) {
+			const std::vector<Actor*> &bucket = ActorGrid[y * GridWidth + x];
+			buffer.insert(buffer.end(), bucket.begin(), bucket.end());
+		}
+	}
+	std::sort(buffer.begin(), buffer.end(), LaterInArea);
+}
 
 Actor* Map::GetActor(const char* Name, int flags)
 {
@@ -1703,11 +1905,11 @@ Actor* Map::GetActorByScriptName(const char *name)
 
 int Map::GetActorInRect(Actor**& actorlist, Region& rgn, bool onlyparty)
 {
-	actorlist = ( Actor * * ) malloc( actors.size() * sizeof( Actor * ) );
+	GetActorsNear(rgn, NearActors);
+	actorlist = ( Actor * * ) malloc( NearActors.size() * sizeof( Actor * ) );
 	int count = 0;
-	size_t i = actors.size();
-	while (i--) {
-		Actor* actor = actors[i];
+	for (size_t i = 0; i < NearActors.size(); i++) {
+		Actor* actor = NearActors[i];
 //use this function only for party?
 		if (onlyparty && actor->GetStat(IE_EA)>EA_CHARMED) {
 			continue;
@@ -1799,6 +2001,51 @@ unsigned int Map::GetBlocked(const Point &c)
 //	1 - dither if polygon wants it
 //	2 - always dither
 
+void Map::SetWallGroups(unsigned int count, Wall_Polygon **walls)
+{
+	WallCount = count;
+	Walls = walls;
+
+	WallGridWidth = (Width*16 + WALL_GRID_SIZE - 1) / WALL_GRID_SIZE;
+	WallGridHeight = (Height*12 + WALL_GRID_SIZE - 1) / WALL_GRID_SIZE;
+	WallGrid.clear();
+	WallGrid.resize(WallGridWidth*WallGridHeight);
+	WallBounds.assign(count, Region());
+	WallStamps.assign(count, 0);
+	WallStamp = 0;
+	if (!WallGridWidth || !WallGridHeight) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < count; i++) {
+		Wall_Polygon *wp = walls[i];
+		if (!wp || !wp->count) {
+			continue;
+		}
+		//the bounding box in the file can't be trusted
+		int x1 = wp->points[0].x, y1 = wp->points[0].y;
+		int x2 = x1, y2 = y1;
+		for (unsigned int j = 1; j < wp->count; j++) {
+			x1 = MIN(x1, wp->points[j].x);
+			y1 = MIN(y1, wp->points[j].y);
+			x2 = MAX(x2, wp->points[j].x);
+			y2 = MAX(y2, wp->points[j].y);
+		}
+		//the rasterized edges may reach one pixel further
+		WallBounds[i] = Region(x1, y1, x2 - x1 + 2, y2 - y1 + 1);
+
+		int gx1 = MAX(x1, 0) / WALL_GRID_SIZE;
+		int gy1 = MAX(y1, 0) / WALL_GRID_SIZE;
+		int gx2 = MIN(MAX(x2 + 1, 0) / WALL_GRID_SIZE, WallGridWidth - 1);
+		int gy2 = MIN(MAX(y2, 0) / WALL_GRID_SIZE, WallGridHeight - 1);
+		for (int gy = gy1; gy <= gy2; gy++) {
+			for (int gx = gx1; gx <= gx2; gx++) {
+				WallGrid[gy*WallGridWidth + gx].push_back(i);
+			}
+		}
+	}
+}
+
 SpriteCover* Map::BuildSpriteCover(int x, int y, int xpos, int ypos,
 	unsigned int width, unsigned int height, int flags)
 {
@@ -1813,16 +2060,40 @@ SpriteCover* Map::BuildSpriteCover(int x, int y, int xpos, int ypos,
 	Video* video = core->GetVideoDriver();
 	video->InitSpriteCover(sc, flags);
 
-	unsigned int wpcount = GetWallCount();
-	unsigned int i;
+	if (!WallGridWidth || !WallGridHeight) {
+		return sc;
+	}
 
-	for (i = 0; i < wpcount; ++i)
-	{
-		Wall_Polygon* wp = GetWallGroup(i);
-		if (!wp) continue;
-		if (!wp->PointCovered(x, y)) continue;
+	//only the walls overlapping the sprite can cover it
+	Region area(x - xpos, y - ypos, width, height);
+	int gx1 = MIN(MAX(area.x, 0) / WALL_GRID_SIZE, WallGridWidth - 1);
+	int gy1 = MIN(MAX(area.y, 0) / WALL_GRID_SIZE, WallGridHeight - 1);
+	int gx2 = MIN(MAX(area.x + area.w, 0) / WALL_GRID_SIZE, WallGridWidth - 1);
+	int gy2 = MIN(MAX(area.y + area.h, 0) / WALL_GRID_SIZE, WallGridHeight - 1);
 
-		video->AddPolygonToSpriteCover(sc, wp);
+	if (!++WallStamp) {
+		WallStamps.assign(WallCount, 0);
+		WallStamp = 1;
+	}
+	for (int gy = gy1; gy <= gy2; gy++) {
+		for (int gx = gx1; gx <= gx2; gx++) {
+			const std::vector< unsigned int> &cell = WallGrid[gy*WallGridWidth + gx];
+			for (size_t i = 0; i < cell.size(); ++i) {
+				unsigned int idx = cell[i];
+				if (WallStamps[idx] == WallStamp) continue;
+				WallStamps[idx] = WallStamp;
+
+				const Region &bounds = WallBounds[idx];
+				if (bounds.x >= area.x + area.w || bounds.x + bounds.w <= area.x ||
+					bounds.y >= area.y + area.h || bounds.y + bounds.h <= area.y) {
+					continue;
+				}
+				Wall_Polygon* wp = Walls[idx];
+				if (!wp->PointCovered(x, y)) continue;
+
+				video->AddPolygonToSpriteCover(sc, wp);
+			}
+		}
 	}
 
 	return sc;
@@ -2082,6 +2353,7 @@ void Map::RemoveActor(Actor* actor)
 	while (i--) {
 		if (actors[i] == actor) {
 			ClearSearchMapFor(actor);
+			RemoveFromGrid(actor);
 			actors.erase( actors.begin()+i );
 			return;
 		}
@@ -2142,33 +2414,27 @@ void Map::DebugDump(bool show_actors) const
 
 /******************************************************************************/
 
-void Map::Leveldown(unsigned int px, unsigned int py,
-	unsigned int& level, Point &n, unsigned int& diff)
+void Map::NewSearch()
 {
-	int pos;
-	unsigned int nlevel;
-
-	if (( px >= Width ) || ( py >= Height )) {
-		return;
-	} //walked off the map
-	pos = py * Width + px;
-	nlevel = MapSet[pos];
-	if (!nlevel) {
-		return;
-	} //not even considered
-	if (level <= nlevel) {
-		return;
-	}
-	unsigned int ndiff = level - nlevel;
-	if (ndiff > diff) {
-		level = nlevel;
-		diff = ndiff;
-		n.x = (ieWord) px;
-		n.y = (ieWord) py;
+	SearchGeneration++;
+	if (!SearchGeneration) {
+		//wrapped around, stale stamps could match again
+		memset( MapSet, 0, Width * Height * sizeof( PathMapNode ) );
+		SearchGeneration = 1;
 	}
+	OpenList.clear();
+	while (InternalStack.size())
+		InternalStack.pop();
+}
+
+Point Map::GetParentNode(unsigned int x, unsigned int y) const
+{
+	unsigned char dir = MapSet[y * Width + x].parent;
+	return Point( (short) (x - PathDirX[dir]), (short) (y - PathDirY[dir]) );
 }
 
-void Map::SetupNode(unsigned int x, unsigned int y, unsigned int size, unsigned int Cost)
+//breadth first expansion (used by RunAway)
+void Map::SetupNode(unsigned int x, unsigned int y, unsigned int size, unsigned int Cost, unsigned char dir)
 {
 	unsigned int pos;
 
@@ -2176,17 +2442,131 @@ void Map::SetupNode(unsigned int x, unsigned int y, unsigned int size, unsigned
 		return;
 	}
 	pos = y * Width + x;
-	if (MapSet[pos]) {
+	PathMapNode &node = MapSet[pos];
+	if (node.stamp == SearchGeneration) {
 		return;
 	}
+	node.stamp = SearchGeneration;
+	node.parent = dir;
 	if (GetBlocked(x*16+8,y*12+6,size)) {
-		MapSet[pos] = 65535;
+		node.cost = 65535;
 		return;
 	}
-	MapSet[pos] = (ieWord) Cost;
+	node.cost = (ieWord) Cost;
 	InternalStack.push( ( x << 16 ) | y );
 }
 
+//A* expansion, range is the number of cells around the goal that are
+//acceptable, to keep the heuristic admissible
+void Map::OpenNode(unsigned int x, unsigned int y, unsigned int size, unsigned int Cost, unsigned char dir,
+	const Point &goal, unsigned int range)
+{
+	if (( x >= Width ) || ( y >= Height )) {
+		return;
+	}
+	unsigned int pos = y * Width + x;
+	PathMapNode &node = MapSet[pos];
+	if (node.stamp == SearchGeneration) {
+		//closed or blocked, or already reached more cheaply
+		if (node.closed || node.cost <= Cost) {
+			return;
+		}
+	} else {
+		node.stamp = SearchGeneration;
+		if (GetBlocked(x*16+8,y*12+6,size)) {
+			node.cost = 65535;
+			node.closed = 1;
+			return;
+		}
+	}
+	node.cost = (ieWord) Cost;
+	node.parent = dir;
+	node.closed = 0;
+
+	//a diagonal step is the cheapest, so the chebyshev distance is admissible
+	unsigned int dx = abs( (int) x - goal.x );
+	unsigned int dy = abs( (int) y - goal.y );
+	unsigned int h = dx > dy ? dx : dy;
+	h = h > range ? h - range : 0;
+
+	PathOpenNode open = { Cost + h * NormalCost, Cost, pos };
+	OpenList.push_back( open );
+	std::push_heap( OpenList.begin(), OpenList.end() );
+}
+
+bool Map::SearchPath(const Point &start, Point &goal, unsigned int size,
+	unsigned int MinDistance, const Point &d, bool sight)
+{
+	PROFILE_SCOPE(PROFILE_PATHFIND);
+	NewSearch();
+
+	unsigned int pos = start.y * Width + start.x;
+	unsigned int pos2 = goal.y * Width + goal.x;
+	PathMapNode &root = MapSet[pos];
+	root.stamp = SearchGeneration;
+	root.cost = 1;
+	root.parent = PATH_NO_PARENT;
+	root.closed = 0;
+	PathOpenNode open = { 1, 1, pos };
+	OpenList.push_back( open );
+
+	unsigned int squaredmindistance = MinDistance * MinDistance;
+	//searchmap cells are at least 12 pixels, don't overestimate
+	unsigned int range = MinDistance / 12;
+
+	while (OpenList.size()) {
+		std::pop_heap( OpenList.begin(), OpenList.end() );
+		PathOpenNode cur = OpenList.back();
+		OpenList.pop_back();
+
+		PathMapNode &node = MapSet[cur.pos];
+		if (node.closed || node.cost != cur.g) {
+			//a stale entry, the node was reached more cheaply since
+			continue;
+		}
+		node.closed = 1;
+
+		unsigned int x = cur.pos % Width;
+		unsigned int y = cur.pos / Width;
+		if (cur.pos == pos2) {
+			return true;
+		}
+		if (MinDistance) {
+			/* check minimum distance:
+			 * as an obvious optimisation we only check squared distance: this is a
+			 * possible overestimate since the sqrt Distance() rounds down
+			 * caller should have already done PersonalDistance adjustments, this is
+			 * simply between the specified points
+			 */
+			int distx = (x*16 + 8) - d.x;
+			int disty = (y*12 + 6) - d.y;
+			if ((unsigned int)(distx*distx + disty*disty) <= squaredmindistance) {
+				// we are within the minimum distance of the goal
+				Point ourpos(x*16 + 8, y*12 + 6);
+				// sight check is *slow* :(
+				if (!sight || IsVisible(ourpos, d)) {
+					goal = Point(x, y);
+					return true;
+				}
+			}
+		}
+
+		unsigned int Cost = cur.g + NormalCost;
+		if (Cost > 65500) {
+			// cost is far too high, don't expand this node
+			continue;
+		}
+		for (unsigned char dir = 0; dir < 8; dir++) {
+			// the first four are diagonal movements, the rest are direct ones
+			if (dir == 4) {
+				Cost += AdditionalCost;
+			}
+			OpenNode( x + PathDirX[dir], y + PathDirY[dir], size, Cost, dir, goal, range );
+		}
+	}
+	return false;
+}
+
 bool Map::AdjustPositionX(Point &goal, unsigned int radius)
 {
 	unsigned int minx = 0;
@@ -2278,25 +2658,27 @@ void Map::AdjustPosition(Point &goal, unsigned int radius)
 //run away from dX, dY (ie.: find the best path of limited length that brings us the farthest from dX, dY)
 PathNode* Map::RunAway(const Point &s, const Point &d, unsigned int size, unsigned int PathLen, int flags)
 {
+	PROFILE_SCOPE(PROFILE_PATHFIND);
 	Point start(s.x/16, s.y/12);
 	Point goal (d.x/16, d.y/12);
 	unsigned int dist;
 
-	//MapSet entries are made of 16 bits
+	//MapSet costs are made of 16 bits
 	if (PathLen>65535) {
 		PathLen = 65535;
 	}
 
-	memset( MapSet, 0, Width * Height * sizeof( unsigned short ) );
-	while (InternalStack.size())
-		InternalStack.pop();
+	NewSearch();
 
 	if (!( GetBlocked( start.x, start.y) & PATH_MAP_PASSABLE )) {
 		AdjustPosition( start );
 	}
 	unsigned int pos = ( start.x << 16 ) | start.y;
 	InternalStack.push( pos );
-	MapSet[start.y * Width + start.x] = 1;
+	PathMapNode &root = MapSet[start.y * Width + start.x];
+	root.stamp = SearchGeneration;
+	root.cost = 1;
+	root.parent = PATH_NO_PARENT;
 	dist = 0;
 	Point best = start;
 	while (InternalStack.size()) {
@@ -2313,21 +2695,17 @@ PathNode* Map::RunAway(const Point &s, const Point &d, unsigned int size, unsign
 			dist=distance;
 		}
 
-		unsigned int Cost = MapSet[y * Width + x] + NormalCost;
+		unsigned int Cost = MapSet[y * Width + x].cost + NormalCost;
 		if (Cost > PathLen) {
 			//print("Path not found!\n");
 			break;
 		}
-		SetupNode( x - 1, y - 1, size, Cost );
-		SetupNode( x + 1, y - 1, size, Cost );
-		SetupNode( x + 1, y + 1, size, Cost );
-		SetupNode( x - 1, y + 1, size, Cost );
-
-		Cost += AdditionalCost;
-		SetupNode( x, y - 1, size, Cost );
-		SetupNode( x + 1, y, size, Cost );
-		SetupNode( x, y + 1, size, Cost );
-		SetupNode( x - 1, y, size, Cost );
+		for (unsigned char dir = 0; dir < 8; dir++) {
+			if (dir == 4) {
+				Cost += AdditionalCost;
+			}
+			SetupNode( x + PathDirX[dir], y + PathDirY[dir], size, Cost, dir );
+		}
 	}
 
 	//find path backwards from best to start
@@ -2342,23 +2720,12 @@ PathNode* Map::RunAway(const Point &s, const Point &d, unsigned int size, unsign
 		StartNode->orient = GetOrient( best, start );
 	}
 	Point p = best;
-	unsigned int pos2 = start.y * Width + start.x;
-	while (( pos = p.y * Width + p.x ) != pos2) {
+	while (p != start) {
 		Return = new PathNode;
 		StartNode->Parent = Return;
 		Return->Next = StartNode;
 		StartNode = Return;
-		unsigned int level = MapSet[pos];
-		unsigned int diff = 0;
-		Point n;
-		Leveldown( p.x, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y, level, n, diff );
-		Leveldown( p.x - 1, p.y, level, n, diff );
-		Leveldown( p.x, p.y - 1, level, n, diff );
-		Leveldown( p.x - 1, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y - 1, level, n, diff );
-		Leveldown( p.x - 1, p.y - 1, level, n, diff );
+		Point n = GetParentNode( p.x, p.y );
 		Return->x = n.x;
 		Return->y = n.y;
 
@@ -2368,9 +2735,6 @@ PathNode* Map::RunAway(const Point &s, const Point &d, unsigned int size, unsign
 			Return->orient = GetOrient( n, p );
 		}
 		p = n;
-		if (!diff) {
-			break;
-		}
 	}
 	Return->Parent = NULL;
 	return Return;
@@ -2380,9 +2744,6 @@ bool Map::TargetUnreachable(const Point &s, const Point &d, unsigned int size)
 {
 	Point start( s.x/16, s.y/12 );
 	Point goal ( d.x/16, d.y/12 );
-	memset( MapSet, 0, Width * Height * sizeof( unsigned short ) );
-	while (InternalStack.size())
-		InternalStack.pop();
 
 	if (GetBlocked( d.x, d.y, size )) {
 		return true;
@@ -2390,28 +2751,11 @@ bool Map::TargetUnreachable(const Point &s, const Point &d, unsigned int size)
 	if (GetBlocked( s.x, s.y, size )) {
 		return true;
 	}
-
-	unsigned int pos = ( goal.x << 16 ) | goal.y;
-	unsigned int pos2 = ( start.x << 16 ) | start.y;
-	InternalStack.push( pos );
-	MapSet[goal.y * Width + goal.x] = 1;
-
-	while (InternalStack.size() && pos!=pos2) {
-		pos = InternalStack.front();
-		InternalStack.pop();
-		unsigned int x = pos >> 16;
-		unsigned int y = pos & 0xffff;
-
-		SetupNode( x - 1, y - 1, size, 1 );
-		SetupNode( x + 1, y - 1, size, 1 );
-		SetupNode( x + 1, y + 1, size, 1 );
-		SetupNode( x - 1, y + 1, size, 1 );
-		SetupNode( x, y - 1, size, 1 );
-		SetupNode( x + 1, y, size, 1 );
-		SetupNode( x, y + 1, size, 1 );
-		SetupNode( x - 1, y, size, 1 );
+	if (!Connected( s, d )) {
+		return true;
 	}
-	return pos!=pos2;
+
+	return !SearchPath( goal, start, size, 0, s, false );
 }
 
 /* Use this function when you target something by a straight line projectile (like a lightning bolt, arrow, etc)
@@ -2506,72 +2850,10 @@ PathNode* Map::FindPathNear(const Point &s, const Point &d, unsigned int size, u
 	Point goal ( d.x/16, d.y/12 );
 	Point orig_goal = goal;
 
-	// re-initialise the path finding structures
-	memset( MapSet, 0, Width * Height * sizeof( unsigned short ) );
-	while (InternalStack.size())
-		InternalStack.pop();
-
-	// set the start point in the path finding structures
-	unsigned int pos2 = ( goal.x << 16 ) | goal.y;
-	unsigned int pos = ( start.x << 16 ) | start.y;
-	InternalStack.push( pos );
-	MapSet[start.y * Width + start.x] = 1;
-
-	unsigned int squaredmindistance = MinDistance * MinDistance;
+	// a goal in range could still be reached from another region
 	bool found_path = false;
-	while (InternalStack.size()) {
-		pos = InternalStack.front();
-		InternalStack.pop();
-		unsigned int x = pos >> 16;
-		unsigned int y = pos & 0xffff;
-
-		if (pos == pos2) {
-			// we got all the way to the target!
-			found_path = true;
-			break;
-		} else if (MinDistance) {
-			/* check minimum distance:
-			 * as an obvious optimisation we only check squared distance: this is a
-			 * possible overestimate since the sqrt Distance() rounds down
-			 * (some other optimisations could be made here, but you'd be better off
-			 * fixing the pathfinder to do A* properly)
-			 * caller should have already done PersonalDistance adjustments, this is
-			 * simply between the specified points
-			 */
-
-			int distx = (x*16 + 8) - d.x;
-			int disty = (y*12 + 6) - d.y;
-			if ((unsigned int)(distx*distx + disty*disty) <= squaredmindistance) {
-				// we are within the minimum distance of the goal
-				Point ourpos(x*16 + 8, y*12 + 6);
-				// sight check is *slow* :(
-				if (!sight || IsVisible(ourpos, d)) {
-					// we got all the way to a suitable goal!
-					goal = Point(x, y);
-					found_path = true;
-					break;
-				}
-			}
-		}
-
-		unsigned int Cost = MapSet[y * Width + x] + NormalCost;
-		if (Cost > 65500) {
-			// cost is far too high, no path found
-			break;
-		}
-
-		// diagonal movements
-		SetupNode( x - 1, y - 1, size, Cost );
-		SetupNode( x + 1, y - 1, size, Cost );
-		SetupNode( x + 1, y + 1, size, Cost );
-		SetupNode( x - 1, y + 1, size, Cost );
-
-		// direct movements
-		Cost += AdditionalCost;
-		SetupNode( x, y - 1, size, Cost );
-		SetupNode( x + 1, y, size, Cost );
-		SetupNode( x, y + 1, size, Cost );
-		SetupNode( x - 1, y, size, Cost );
+	if (MinDistance || Connected( s, d )) {
+		found_path = SearchPath( start, goal, size, MinDistance, d, sight );
 	}
 
 	// find path from goal to start
@@ -2599,21 +2881,8 @@ PathNode* Map::FindPathNear(const Point &s, const Point &d, unsigned int size, u
 		StartNode->orient = GetOrient( goal, start );
 	}
 	Point p = goal;
-	pos2 = start.y * Width + start.x;
-	while (( pos = p.y * Width + p.x ) != pos2) {
-		unsigned int level = MapSet[pos];
-		unsigned int diff = 0;
-		Point n;
-		Leveldown( p.x, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y, level, n, diff );
-		Leveldown( p.x - 1, p.y, level, n, diff );
-		Leveldown( p.x, p.y - 1, level, n, diff );
-		Leveldown( p.x - 1, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y - 1, level, n, diff );
-		Leveldown( p.x - 1, p.y - 1, level, n, diff );
-		if (!diff)
-			return Return;
+	while (p != start) {
+		Point n = GetParentNode( p.x, p.y );
 
 		if (fixup_orient) {
 			// don't change orientation at end of path? this seems best
@@ -2634,48 +2903,31 @@ PathNode* Map::FindPathNear(const Point &s, const Point &d, unsigned int size, u
 	return Return;
 }
 
+static SlabAllocator pathNodeSlab("PathNode", sizeof(PathNode), PROFILE_ALLOC_PATHNODES, 1024);
+
+void* PathNode::operator new(size_t size)
+{
+	return pathNodeSlab.Alloc(size);
+}
+
+void PathNode::operator delete(void* node, size_t size)
+{
+	pathNodeSlab.Free(node, size);
+}
+
 PathNode* Map::FindPath(const Point &s, const Point &d, unsigned int size, int MinDistance)
 {
 	Point start( s.x/16, s.y/12 );
 	Point goal ( d.x/16, d.y/12 );
-	memset( MapSet, 0, Width * Height * sizeof( unsigned short ) );
-	while (InternalStack.size())
-		InternalStack.pop();
 
 	if (GetBlocked( d.x, d.y, size )) {
 		AdjustPosition( goal );
 	}
-	unsigned int pos = ( goal.x << 16 ) | goal.y;
-	unsigned int pos2 = ( start.x << 16 ) | start.y;
-	InternalStack.push( pos );
-	MapSet[goal.y * Width + goal.x] = 1;
-
-	while (InternalStack.size()) {
-		pos = InternalStack.front();
-		InternalStack.pop();
-		unsigned int x = pos >> 16;
-		unsigned int y = pos & 0xffff;
-
-		if (pos == pos2) {
-			//We've found _a_ path
-			//print("GOAL!!!\n");
-			break;
-		}
-		unsigned int Cost = MapSet[y * Width + x] + NormalCost;
-		if (Cost > 65500) {
-			//print("Path not found!\n");
-			break;
-		}
-		SetupNode( x - 1, y - 1, size, Cost );
-		SetupNode( x + 1, y - 1, size, Cost );
-		SetupNode( x + 1, y + 1, size, Cost );
-		SetupNode( x - 1, y + 1, size, Cost );
-
-		Cost += AdditionalCost;
-		SetupNode( x, y - 1, size, Cost );
-		SetupNode( x + 1, y, size, Cost );
-		SetupNode( x, y + 1, size, Cost );
-		SetupNode( x - 1, y, size, Cost );
+	//search backwards, so the parents lead from start to goal
+	Point target = start;
+	bool found_path = false;
+	if (Connected( s, Point(goal.x*16, goal.y*12) )) {
+		found_path = SearchPath( goal, target, size, 0, s, false );
 	}
 
 	//find path from start to goal
@@ -2686,29 +2938,16 @@ PathNode* Map::FindPath(const Point &s, const Point &d, unsigned int size, int M
 	StartNode->x = start.x;
 	StartNode->y = start.y;
 	StartNode->orient = GetOrient( goal, start );
-	if (pos != pos2) {
+	if (!found_path) {
 		return Return;
 	}
 	Point p = start;
-	pos2 = goal.y * Width + goal.x;
-	while (( pos = p.y * Width + p.x ) != pos2) {
+	while (p != goal) {
 		StartNode->Next = new PathNode;
 		StartNode->Next->Parent = StartNode;
 		StartNode = StartNode->Next;
 		StartNode->Next = NULL;
-		unsigned int level = MapSet[pos];
-		unsigned int diff = 0;
-		Point n;
-		Leveldown( p.x, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y, level, n, diff );
-		Leveldown( p.x - 1, p.y, level, n, diff );
-		Leveldown( p.x, p.y - 1, level, n, diff );
-		Leveldown( p.x - 1, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y - 1, level, n, diff );
-		Leveldown( p.x - 1, p.y - 1, level, n, diff );
-		if (!diff)
-			return Return;
+		Point n = GetParentNode( p.x, p.y );
 		StartNode->x = n.x;
 		StartNode->y = n.y;
 		StartNode->orient = GetOrient( n, p );
@@ -2733,6 +2972,160 @@ PathNode* Map::FindPath(const Point &s, const Point &d, unsigned int size, int M
 	return Return;
 }
 
+/* labels the 8-connected passable regions of a cluster */
+void Map::FloodCluster(unsigned int cx, unsigned int cy)
+{
+	unsigned int x0 = cx * PATH_CLUSTER_SIZE;
+	unsigned int y0 = cy * PATH_CLUSTER_SIZE;
+	unsigned int x1 = x0 + PATH_CLUSTER_SIZE;
+	unsigned int y1 = y0 + PATH_CLUSTER_SIZE;
+	if (x1 > Width) x1 = Width;
+	if (y1 > Height) y1 = Height;
+
+	unsigned int x, y;
+	for (y = y0; y < y1; y++) {
+		for (x = x0; x < x1; x++) {
+			unsigned int pos = y * Width + x;
+			RegionMap[pos] = StaticPassable(SrchMap[pos]) ? PATH_REGION_UNSET : 0;
+		}
+	}
+
+	unsigned int stack[PATH_CLUSTER_SIZE * PATH_CLUSTER_SIZE];
+	unsigned char count = 0;
+	for (y = y0; y < y1; y++) {
+		for (x = x0; x < x1; x++) {
+			if (RegionMap[y * Width + x] != PATH_REGION_UNSET) {
+				continue;
+			}
+			count++;
+			int top = 0;
+			stack[top++] = y * Width + x;
+			RegionMap[y * Width + x] = count;
+			while (top) {
+				unsigned int pos = stack[--top];
+				unsigned int px = pos % Width;
+				unsigned int py = pos / Width;
+				for (unsigned char dir = 0; dir < 8; dir++) {
+					unsigned int nx = px + PathDirX[dir];
+					unsigned int ny = py + PathDirY[dir];
+					if (nx < x0 || nx >= x1 || ny < y0 || ny >= y1) {
+						continue;
+					}
+					unsigned int npos = ny * Width + nx;
+					if (RegionMap[npos] == PATH_REGION_UNSET) {
+						RegionMap[npos] = count;
+						stack[top++] = npos;
+					}
+				}
+			}
+		}
+	}
+	ClusterRegions[cy * ClusterWidth + cx] = count;
+}
+
+unsigned int Map::GetRegion(unsigned int x, unsigned int y) const
+{
+	unsigned int local = RegionMap[y * Width + x];
+	if (!local) {
+		return 0;
+	}
+	unsigned int cluster = (y / PATH_CLUSTER_SIZE) * ClusterWidth + x / PATH_CLUSTER_SIZE;
+	return cluster * PATH_CLUSTER_REGIONS + local;
+}
+
+static unsigned int FindComponent(std::vector<unsigned int> &parents, unsigned int region)
+{
+	while (parents[region] != region) {
+		parents[region] = parents[parents[region]];
+		region = parents[region];
+	}
+	return region;
+}
+
+static void LinkRegions(std::vector<unsigned int> &parents, unsigned int a, unsigned int b)
+{
+	a = FindComponent(parents, a);
+	b = FindComponent(parents, b);
+	if (a != b) {
+		parents[b] = a;
+	}
+}
+
+/* refloods the clusters changed since the last call, then reconnects the
+ * regions through the cluster borders */
+void Map::UpdateRegions()
+{
+	if (!RegionsDirty) {
+		return;
+	}
+	unsigned int cx, cy, x, y;
+	int d;
+	for (cy = 0; cy < ClusterHeight; cy++) {
+		for (cx = 0; cx < ClusterWidth; cx++) {
+			unsigned int cluster = cy * ClusterWidth + cx;
+			if (DirtyClusters[cluster]) {
+				FloodCluster(cx, cy);
+				DirtyClusters[cluster] = 0;
+			}
+			unsigned int base = cluster * PATH_CLUSTER_REGIONS;
+			for (unsigned int i = 1; i <= ClusterRegions[cluster]; i++) {
+				RegionComponent[base + i] = base + i;
+			}
+		}
+	}
+
+	// vertical borders (diagonal steps over corners included)
+	for (x = PATH_CLUSTER_SIZE - 1; x + 1 < Width; x += PATH_CLUSTER_SIZE) {
+		for (y = 0; y < Height; y++) {
+			unsigned int a = GetRegion(x, y);
+			if (!a) continue;
+			for (d = -1; d <= 1; d++) {
+				if (y + d >= Height) continue;
+				unsigned int b = GetRegion(x + 1, y + d);
+				if (b) LinkRegions(RegionComponent, a, b);
+			}
+		}
+	}
+	// horizontal borders
+	for (y = PATH_CLUSTER_SIZE - 1; y + 1 < Height; y += PATH_CLUSTER_SIZE) {
+		for (x = 0; x < Width; x++) {
+			unsigned int a = GetRegion(x, y);
+			if (!a) continue;
+			for (d = -1; d <= 1; d++) {
+				if (x + d >= Width) continue;
+				unsigned int b = GetRegion(x + d, y + 1);
+				if (b) LinkRegions(RegionComponent, a, b);
+			}
+		}
+	}
+
+	// flatten, so lookups are a single load
+	for (unsigned int cluster = 0; cluster < ClusterWidth * ClusterHeight; cluster++) {
+		unsigned int base = cluster * PATH_CLUSTER_REGIONS;
+		for (unsigned int i = 1; i <= ClusterRegions[cluster]; i++) {
+			RegionComponent[base + i] = FindComponent(RegionComponent, base + i);
+		}
+	}
+	RegionsDirty = false;
+}
+
+bool Map::Connected(const Point &s, const Point &d)
+{
+	unsigned int sx = s.x/16, sy = s.y/12;
+	unsigned int dx = d.x/16, dy = d.y/12;
+	if (sx >= Width || sy >= Height || dx >= Width || dy >= Height) {
+		return true;
+	}
+	UpdateRegions();
+	unsigned int a = GetRegion(sx, sy);
+	unsigned int b = GetRegion(dx, dy);
+	if (!a || !b) {
+		// can't tell from an impassable cell, let the pathfinder decide
+		return true;
+	}
+	return RegionComponent[a] == RegionComponent[b];
+}
+
 //single point visible or not (visible/exploredbitmap)
 //if explored = true then explored otherwise currently visible
 bool Map::IsVisible(const Point &pos, int explored)
@@ -3011,6 +3404,7 @@ int Map::GetExploredMapSize() const
 void Map::Explore(int setreset)
 {
 	memset (ExploredBitmap, setreset, GetExploredMapSize() );
+	FogDirty = true;
 }
 
 void Map::SetMapVisibility(int setreset)
@@ -3040,8 +3434,17 @@ void Map::ExploreTile(const Point &pos)
 }
 
 void Map::ExploreMapChunk(const Point &Pos, int range, int los)
+{
+	CastVision(Pos, range, los, NULL);
+	//these cells are visible only until the next UpdateFog
+	FogDirty = true;
+}
+
+void Map::CastVision(const Point &Pos, int range, int los, std::vector< unsigned int> *cells)
 {
 	Point Tile;
+	int w = TMap->XCellCount * 2 + LargeFog;
+	int h = TMap->YCellCount * 2 + LargeFog;
 
 	if (range>MaxVisibility) {
 		range=MaxVisibility;
@@ -3073,34 +3476,99 @@ void Map::ExploreMapChunk(const Point &Pos, int range, int los)
 				}
 			}
 			ExploreTile(Tile);
+			if (cells) {
+				//the same cell as in ExploreTile
+				int x = Tile.x/32;
+				int y = Tile.y/32;
+				if (x >= 0 && x < w && y >= 0 && y < h) {
+					cells->push_back(y * w + x);
+				}
+			}
 		}
 	}
+	if (cells) {
+		//the rays overlap a lot near the center
+		std::sort(cells->begin(), cells->end());
+		cells->erase(std::unique(cells->begin(), cells->end()), cells->end());
+	}
+}
+
+void Map::RevealCells(const std::vector< unsigned int> &cells)
+{
+	for (size_t i = 0; i < cells.size(); i++) {
+		int by = cells[i]/8;
+		int bi = 1<<(cells[i]%8);
+		ExploredBitmap[by] |= bi;
+		VisibleBitmap[by] |= bi;
+	}
 }
 
+//VisibleBitmap is rebuilt only if an explore actor moved, came, left or
+//its sight changed; only those cast their vision again, the others reveal
+//the cells they saw the last time
 void Map::UpdateFog()
 {
-	if (!(core->FogOfWar&FOG_DRAWFOG) ) {
+	PROFILE_SCOPE(PROFILE_FOGUPDATE);
+	bool drawfog = (core->FogOfWar&FOG_DRAWFOG) != 0;
+	if (!drawfog) {
 		SetMapVisibility( -1 );
 		Explore(-1);
-	} else {
-		SetMapVisibility( 0 );
+		FogSources.clear();
+		FogDirty = true;
 	}
 
+	std::vector< FogSource> sources;
+	bool changed = FogDirty;
+	size_t kept = 0;
 	for (unsigned int e = 0; e<actors.size(); e++) {
 		Actor *actor = actors[e];
 		if (!actor->Modified[ IE_EXPLORE ] ) continue;
-		if (core->FogOfWar&FOG_DRAWFOG) {
+		if (drawfog) {
 			int state = actor->Modified[IE_STATE_ID];
 			if (state & STATE_CANTSEE) continue;
 			int vis2 = actor->Modified[IE_VISUALRANGE];
 			if ((state&STATE_BLIND) || (vis2<2)) vis2=2; //can see only themselves
-			ExploreMapChunk (actor->Pos, vis2+actor->GetAnims()->GetCircleSize(), 1);
+
+			sources.push_back(FogSource());
+			FogSource &src = sources.back();
+			src.actor = actor;
+			src.Pos = actor->Pos;
+			src.range = vis2+actor->GetAnims()->GetCircleSize();
+			src.cast = true;
+			for (size_t i = 0; i < FogSources.size(); i++) {
+				FogSource &old = FogSources[i];
+				if (old.actor == actor && old.Pos.x == src.Pos.x && old.Pos.y == src.Pos.y && old.range == src.range) {
+					src.cells.swap(old.cells);
+					src.cast = false;
+					kept++;
+					break;
+				}
+			}
+			if (src.cast) {
+				changed = true;
+			}
 		}
 		Spawn *sp = GetSpawnRadius(actor->Pos, SPAWN_RANGE); //30 * 12
 		if (sp) {
 			TriggerSpawn(sp);
 		}
 	}
+	if (!drawfog) {
+		return;
+	}
+
+	if (changed || kept != FogSources.size()) {
+		SetMapVisibility( 0 );
+		for (size_t i = 0; i < sources.size(); i++) {
+			if (sources[i].cast) {
+				CastVision(sources[i].Pos, sources[i].range, 1, &sources[i].cells);
+			} else {
+				RevealCells(sources[i].cells);
+			}
+		}
+		FogDirty = false;
+	}
+	FogSources.swap(sources);
 }
 
 //Valid values are - PATH_MAP_FREE, PATH_MAP_PC, PATH_MAP_NPC
@@ -3682,7 +4150,17 @@ void Map::SetInternalSearchMap(int x, int y, int value) {
 	if ((unsigned)x >= Width || (unsigned)y >= Height) {
 		return;
 	}
-	SrchMap[x+y*Width] = value;
+	unsigned int pos = x+y*Width;
+	if (StaticPassable(SrchMap[pos]) != StaticPassable(value)) {
+		//doors changed the connectivity, patch the cluster on next use
+		DirtyClusters[(y/PATH_CLUSTER_SIZE)*ClusterWidth + x/PATH_CLUSTER_SIZE] = 1;
+		RegionsDirty = true;
+	}
+	if ((SrchMap[pos] ^ value) & (PATH_MAP_NO_SEE|PATH_MAP_SIDEWALL|PATH_MAP_DOOR_OPAQUE)) {
+		//the line of sight changed, everyone has to look again
+		FogSources.clear();
+	}
+	SrchMap[pos] = value;
 }
 
 void Map::SetBackground(const ieResRef &bgResRef, ieDword duration) {
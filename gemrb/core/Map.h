@@ -29,6 +29,7 @@ class Map;
 #include "Bitmap.h"
 #include "Image.h"
 #include "IniSpawn.h"
+#include "PathFinder.h"
 #include "SpriteCover.h"
 #include "Scriptable/Scriptable.h"
 
@@ -40,7 +41,6 @@ class Animation;
 class AnimationFactory;
 class GameControl;
 class Particles;
-struct PathNode;
 class Projectile;
 class ScriptedAnimation;
 class TileMap;
@@ -94,6 +94,11 @@ class Wall_Polygon;
 #define SPARKLE_EXPLOSION 2  //not in the original engine
 #define SPARKLE_SHOWER    3
 
+//size of the actor spatial index buckets in pixels
+#define ACTOR_GRID_SIZE   128
+//size of the wall polygon index cells in pixels
+#define WALL_GRID_SIZE    256
+
 //in areas 10 is a magic number for resref counts
 #define MAX_RESCOUNT 10
 
@@ -252,14 +257,36 @@ private:
 	ieStrRef trackString;
 	int trackFlag;
 	ieWord trackDiff;
-	unsigned short* MapSet;
+	PathMapNode* MapSet;
+	unsigned int SearchGeneration;
 	unsigned short* SrchMap; //internal searchmap
 	std::queue< unsigned int> InternalStack;
+	std::vector< PathOpenNode> OpenList;
+	//static connectivity of the searchmap (doors included, actors ignored)
+	unsigned char* RegionMap; //region of each cell, unique within its cluster
+	unsigned char* ClusterRegions; //number of regions in each cluster
+	unsigned char* DirtyClusters;
+	std::vector< unsigned int> RegionComponent;
+	unsigned int ClusterWidth, ClusterHeight;
+	bool RegionsDirty;
 	unsigned int Width, Height;
 	std::list< AreaAnimation*> animations;
 	std::vector< Actor*> actors;
+	//spatial index of the actors
+	std::vector< std::vector< Actor*> > ActorGrid;
+	unsigned int GridWidth, GridHeight;
+	unsigned int GridOrderCounter;
+	int MaxActorSize;
+	std::vector< Actor*> NearActors; //reusable buffer of the queries
 	Wall_Polygon **Walls;
 	unsigned int WallCount;
+	//grid of the wall polygons (by their bounds) for BuildSpriteCover
+	std::vector< std::vector< unsigned int> > WallGrid;
+	std::vector< Region> WallBounds;
+	unsigned int WallGridWidth, WallGridHeight;
+	//a wall is visited only once per query, as it can be in many cells
+	std::vector< unsigned int> WallStamps;
+	unsigned int WallStamp;
 	std::list< ScriptedAnimation*> vvcCells;
 	std::list< Projectile*> projectiles;
 	std::list< Particles*> particles;
@@ -270,6 +297,17 @@ private:
 	Actor** queue[QUEUE_COUNT];
 	int Qcount[QUEUE_COUNT];
 	unsigned int lastActorCount[QUEUE_COUNT];
+	//the explore actors of the last UpdateFog and the fog cells they saw
+	struct FogSource {
+		Actor *actor;
+		Point Pos;
+		int range;
+		bool cast;
+		std::vector< unsigned int> cells;
+	};
+	std::vector< FogSource> FogSources;
+	//the visible cells were changed outside UpdateFog
+	bool FogDirty;
 public:
 	Map(void);
 	~Map(void);
@@ -287,6 +325,8 @@ public:
 	void AddTileMap(TileMap* tm, Image* lm, Bitmap* sr, Sprite2D* sm, Bitmap* hm);
 	void UpdateScripts();
 	void ResolveTerrainSound(ieResRef &sound, Point &pos);
+	/* loads the ambients and the footsteps of the actors ahead of their use */
+	void PreloadSounds();
 	bool DoStepForActor(Actor *actor, int speed, ieDword time);
 	void UpdateEffects();
 	/* removes empty heaps and returns total itemcount */
@@ -314,11 +354,8 @@ public:
 
 	unsigned int GetWallCount() { return WallCount; }
 	Wall_Polygon *GetWallGroup(int i) { return Walls[i]; }
-	void SetWallGroups(unsigned int count, Wall_Polygon **walls)
-	{
-		WallCount = count;
-		Walls = walls;
-	}
+	/* takes the wall polygons and indexes them for BuildSpriteCover */
+	void SetWallGroups(unsigned int count, Wall_Polygon **walls);
 	SpriteCover* BuildSpriteCover(int x, int y, int xpos, int ypos,
 		unsigned int width, unsigned int height, int flag);
 	void ActivateWallgroups(unsigned int baseindex, unsigned int count, int flg);
@@ -337,6 +374,14 @@ public:
 	Actor* GetActor(const Point &p, int flags);
 	Actor* GetActorInRadius(const Point &p, int flags, unsigned int radius);
 	Actor **GetAllActorsInRadius(const Point &p, int flags, unsigned int radius);
+	/* collects the actors that may be within radius of p (or may cover p),
+	 * in the order of the actor list (last first), the caller has to do the
+	 * exact distance checks */
+	void GetActorsNear(const Point &p, unsigned int radius, std::vector<Actor*> &buffer);
+	/* the same for the actors around the rectangle */
+	void GetActorsNear(const Region &rgn, std::vector<Actor*> &buffer);
+	/* updates the spatial index after the actor changed its position */
+	void ActorMoved(Actor *actor);
 	Actor* GetActor(const char* Name, int flags);
 	Actor* GetActor(int i, bool any);
 	Actor* GetActorByDialog(const char* resref);
@@ -417,6 +462,9 @@ public:
 	PathNode* RunAway(const Point &s, const Point &d, unsigned int size, unsigned int PathLen, int flags);
 	/* Returns true if there is no path to d */
 	bool TargetUnreachable(const Point &s, const Point &d, unsigned int size);
+	/* returns false if there is surely no path from s to d, doors are
+	 * considered, but not actors, so true doesn't mean there is a path */
+	bool Connected(const Point &s, const Point &d);
 	/* returns true if there is enemy visible */
 	bool AnyPCSeesEnemy();
 	/* Finds straight path from s, length l and orientation o, f=1 passes wall, f=2 rebounds from wall*/
@@ -481,19 +529,41 @@ private:
 	ScriptedAnimation *GetNextScriptedAnimation(scaIterator &iter);
 	Actor *GetNextActor(int &q, int &index);
 	void DrawSearchMap(const Region &screen);
+	/* explores the fog cells in range, and lists them if cells is given */
+	void CastVision(const Point &Pos, int range, int los, std::vector< unsigned int> *cells);
+	/* makes the listed fog cells explored and visible */
+	void RevealCells(const std::vector< unsigned int> &cells);
 	void GenerateQueues();
 	void SortQueues();
 	//Actor* GetRoot(int priority, int &index);
 	void DeleteActor(int i);
-	void Leveldown(unsigned int px, unsigned int py, unsigned int& level,
-		Point &p, unsigned int& diff);
-	void SetupNode(unsigned int x, unsigned int y, unsigned int size, unsigned int Cost);
+	/* invalidates the pathfinder state of the previous search */
+	void NewSearch();
+	void SetupNode(unsigned int x, unsigned int y, unsigned int size, unsigned int Cost, unsigned char dir);
+	void OpenNode(unsigned int x, unsigned int y, unsigned int size, unsigned int Cost, unsigned char dir,
+		const Point &goal, unsigned int range);
+	/* A* search on the searchmap from start to goal (searchmap coordinates),
+	 * if MinDistance is set, the search also ends at the first node closer
+	 * to d than MinDistance (and in sight of it if requested) */
+	bool SearchPath(const Point &start, Point &goal, unsigned int size,
+		unsigned int MinDistance, const Point &d, bool sight);
+	/* returns the searchmap coordinate of the parent of the node at x, y */
+	Point GetParentNode(unsigned int x, unsigned int y) const;
+	/* region graph of the searchmap */
+	void FloodCluster(unsigned int cx, unsigned int cy);
+	void UpdateRegions();
+	unsigned int GetRegion(unsigned int x, unsigned int y) const;
 	//actor uses travel region
 	void UseExit(Actor *pc, InfoPoint *ip);
 	//separated position adjustment, so their order could be randomised */
 	bool AdjustPositionX(Point &goal, unsigned int radius);
 	bool AdjustPositionY(Point &goal, unsigned int radius);
 	void DrawPortal(InfoPoint *ip, int enable);
+	//spatial index
+	unsigned int GetGridBucket(const Point &p) const;
+	void AddToGrid(Actor *actor);
+	void RemoveFromGrid(Actor *actor);
+	void RefreshGrid();
 };
 
 #endif
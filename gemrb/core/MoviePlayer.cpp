@@ -20,12 +20,204 @@
 
 #include "MoviePlayer.h"
 
+#include "Audio.h"
+#include "Interface.h"
+#include "Video.h"
+
+#ifndef WIN32
+#include <time.h>
+#endif
+
+//pictures decoded ahead of the one on the screen
+#define MOVIE_QUEUE_FRAMES 8
+
 const TypeID MoviePlayer::ID = { "MoviePlayer" };
 
 MoviePlayer::MoviePlayer(void)
 {
+	queuedFrames = 0;
+	decoding = false;
+	cancelled = false;
 }
 
 MoviePlayer::~MoviePlayer(void)
 {
+	ClearQueue();
+}
+
+int MoviePlayer::Benchmark()
+{
+	printMessage("MoviePlayer", "Benchmarking is not supported by this movie player!\n", LIGHT_RED);
+	return -1;
+}
+
+bool MoviePlayer::DecodeFrame()
+{
+	return false;
+}
+
+void MoviePlayer::PresentFrame(char* /*data*/)
+{
+}
+
+static void SleepUsec(unsigned long usec)
+{
+#ifdef WIN32
+	Sleep(usec / 1000);
+#else
+	struct timespec ts;
+	ts.tv_sec = usec / 1000000;
+	ts.tv_nsec = (usec % 1000000) * 1000;
+	nanosleep(&ts, NULL);
+#endif
+}
+
+void MoviePlayer::DecodeThread(void *self)
+{
+	((MoviePlayer *) self)->Decode();
+}
+
+void MoviePlayer::Decode()
+{
+	while (true) {
+		queueLock.Lock();
+		while (queuedFrames >= MOVIE_QUEUE_FRAMES && !cancelled) {
+			queueSpace.Wait(queueLock);
+		}
+		bool stop = cancelled;
+		queueLock.Unlock();
+		if (stop || !DecodeFrame()) {
+			break;
+		}
+	}
+
+	MutexLock lock(queueLock);
+	decoding = false;
+	queueReady.Signal();
+}
+
+void MoviePlayer::QueueAudio(int stream, unsigned short bits, int channels,
+	const short* memory, int size, int samplerate)
+{
+	QueuedBuffer buf;
+	buf.audio = true;
+	buf.data = (char *) malloc(size);
+	memcpy(buf.data, memory, size);
+	buf.stream = stream;
+	buf.bits = bits;
+	buf.channels = channels;
+	buf.size = size;
+	buf.samplerate = samplerate;
+
+	MutexLock lock(queueLock);
+	queue.push_back(buf);
+	queueReady.Signal();
+}
+
+void MoviePlayer::QueueFrame(char *data)
+{
+	QueuedBuffer buf;
+	memset(&buf, 0, sizeof(buf));
+	buf.audio = false;
+	buf.data = data;
+
+	MutexLock lock(queueLock);
+	queue.push_back(buf);
+	queuedFrames++;
+	queueReady.Signal();
+}
+
+void MoviePlayer::ClearQueue()
+{
+	MutexLock lock(queueLock);
+	std::list<QueuedBuffer>::iterator it;
+	for (it = queue.begin(); it != queue.end(); ++it) {
+		free(it->data);
+	}
+	queue.clear();
+	queuedFrames = 0;
+}
+
+int MoviePlayer::PlayQueued(unsigned long frameLength)
+{
+	Audio *audio = core->GetAudioDrv();
+	Video *video = core->GetVideoDriver();
+	unsigned long start = 0, now;
+	unsigned int frame = 0, skipped = 0;
+	int ret = 0;
+
+	cancelled = false;
+	decoding = true;
+	bool threaded = decoder.Start(DecodeThread, this);
+	if (!threaded) {
+		printMessage("MoviePlayer", "Cannot start the decoder thread, decoding on the fly\n", YELLOW);
+		decoding = false;
+	}
+
+	while (true) {
+		if (video->PollMovieEvents()) {
+			ret = 1;
+			break;
+		}
+
+		queueLock.Lock();
+		if (!threaded && queue.empty()) {
+			queueLock.Unlock();
+			if (!DecodeFrame()) {
+				break;
+			}
+			continue;
+		}
+		while (queue.empty() && decoding) {
+			queueReady.Wait(queueLock);
+		}
+		if (queue.empty()) {
+			queueLock.Unlock();
+			break;
+		}
+		QueuedBuffer buf = queue.front();
+		queue.pop_front();
+		if (!buf.audio) {
+			queuedFrames--;
+			queueSpace.Signal();
+		}
+		queueLock.Unlock();
+
+		if (buf.audio) {
+			audio->QueueBuffer(buf.stream, buf.bits, buf.channels, (short *) buf.data, buf.size, buf.samplerate);
+			free(buf.data);
+			continue;
+		}
+
+		//the schedule starts with the first frame, so it doesn't drift
+		GetTimeUsec( now );
+		if (!start) {
+			start = now;
+		}
+		unsigned long due = start + frame * frameLength;
+		frame++;
+		if ((long) (now - due) > (long) frameLength) {
+			skipped++;
+		} else {
+			if ((long) (due - now) > 0) {
+				SleepUsec( due - now );
+			}
+			PresentFrame(buf.data);
+		}
+		free(buf.data);
+	}
+
+	queueLock.Lock();
+	cancelled = true;
+	queueSpace.Signal();
+	queueLock.Unlock();
+	if (threaded) {
+		decoder.Join();
+	}
+	ClearQueue();
+
+	if (skipped) {
+		printMessage("MoviePlayer", "Had to drop %u of %u video frame(s)\n", YELLOW, skipped, frame);
+	}
+	return ret;
 }
@@ -32,19 +32,64 @@
 #include "win32def.h"
 
 #include "Resource.h"
+#include "System/Threads.h"
+
+#include <list>
 
 /**
  * @class MoviePlayer
- * Abstract loader and player for videos
+ * Abstract loader and player for videos.
+ * The players can decode ahead on a worker thread (see PlayQueued), so a
+ * slow frame doesn't stall the presentation or the sound.
  */
 
 class GEM_EXPORT MoviePlayer : public Resource {
+private:
+	struct QueuedBuffer {
+		//sound buffers are played as soon as they come up
+		bool audio;
+		char *data;
+		int stream, bits, channels, size, samplerate;
+	};
+	std::list<QueuedBuffer> queue;
+	//the pictures in the queue
+	unsigned int queuedFrames;
+	bool decoding;
+	bool cancelled;
+	Mutex queueLock;
+	//the decoder waits on this for room in the queue
+	WaitCondition queueSpace;
+	//the main thread waits on this for a new buffer
+	WaitCondition queueReady;
+	Thread decoder;
+
+	static void DecodeThread(void *self);
+	void Decode();
+	void ClearQueue();
+protected:
+	/** decodes the next frame, handing its sound and picture to QueueAudio
+	 * and QueueFrame. Called on the decoder thread, returns false at the end */
+	virtual bool DecodeFrame();
+	/** shows a picture given to QueueFrame, on the main thread */
+	virtual void PresentFrame(char *data);
+	/** copies the samples, they are played on the main thread */
+	void QueueAudio(int stream, unsigned short bits, int channels,
+		const short* memory, int size, int samplerate);
+	/** takes ownership of the (malloced) picture */
+	void QueueFrame(char *data);
+	/** decodes ahead on a worker thread while showing a frame every
+	 * frameLength usec, late frames are dropped. Returns 1 if the movie
+	 * was skipped */
+	int PlayQueued(unsigned long frameLength);
 public:
 	static const TypeID ID;
 	MoviePlayer(void);
 	virtual ~MoviePlayer(void);
 	virtual int Play() = 0;
 	virtual void CallBackAtFrames(ieDword cnt, ieDword *frames, ieDword *strrefs) = 0;
+	/** decodes the whole movie as fast as possible, without showing or
+	 * playing it, and reports how long it took */
+	virtual int Benchmark();
 };
 
 #endif
@@ -20,6 +20,10 @@
 #ifndef PATHFINDER_H
 #define PATHFINDER_H
 
+#include "exports.h"
+
+#include <cstddef>
+
 //searchmap conversion bits
 
 enum {
@@ -41,12 +45,49 @@ enum {
 	PATH_MAP_NOTACTOR = (PATH_MAP_DOOR|PATH_MAP_AREAMASK)
 };
 
-struct PathNode {
+struct GEM_EXPORT PathNode {
 	PathNode* Parent;
 	PathNode* Next;
 	unsigned short x;
 	unsigned short y;
 	unsigned int orient;
+
+	// allocated from a slab (see Map.cpp), so the nodes of a path are adjacent
+	static void* operator new(size_t size);
+	static void operator delete(void* node, size_t size);
+};
+
+//the searchmap is split into clusters of this many cells in both directions
+//for the static connectivity (region) graph
+#define PATH_CLUSTER_SIZE 16
+//region ids of a single cluster (8-connected regions, so at most 64 are used)
+#define PATH_CLUSTER_REGIONS 256
+//passable cell of a cluster that is not flooded yet
+#define PATH_REGION_UNSET 255
+
+//no parent, this is where the search started
+#define PATH_NO_PARENT 0xff
+
+//bookkeeping of a searchmap cell, only valid if stamp matches the current
+//search generation, so the search map never needs to be cleared
+struct PathMapNode {
+	unsigned int stamp;
+	unsigned short cost;
+	unsigned char parent; //direction index leading back to the parent
+	unsigned char closed;
+};
+
+//open list entry of the A* search (lowest f first, then highest g)
+struct PathOpenNode {
+	unsigned int f;
+	unsigned int g;
+	unsigned int pos;
+
+	bool operator<(const PathOpenNode &o) const
+	{
+		if (f != o.f) return f > o.f;
+		return g < o.g;
+	}
 };
 
 #endif
@@ -0,0 +1,186 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "Prefetcher.h"
+
+#include "win32def.h"
+
+#include "System/MemoryStream.h"
+
+//the queued data is dropped (oldest first) above this
+#define PREFETCH_BUDGET (32*1024*1024)
+
+Prefetcher::Prefetcher()
+{
+	queuedBytes = 0;
+	quit = false;
+	if (!worker.Start(Run, this)) {
+		printMessage("Prefetcher", "Cannot start the worker thread, prefetching is disabled\n", YELLOW);
+	}
+}
+
+Prefetcher::~Prefetcher()
+{
+	mutex.Lock();
+	quit = true;
+	wakeup.Signal();
+	mutex.Unlock();
+	worker.Join();
+	Clear();
+}
+
+void Prefetcher::Run(void *self)
+{
+	((Prefetcher *) self)->Work();
+}
+
+void Prefetcher::Work()
+{
+	MutexLock lock(mutex);
+	while (true) {
+		Request *req = NULL;
+		std::list<Request*>::iterator it;
+		for (it = requests.begin(); it != requests.end(); ++it) {
+			if ((*it)->state == PF_PENDING) {
+				req = *it;
+				break;
+			}
+		}
+		if (quit) {
+			return;
+		}
+		if (!req) {
+			wakeup.Wait(mutex);
+			continue;
+		}
+
+		//while loading, the request is owned by this thread
+		req->state = PF_LOADING;
+		mutex.Unlock();
+		char *data = (char *) malloc(req->length);
+		if (data && req->source->Read(data, req->length) != (int) req->length) {
+			free(data);
+			data = NULL;
+		}
+		mutex.Lock();
+		req->data = data;
+		req->state = PF_DONE;
+		finished.Signal();
+	}
+}
+
+std::list<Prefetcher::Request*>::iterator Prefetcher::Find(const char *resref, SClass_ID type)
+{
+	std::list<Request*>::iterator it;
+	for (it = requests.begin(); it != requests.end(); ++it) {
+		if ((*it)->type == type && !strnicmp((*it)->resref, resref, 8)) {
+			break;
+		}
+	}
+	return it;
+}
+
+void Prefetcher::Release(Request *req)
+{
+	queuedBytes -= req->length;
+	delete req->source;
+	free(req->data);
+	delete req;
+}
+
+bool Prefetcher::IsQueued(const char *resref, SClass_ID type)
+{
+	MutexLock lock(mutex);
+	return Find(resref, type) != requests.end();
+}
+
+void Prefetcher::Queue(const char *resref, SClass_ID type, DataStream *stream)
+{
+	MutexLock lock(mutex);
+	unsigned long length = stream->Size();
+
+	std::list<Request*>::iterator it = requests.begin();
+	while (queuedBytes + length > PREFETCH_BUDGET && it != requests.end()) {
+		if ((*it)->state == PF_DONE) {
+			Release(*it);
+			it = requests.erase(it);
+		} else {
+			++it;
+		}
+	}
+	if (queuedBytes + length > PREFETCH_BUDGET) {
+		delete stream;
+		return;
+	}
+
+	Request *req = new Request();
+	strnlwrcpy(req->resref, resref, 8);
+	req->type = type;
+	req->source = stream;
+	req->data = NULL;
+	req->length = length;
+	req->state = PF_PENDING;
+	requests.push_back(req);
+	queuedBytes += length;
+	wakeup.Signal();
+}
+
+DataStream* Prefetcher::Take(const char *resref, SClass_ID type)
+{
+	MutexLock lock(mutex);
+	if (requests.empty()) {
+		return NULL;
+	}
+	std::list<Request*>::iterator it = Find(resref, type);
+	if (it == requests.end()) {
+		return NULL;
+	}
+	Request *req = *it;
+	while (req->state == PF_LOADING) {
+		finished.Wait(mutex);
+	}
+	requests.erase(it);
+	queuedBytes -= req->length;
+
+	//not read yet (or the read failed), the caller can read it just as well
+	DataStream *stream = req->source;
+	if (req->data) {
+		stream = new MemoryStream(req->source->originalfile, req->data, req->length);
+		strncpy(stream->filename, req->source->filename, sizeof(stream->filename));
+		delete req->source;
+	} else {
+		stream->Seek(0, GEM_STREAM_START);
+	}
+	delete req;
+	return stream;
+}
+
+void Prefetcher::Clear()
+{
+	MutexLock lock(mutex);
+	std::list<Request*>::iterator it = requests.begin();
+	while (it != requests.end()) {
+		while ((*it)->state == PF_LOADING) {
+			finished.Wait(mutex);
+		}
+		Release(*it);
+		it = requests.erase(it);
+	}
+}
@@ -0,0 +1,87 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+/**
+ * @file Prefetcher.h
+ * Declares Prefetcher, which reads resources into memory on a worker thread.
+ * @author The GemRB Project
+ */
+
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include "SClassID.h"
+#include "exports.h"
+#include "ie_types.h"
+
+#include "System/Threads.h"
+
+#include <list>
+
+class DataStream;
+
+/**
+ * @class Prefetcher
+ * Reads queued resource streams into memory in the background.
+ * The streams are looked up (and deleted) by the main thread, the worker
+ * thread only ever calls Read on them, so the resource sources don't
+ * have to be thread safe.
+ */
+
+class GEM_EXPORT Prefetcher {
+private:
+	enum { PF_PENDING, PF_LOADING, PF_DONE };
+	struct Request {
+		ieResRef resref;
+		SClass_ID type;
+		DataStream *source;
+		char *data;
+		unsigned long length;
+		int state;
+	};
+	std::list<Request*> requests;
+	//bytes of all the queued requests, read or not
+	unsigned long queuedBytes;
+	bool quit;
+	Mutex mutex;
+	//the worker waits on this for new requests
+	WaitCondition wakeup;
+	//the main thread waits on this for a request being read
+	WaitCondition finished;
+	Thread worker;
+
+	std::list<Request*>::iterator Find(const char *resref, SClass_ID type);
+	void Release(Request *req);
+	static void Run(void *self);
+	void Work();
+public:
+	Prefetcher();
+	~Prefetcher();
+
+	bool IsQueued(const char *resref, SClass_ID type);
+	/** takes ownership of the stream and starts reading it */
+	void Queue(const char *resref, SClass_ID type, DataStream *stream);
+	/** returns the queued stream (waiting for it if it is being read) or NULL */
+	DataStream* Take(const char *resref, SClass_ID type);
+	/** drops everything that was not taken yet */
+	void Clear();
+};
+
+#endif
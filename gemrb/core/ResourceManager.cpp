@@ -26,16 +26,19 @@
 #include "Compressor.h"
 #include "Interface.h"
 #include "PluginMgr.h"
+#include "Prefetcher.h"
 #include "Resource.h"
 #include "ResourceDesc.h"
 #include "ResourceSource.h"
 
 ResourceManager::ResourceManager()
 {
+	prefetcher = NULL;
 }
 
 ResourceManager::~ResourceManager()
 {
+	delete prefetcher;
 }
 
 bool ResourceManager::AddSource(const char *path, const char *description, PluginID type, int flags)
@@ -143,6 +146,15 @@ DataStream* ResourceManager::GetResource(const char* ResRef, SClass_ID type, boo
 		return str;
 	}
 
+	if (prefetcher) {
+		DataStream *ds = prefetcher->Take(ResRef, type);
+		if (ds) {
+			if (!silent)
+				printStatus("Prefetched", GREEN );
+			return ds;
+		}
+	}
+
 	for (size_t i = 0; i < searchPath.size(); i++) {
 		DataStream *ds = searchPath[i]->GetResource(ResRef, type);
 		if (ds) {
@@ -180,6 +192,19 @@ Resource* ResourceManager::GetResource(const char* ResRef, const TypeID *type, b
 	}
 
 	for (size_t j = 0; j < types.size(); j++) {
+		if (prefetcher) {
+			DataStream *str = prefetcher->Take(ResRef, types[j].GetKeyType());
+			if (str) {
+				Resource *res = types[j].Create(str);
+				if (res) {
+					if (!silent) {
+						print( "%s.%s...", ResRef, types[j].GetExt() );
+						printStatus( "Prefetched", GREEN );
+					}
+					return res;
+				}
+			}
+		}
 		for (size_t i = 0; i < searchPath.size(); i++) {
 			DataStream *str = searchPath[i]->GetResource(ResRef, types[j]);
 			if (str) {
@@ -202,6 +227,28 @@ Resource* ResourceManager::GetResource(const char* ResRef, const TypeID *type, b
 	return NULL;
 }
 
+void ResourceManager::Prefetch(const char* ResRef, SClass_ID type)
+{
+	if (ResRef[0] == '\0')
+		return;
+	//the cached copy is a plain file, nothing to gain there
+	if (cacheMap.get(ConstructFilename(ResRef, core->TypeExt(type))))
+		return;
+	if (!prefetcher) {
+		prefetcher = new Prefetcher();
+	} else if (prefetcher->IsQueued(ResRef, type)) {
+		return;
+	}
+
+	for (size_t i = 0; i < searchPath.size(); i++) {
+		DataStream *ds = searchPath[i]->GetResource(ResRef, type);
+		if (ds) {
+			prefetcher->Queue(ResRef, type, ds);
+			return;
+		}
+	}
+}
+
 FileStream *ResourceManager::OpenCacheFile(const char *filename) const
 {
 	const std::string *path = cacheMap.get(filename);
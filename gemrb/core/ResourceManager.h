@@ -36,6 +36,7 @@
 
 class FileStream;
 class DataStream;
+class Prefetcher;
 class Resource;
 class TypeID;
 
@@ -62,6 +63,8 @@ public:
 	DataStream* GetResource(const char* resname, SClass_ID type, bool silent = false) const;
 	/** Returns Resource object associated to given resource */
 	Resource* GetResource(const char* resname, const TypeID *type, bool silent = false) const;
+	/** Starts reading the resource in the background, GetResource picks it up */
+	void Prefetch(const char* resname, SClass_ID type);
 
 	// File cache functions
 	FileStream *OpenCacheFile(const char *filename) const;
@@ -78,6 +81,7 @@ private:
 	std::vector<Holder<ResourceSource> > searchPath;
 
 	HashMap<std::string> cacheMap;
+	Prefetcher *prefetcher;
 };
 
 #endif
@@ -349,6 +349,8 @@ Actor::Actor()
 	attackProjectile = NULL;
 	lastInit = 0;
 	roundTime = 0;
+	GridBucket = (unsigned int) -1;
+	GridOrder = 0;
 	modalTime = 0;
 	modalSpellLingering = 0;
 	panicMode = PANIC_NONE;
@@ -2258,6 +2260,71 @@ void Actor::RefreshEffects(EffectQueue *fx)
 			memcpy( PCStats->PreviousPortraitIcons, PCStats->PortraitIcons, sizeof(PCStats->PreviousPortraitIcons) );
 		}
 	}
+	SaveRefreshState();
+}
+
+/** called every tick, idle actors with only static effects are skipped */
+void Actor::RefreshEffectsIfChanged()
+{
+	if (NeedsRefresh()) {
+		RefreshEffects(NULL);
+		return;
+	}
+	//the rest of the cleanup calls are only undoing effects
+	CharAnimations* anims = GetAnims();
+	if (anims) {
+		anims->CheckColorMod();
+	}
+}
+
+void Actor::SaveRefreshState()
+{
+	memcpy( RefreshedBase, BaseStats, MAX_STATS * sizeof( ieDword ) );
+	memcpy( RefreshedModified, Modified, MAX_STATS * sizeof( ieDword ) );
+	for (int i = 0; i < 2; i++) {
+		int slot;
+		const CREItem *wield = inventory.GetUsedWeapon(i!=0, slot);
+		if (wield) {
+			memcpy( RefreshedWeapons[i], wield->ItemResRef, sizeof(ieResRef) );
+		} else {
+			RefreshedWeapons[i][0] = 0;
+		}
+	}
+	RefreshedEquipped = inventory.GetEquipped();
+	RefreshedHeader = inventory.GetEquippedHeader();
+}
+
+//the effects are only reapplied if they could change, or the stats they
+//were applied on (or the weapon used for the pc stats) were changed
+bool Actor::NeedsRefresh() const
+{
+	if (!(InternalFlags&IF_INITIALIZED)) {
+		return true;
+	}
+	if (!fxqueue.IsStable(core->GetGame()->GameTime)) {
+		return true;
+	}
+	//morale recovery depends on the game time
+	if (BaseStats[IE_CLASS] > 0 && BaseStats[IE_CLASS] <= (ieDword)classcount && Modified[IE_MORALERECOVERYTIME]) {
+		return true;
+	}
+	if (memcmp( RefreshedBase, BaseStats, MAX_STATS * sizeof( ieDword ) )) {
+		return true;
+	}
+	if (memcmp( RefreshedModified, Modified, MAX_STATS * sizeof( ieDword ) )) {
+		return true;
+	}
+	if (RefreshedEquipped != inventory.GetEquipped() || RefreshedHeader != inventory.GetEquippedHeader()) {
+		return true;
+	}
+	for (int i = 0; i < 2; i++) {
+		int slot;
+		const CREItem *wield = inventory.GetUsedWeapon(i!=0, slot);
+		if (strnicmp( RefreshedWeapons[i], wield?wield->ItemResRef:"", 8 )) {
+			return true;
+		}
+	}
+	return false;
 }
 
 // refresh stats on creatures (PC or NPC) with a valid class (not animals etc)
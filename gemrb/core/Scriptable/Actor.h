@@ -302,6 +302,9 @@ public:
 	ieDword lastInit;
 	bool no_more_steps;
 	int speed;
+	//spatial index of the area: bucket of the actor and its place in the actor list
+	unsigned int GridBucket;
+	unsigned int GridOrder;
 
 	PolymorphCache *polymorphCache; // fx_polymorph etc
 	WildSurgeSpellMods wildSurgeMods;
@@ -323,6 +326,12 @@ private:
 	char AttackStance;
 	/*The projectile bringing the current attack*/
 	Projectile* attackProjectile ;
+	//the state the last RefreshEffects was based on
+	ieDword RefreshedBase[MAX_STATS];
+	ieDword RefreshedModified[MAX_STATS];
+	ieResRef RefreshedWeapons[2];
+	int RefreshedEquipped;
+	int RefreshedHeader;
 	/** paint the actor itself. Called internally by Draw() */
 	void DrawActorSprite(const Region &screen, int cx, int cy, const Region& bbox,
 				 SpriteCover*& sc, Animation** anims,
@@ -338,6 +347,10 @@ private:
 	void CheckWeaponQuickSlot(unsigned int which);
 	/* helper for usability checks */
 	int CheckUsability(Item *item) const;
+	/* saves what RefreshEffects depends on */
+	void SaveRefreshState();
+	/* true if RefreshEffects would change something */
+	bool NeedsRefresh() const;
 	/* Set up all the missing stats on load time, or after level up */
 	void CreateDerivedStatsBG();
 	/* Set up all the missing stats on load time, or after level up */
@@ -376,6 +389,8 @@ public:
 	CharAnimations* GetAnims() const;
 	/** Re/Inits the Modified vector */
 	void RefreshEffects(EffectQueue *eqfx);
+	/** Calls RefreshEffects, unless it would give the same stats again */
+	void RefreshEffectsIfChanged();
 	/** gets saving throws */
 	void RollSaves();
 	/** returns a saving throw */
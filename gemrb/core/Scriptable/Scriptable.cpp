@@ -1877,6 +1877,7 @@ void Movable::FixPosition()
 	GetCurrentArea()->AdjustPosition(Pos);
 	Pos.x=Pos.x*16+8;
 	Pos.y=Pos.y*12+6;
+	area->ActorMoved(actor);
 }
 
 void Movable::WalkTo(const Point &Des, int distance)
@@ -1991,6 +1992,9 @@ void Movable::MoveTo(const Point &Des)
 	area->ClearSearchMapFor(this);
 	Pos = Des;
 	Destination = Des;
+	if (Type == ST_ACTOR) {
+		area->ActorMoved((Actor *) this);
+	}
 	if (BlocksSearchMap()) {
 		area->BlockSearchMap( Pos, size, IsPC()?PATH_MAP_PC:PATH_MAP_NPC);
 	}
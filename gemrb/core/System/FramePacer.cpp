@@ -0,0 +1,133 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "System/FramePacer.h"
+
+#include "globals.h"
+#include "win32def.h"
+
+#include <algorithm>
+#include <vector>
+
+#ifndef WIN32
+#include <sched.h>
+#include <time.h>
+#endif
+
+//the hybrid mode stops sleeping this early (usec), to absorb the timer slack
+#define PACE_SPIN_MARGIN 2000
+
+static void SleepUsec(unsigned long usec)
+{
+#ifdef WIN32
+	Sleep(usec / 1000);
+#else
+	struct timespec ts;
+	ts.tv_sec = usec / 1000000;
+	ts.tv_nsec = (usec % 1000000) * 1000;
+	nanosleep(&ts, NULL);
+#endif
+}
+
+static void YieldCPU()
+{
+#ifdef WIN32
+	SwitchToThread();
+#else
+	sched_yield();
+#endif
+}
+
+FramePacer::FramePacer()
+{
+	frameLength = 0;
+	nextFrame = 0;
+	lastFrame = 0;
+	mode = PACE_SLEEP;
+	sampleCount = 0;
+	samplePos = 0;
+}
+
+void FramePacer::SetRate(int fps, int mode)
+{
+	frameLength = fps > 0 ? 1000000 / fps : 0;
+	this->mode = mode;
+	nextFrame = 0;
+}
+
+void FramePacer::Wait()
+{
+	unsigned long now;
+	GetTimeUsec( now );
+
+	if (frameLength) {
+		//more than a frame behind (or the first frame): restart the schedule
+		long remaining = (long) (nextFrame - now);
+		if (!nextFrame || remaining < -(long) frameLength) {
+			nextFrame = now;
+			remaining = 0;
+		}
+		if (mode == PACE_HYBRID) {
+			if (remaining > PACE_SPIN_MARGIN) {
+				SleepUsec( remaining - PACE_SPIN_MARGIN );
+			}
+			do {
+				YieldCPU();
+				GetTimeUsec( now );
+			} while ((long) (nextFrame - now) > 0);
+		} else if (remaining > 0) {
+			SleepUsec( remaining );
+			GetTimeUsec( now );
+		}
+		nextFrame += frameLength;
+	}
+
+	if (lastFrame) {
+		samples[samplePos] = now - lastFrame;
+		samplePos = (samplePos + 1) % FRAME_SAMPLES;
+		if (sampleCount < FRAME_SAMPLES) {
+			sampleCount++;
+		}
+	}
+	lastFrame = now;
+}
+
+unsigned long FramePacer::GetFrameTime(int percentile) const
+{
+	if (!sampleCount) {
+		return 0;
+	}
+	std::vector<unsigned long> sorted(samples, samples + sampleCount);
+	unsigned int n = (sampleCount - 1) * percentile / 100;
+	std::nth_element(sorted.begin(), sorted.begin() + n, sorted.end());
+	return sorted[n];
+}
+
+double FramePacer::GetFPS() const
+{
+	unsigned long total = 0;
+	for (unsigned int i = 0; i < sampleCount; i++) {
+		total += samples[i];
+	}
+	if (!total) {
+		return 0.0;
+	}
+	return sampleCount * 1000000.0 / total;
+}
@@ -0,0 +1,70 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+/**
+ * @file FramePacer.h
+ * Declares FramePacer, which limits the frame rate of the video drivers.
+ * @author The GemRB Project
+ */
+
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include "exports.h"
+
+//frame times kept for the statistics
+#define FRAME_SAMPLES 128
+
+/** how FramePacer waits for the next frame */
+enum PaceMode {
+	PACE_SLEEP,  //sleeps, cheapest, but the frames jitter with the os timer
+	PACE_HYBRID  //sleeps most of the wait, then yields until the deadline
+};
+
+/**
+ * @class FramePacer
+ * Keeps the frames on a fixed schedule (or none, when uncapped) and
+ * records how long each frame took.
+ * The schedule is kept from frame to frame, so a late frame is followed
+ * by a shorter wait instead of shifting all the following ones.
+ */
+
+class GEM_EXPORT FramePacer {
+private:
+	//all in microseconds
+	unsigned long frameLength;
+	unsigned long nextFrame;
+	unsigned long lastFrame;
+	int mode;
+	unsigned long samples[FRAME_SAMPLES];
+	unsigned int sampleCount, samplePos;
+public:
+	FramePacer();
+	/** fps <= 0 means uncapped */
+	void SetRate(int fps, int mode);
+	/** waits until the next frame is due and starts it */
+	void Wait();
+	/** the given percentile (0-100) of the recent frame times, in microseconds */
+	unsigned long GetFrameTime(int percentile) const;
+	/** the average frame rate of the recent frames */
+	double GetFPS() const;
+};
+
+#endif
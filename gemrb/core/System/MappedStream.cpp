@@ -0,0 +1,189 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "System/MappedStream.h"
+
+#include "win32def.h"
+
+#include "Interface.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef WIN32
+struct MappedStream::Mapping {
+	int refcount;
+	const char* base;
+	unsigned long length;
+
+	bool Open(const char *name) {
+		HANDLE file = CreateFile(name, GENERIC_READ, FILE_SHARE_READ,
+			NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		length = GetFileSize(file, NULL);
+		if (length == 0xFFFFFFFF || !length) {
+			CloseHandle(file);
+			return false;
+		}
+		HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		CloseHandle(file);
+		if (!mapping)
+			return false;
+		//the view keeps the mapping object alive
+		base = (const char *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		return base != NULL;
+	}
+	void Close() {
+		UnmapViewOfFile(base);
+	}
+};
+#else
+struct MappedStream::Mapping {
+	int refcount;
+	const char* base;
+	unsigned long length;
+
+	bool Open(const char *name) {
+		int fd = open(name, O_RDONLY);
+		if (fd == -1)
+			return false;
+		struct stat st;
+		if (fstat(fd, &st) || !st.st_size) {
+			close(fd);
+			return false;
+		}
+		length = st.st_size;
+		void *addr = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		//the mapping stays valid after closing the descriptor
+		close(fd);
+		if (addr == MAP_FAILED)
+			return false;
+		base = (const char *) addr;
+		return true;
+	}
+	void Close() {
+		munmap((void *) base, length);
+	}
+};
+#endif
+
+MappedStream::MappedStream(Mapping* map, const char* data, unsigned long size)
+	: map(map), data(data)
+{
+	map->refcount++;
+	this->size = size;
+}
+
+MappedStream::~MappedStream()
+{
+	if (!--map->refcount) {
+		map->Close();
+		delete map;
+	}
+}
+
+MappedStream* MappedStream::OpenFile(const char* filename)
+{
+	Mapping* map = new Mapping();
+	map->refcount = 0;
+	if (!map->Open(filename)) {
+		delete map;
+		return NULL;
+	}
+
+	MappedStream* stream = new MappedStream(map, map->base, map->length);
+	ExtractFileFromPath(stream->filename, filename);
+	strncpy(stream->originalfile, filename, _MAX_PATH);
+	return stream;
+}
+
+DataStream* MappedStream::Clone()
+{
+	MappedStream* stream = new MappedStream(map, data, size + (Encrypted ? 2 : 0));
+	strncpy(stream->filename, filename, sizeof(filename));
+	strncpy(stream->originalfile, originalfile, _MAX_PATH);
+	return stream;
+}
+
+MappedStream* MappedStream::Slice(unsigned long startpos, unsigned long length)
+{
+	if (startpos + length > size) {
+		print("[Streams]: Invalid slice %ld+%ld of %s (limit: %ld)\n", startpos, length, filename, size);
+		return NULL;
+	}
+	MappedStream* stream = new MappedStream(map, data + startpos + (Encrypted ? 2 : 0), length);
+	strncpy(stream->filename, filename, sizeof(filename));
+	strncpy(stream->originalfile, originalfile, _MAX_PATH);
+	return stream;
+}
+
+int MappedStream::Read(void* dest, unsigned int length)
+{
+	//we don't allow partial reads anyway, so it isn't a problem that
+	//i don't adjust length here (partial reads are evil)
+	if (Pos+length>size ) {
+		return GEM_ERROR;
+	}
+
+	memcpy(dest, data + Pos + (Encrypted ? 2 : 0), length);
+	if (Encrypted) {
+		ReadDecrypted( dest, length );
+	}
+	Pos += length;
+	return length;
+}
+
+int MappedStream::Write(const void* /*src*/, unsigned int /*length*/)
+{
+	//the mapping is read only
+	return GEM_ERROR;
+}
+
+int MappedStream::Seek(int newpos, int type)
+{
+	switch (type) {
+		case GEM_CURRENT_POS:
+			Pos += newpos;
+			break;
+
+		case GEM_STREAM_START:
+			Pos = newpos;
+			break;
+
+		case GEM_STREAM_END:
+			Pos = size - newpos;
+			break;
+
+		default:
+			return GEM_ERROR;
+	}
+	//we went past the buffer
+	if (Pos>size) {
+		print("[Streams]: Invalid seek position: %ld (limit: %ld)\n", Pos, size);
+		return GEM_ERROR;
+	}
+	return GEM_OK;
+}
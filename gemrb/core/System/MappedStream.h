@@ -0,0 +1,61 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef MAPPEDSTREAM_H
+#define MAPPEDSTREAM_H
+
+#include "System/DataStream.h"
+
+#include "exports.h"
+
+/**
+ * @class MappedStream
+ * Read-only stream over a memory mapped file.
+ * The mapping is shared (and refcounted) between the stream, its clones
+ * and its slices, so resources can be handed out as views into an
+ * archive without any copying or file I/O.
+ */
+
+class GEM_EXPORT MappedStream : public DataStream
+{
+private:
+	struct Mapping;
+	Mapping* map;
+	const char* data;
+
+	MappedStream(Mapping* map, const char* data, unsigned long size);
+public:
+	~MappedStream();
+	DataStream* Clone();
+
+	int Read(void* dest, unsigned int length);
+	int Write(const void* src, unsigned int length);
+	int Seek(int pos, int startpos);
+
+	/** Returns a stream of the given part of this one, sharing the mapping */
+	MappedStream* Slice(unsigned long startpos, unsigned long size);
+	/** Direct access to the (unencrypted) contents, valid while the stream exists */
+	const char* GetData() const { return data; }
+public:
+	/** Maps the whole file, returns NULL if it is not possible */
+	static MappedStream* OpenFile(const char* filename);
+};
+
+#endif
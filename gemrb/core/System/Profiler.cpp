@@ -0,0 +1,193 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "System/Profiler.h"
+
+#include "globals.h"
+#include "win32def.h"
+
+#include "Video.h"
+#include "System/FileStream.h"
+#include "System/SlabAllocator.h"
+
+#include <cstdio>
+#include <cstring>
+
+//must be a power of two
+#define PROFILE_RING_SIZE 65536
+#define PROFILE_MAX_DEPTH 32
+//one pixel of the overlay is this many microseconds
+#define PROFILE_USEC_PER_PIXEL 100
+
+static const char* ZoneNames[PROFILE_ZONES] = {
+	"GameLoop", "GlobalTimer::Update", "Map::UpdateScripts",
+	"EffectQueue::ApplyAllEffects", "Pathfinding", "Map::UpdateFog",
+	"Map::DrawMap", "TileMap::DrawOverlays", "TileMap::DrawFogOfWar",
+	"GUIScript::RunFunction"
+};
+
+static const Color ZoneColors[PROFILE_ZONES] = {
+	{0x80,0x80,0x80,0xff}, {0xff,0xff,0x00,0xff}, {0xff,0x00,0x00,0xff},
+	{0xff,0x00,0xff,0xff}, {0x00,0xff,0xff,0xff}, {0x80,0x40,0x00,0xff},
+	{0x00,0x00,0xff,0xff}, {0x00,0xff,0x00,0xff}, {0x40,0x40,0x40,0xff},
+	{0xff,0x80,0x00,0xff}
+};
+
+static const char* CounterNames[PROFILE_COUNTERS] = {
+	"Sound cache hits", "Sound cache misses", "Sound cache evictions",
+	"Effect allocations", "Action allocations", "Trigger allocations",
+	"Object allocations", "Path node allocations", "Slabs allocated"
+};
+
+bool Profiler::Enabled = false;
+unsigned long Profiler::counts[PROFILE_COUNTERS];
+
+static ProfileSample* ring = NULL;
+static unsigned long ringWrite = 0;
+static int depth = 0;
+//time spent in child scopes, per nesting level
+static unsigned long childTime[PROFILE_MAX_DEPTH+1];
+//self time per zone: current frame, last frame, all frames
+static unsigned long frameTime[PROFILE_ZONES];
+static unsigned long lastFrameTime[PROFILE_ZONES];
+static unsigned long totalTime[PROFILE_ZONES];
+static unsigned long totalCalls[PROFILE_ZONES];
+static unsigned long frames = 0;
+
+void Profiler::Enable(int enable)
+{
+	if (enable && !ring) {
+		ring = (ProfileSample *) calloc(PROFILE_RING_SIZE, sizeof(ProfileSample));
+		memset(frameTime, 0, sizeof(frameTime));
+		memset(lastFrameTime, 0, sizeof(lastFrameTime));
+		memset(totalTime, 0, sizeof(totalTime));
+		memset(totalCalls, 0, sizeof(totalCalls));
+		memset(counts, 0, sizeof(counts));
+	}
+	depth = 0;
+	childTime[0] = 0;
+	Enabled = enable != 0;
+}
+
+unsigned long Profiler::Enter()
+{
+	unsigned long now;
+	GetTimeUsec( now );
+	depth++;
+	if (depth <= PROFILE_MAX_DEPTH) {
+		childTime[depth] = 0;
+	}
+	return now;
+}
+
+void Profiler::Leave(int zone, unsigned long start)
+{
+	unsigned long end;
+	GetTimeUsec( end );
+	unsigned long duration = end - start;
+
+	unsigned long self = duration;
+	if (depth <= PROFILE_MAX_DEPTH) {
+		self -= childTime[depth];
+	}
+	depth--;
+	if (depth >= 0 && depth <= PROFILE_MAX_DEPTH) {
+		childTime[depth] += duration;
+	} else if (depth < 0) {
+		//enabled in the middle of a scope
+		depth = 0;
+	}
+	frameTime[zone] += self;
+	totalTime[zone] += self;
+	totalCalls[zone]++;
+
+	ProfileSample& sample = ring[ringWrite & (PROFILE_RING_SIZE-1)];
+	sample.start = start;
+	sample.end = end;
+	sample.zone = (unsigned char) zone;
+	sample.depth = (unsigned char) depth;
+	ringWrite++;
+}
+
+void Profiler::EndFrame()
+{
+	if (!Enabled) return;
+	memcpy(lastFrameTime, frameTime, sizeof(frameTime));
+	memset(frameTime, 0, sizeof(frameTime));
+	frames++;
+}
+
+void Profiler::DrawOverlay(Video* video, int x, int y)
+{
+	if (!Enabled) return;
+	for (int i = 0; i < PROFILE_ZONES; i++) {
+		int w = (int) (lastFrameTime[i] / PROFILE_USEC_PER_PIXEL);
+		if (!w) continue;
+		video->DrawRect( Region(x, y, w, 10), ZoneColors[i] );
+		x += w;
+	}
+}
+
+void Profiler::PrintTotals()
+{
+	if (!Enabled || !frames) return;
+	for (int i = 0; i < PROFILE_ZONES; i++) {
+		if (!totalCalls[i]) continue;
+		printMessage("Profiler", "%-28s %8lu calls, %10lu usec, %6lu usec/frame\n", WHITE,
+			ZoneNames[i], totalCalls[i], totalTime[i], totalTime[i]/frames);
+	}
+	for (int i = 0; i < PROFILE_COUNTERS; i++) {
+		if (!counts[i]) continue;
+		printMessage("Profiler", "%-28s %8lu\n", WHITE, CounterNames[i], counts[i]);
+	}
+	SlabAllocator::PrintStats();
+}
+
+bool Profiler::WriteTrace(const char* filename)
+{
+	if (!ring) return false;
+
+	FileStream out;
+	if (!out.Create(filename)) {
+		printMessage("Profiler", "Cannot write trace to %s\n", LIGHT_RED, filename);
+		return false;
+	}
+
+	char line[256];
+	int len = snprintf(line, sizeof(line), "{\"traceEvents\":[\n");
+	out.Write(line, len);
+
+	unsigned long first = 0;
+	if (ringWrite > PROFILE_RING_SIZE) {
+		first = ringWrite - PROFILE_RING_SIZE;
+	}
+	for (unsigned long i = first; i < ringWrite; i++) {
+		const ProfileSample& sample = ring[i & (PROFILE_RING_SIZE-1)];
+		len = snprintf(line, sizeof(line),
+			"%s{\"name\":\"%s\",\"cat\":\"gemrb\",\"ph\":\"X\",\"ts\":%lu,\"dur\":%lu,\"pid\":1,\"tid\":1}\n",
+			i == first ? "" : ",", ZoneNames[sample.zone], sample.start, sample.end - sample.start);
+		out.Write(line, len);
+	}
+
+	len = snprintf(line, sizeof(line), "]}\n");
+	out.Write(line, len);
+	printMessage("Profiler", "Wrote %lu events to %s\n", WHITE, ringWrite - first, filename);
+	return true;
+}
@@ -0,0 +1,128 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+/**
+ * @file Profiler.h
+ * Declares Profiler, a very simple scoped timer for the hot paths.
+ * @author The GemRB Project
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "exports.h"
+
+class Video;
+
+/** the instrumented subsystems, keep ZoneNames in sync */
+enum ProfileZone {
+	PROFILE_GAMELOOP,
+	PROFILE_TIMER,
+	PROFILE_SCRIPTS,
+	PROFILE_EFFECTS,
+	PROFILE_PATHFIND,
+	PROFILE_FOGUPDATE,
+	PROFILE_DRAWMAP,
+	PROFILE_OVERLAYS,
+	PROFILE_FOGDRAW,
+	PROFILE_GUISCRIPT,
+	PROFILE_ZONES
+};
+
+/** event counters, keep CounterNames in sync */
+enum ProfileCounter {
+	PROFILE_SOUND_HITS,
+	PROFILE_SOUND_MISSES,
+	PROFILE_SOUND_EVICTIONS,
+	PROFILE_ALLOC_EFFECTS,
+	PROFILE_ALLOC_ACTIONS,
+	PROFILE_ALLOC_TRIGGERS,
+	PROFILE_ALLOC_OBJECTS,
+	PROFILE_ALLOC_PATHNODES,
+	PROFILE_ALLOC_SLABS,
+	PROFILE_COUNTERS
+};
+
+struct ProfileSample {
+	unsigned long start, end; //microseconds
+	unsigned char zone;
+	unsigned char depth;
+};
+
+/**
+ * @class Profiler
+ * Collects the timings of ProfileScopes into a ring buffer.
+ * Only the main thread records, so the ring needs no locking: the
+ * write position is only ever advanced by the owner.
+ * When disabled, a scope costs a single test of Profiler::Enabled.
+ */
+
+class GEM_EXPORT Profiler {
+public:
+	static bool Enabled;
+
+	/** turns recording on or off (config: Profile=1) */
+	static void Enable(int enable);
+	static unsigned long Enter();
+	static void Leave(int zone, unsigned long start);
+	/** adds to an event counter, does nothing when disabled */
+	static void Count(int counter, unsigned long n = 1)
+	{
+		if (Enabled) {
+			counts[counter] += n;
+		}
+	}
+	/** closes the current frame, its totals are shown by DrawOverlay */
+	static void EndFrame();
+	/** draws the self time of each zone in the last frame as a stacked bar */
+	static void DrawOverlay(Video* video, int x, int y);
+	/** prints the per zone totals and the counters since the profiler was enabled,
+	 * and the usage of the slab allocators */
+	static void PrintTotals();
+	/** writes the ring buffer as Chrome trace-event JSON (chrome://tracing) */
+	static bool WriteTrace(const char* filename);
+private:
+	static unsigned long counts[PROFILE_COUNTERS];
+};
+
+class ProfileScope {
+private:
+	int zone;
+	unsigned long start;
+public:
+	ProfileScope(int z)
+	{
+		zone = -1;
+		if (Profiler::Enabled) {
+			zone = z;
+			start = Profiler::Enter();
+		}
+	}
+	~ProfileScope()
+	{
+		if (zone >= 0) {
+			Profiler::Leave(zone, start);
+		}
+	}
+};
+
+#define PROFILE_SCOPE(zone) ProfileScope profile_scope(zone)
+
+#endif
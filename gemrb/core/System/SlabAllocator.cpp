@@ -0,0 +1,125 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "System/SlabAllocator.h"
+
+#include "win32def.h"
+
+#include "System/Profiler.h"
+
+#include <cstdlib>
+#include <new>
+
+//objects are aligned to this, the slab header is padded to it
+#define SLAB_ALIGN 16
+
+//all the allocators, for PrintStats
+static SlabAllocator* allocators = NULL;
+
+SlabAllocator::SlabAllocator(const char* name, size_t size, int counter, unsigned int perSlab)
+{
+	this->name = name;
+	this->size = (size + SLAB_ALIGN - 1) & ~(size_t) (SLAB_ALIGN - 1);
+	this->perSlab = perSlab;
+	this->counter = counter;
+	slabs = NULL;
+	freeList = NULL;
+	live = peak = slabCount = 0;
+	nextAllocator = allocators;
+	allocators = this;
+}
+
+//objects still alive at exit (in other static objects) keep their slabs
+SlabAllocator::~SlabAllocator()
+{
+	if (live) {
+		return;
+	}
+	while (slabs) {
+		Slab* next = slabs->next;
+		free(slabs);
+		slabs = next;
+	}
+	freeList = NULL;
+	slabCount = 0;
+}
+
+void SlabAllocator::Grow()
+{
+	Slab* slab = (Slab *) malloc(SLAB_ALIGN + perSlab * size);
+	if (!slab) {
+		printMessage("SlabAllocator", "Out of memory for %s\n", LIGHT_RED, name);
+		abort();
+	}
+	slab->next = slabs;
+	slabs = slab;
+	slabCount++;
+	Profiler::Count(PROFILE_ALLOC_SLABS);
+
+	//chained in address order, so consecutive allocations are adjacent
+	char* object = (char *) slab + SLAB_ALIGN + (perSlab - 1) * size;
+	for (unsigned int i = 0; i < perSlab; i++) {
+		FreeObject* fo = (FreeObject *) object;
+		fo->next = freeList;
+		freeList = fo;
+		object -= size;
+	}
+}
+
+void* SlabAllocator::Alloc(size_t size)
+{
+	Profiler::Count(counter);
+	if (size > this->size) {
+		return ::operator new(size);
+	}
+	if (!freeList) {
+		Grow();
+	}
+	FreeObject* fo = freeList;
+	freeList = fo->next;
+	if (++live > peak) {
+		peak = live;
+	}
+	return fo;
+}
+
+void SlabAllocator::Free(void* object, size_t size)
+{
+	if (!object) {
+		return;
+	}
+	if (size > this->size) {
+		::operator delete(object);
+		return;
+	}
+	FreeObject* fo = (FreeObject *) object;
+	fo->next = freeList;
+	freeList = fo;
+	live--;
+}
+
+void SlabAllocator::PrintStats()
+{
+	for (SlabAllocator* a = allocators; a; a = a->nextAllocator) {
+		if (!a->slabCount) continue;
+		printMessage("Profiler", "%-28s %8lu live, %8lu peak, %4lu slabs of %u\n", WHITE,
+			a->name, a->live, a->peak, a->slabCount, a->perSlab);
+	}
+}
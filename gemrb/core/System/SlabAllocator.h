@@ -0,0 +1,75 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+/**
+ * @file SlabAllocator.h
+ * Declares SlabAllocator, a pool of equally sized objects.
+ * @author The GemRB Project
+ */
+
+#ifndef SLABALLOCATOR_H
+#define SLABALLOCATOR_H
+
+#include "exports.h"
+
+#include <cstddef>
+
+/**
+ * @class SlabAllocator
+ * Hands out objects of a single type from big blocks (slabs), freed
+ * objects are kept on a list for reuse. The small, short lived gameplay
+ * objects (effects, script actions, path nodes) use it through their
+ * operator new, so they don't fragment the heap and stay close together.
+ * Slabs are only given back when nothing is allocated from them anymore
+ * at exit. Only the main thread may use it.
+ */
+
+class GEM_EXPORT SlabAllocator {
+private:
+	struct FreeObject {
+		FreeObject* next;
+	};
+	struct Slab {
+		Slab* next;
+	};
+
+	const char* name;
+	size_t size;
+	unsigned int perSlab;
+	int counter;
+	Slab* slabs;
+	FreeObject* freeList;
+	unsigned long live, peak, slabCount;
+	SlabAllocator* nextAllocator;
+
+	void Grow();
+public:
+	/** counter is the Profiler counter of the allocations */
+	SlabAllocator(const char* name, size_t size, int counter, unsigned int perSlab = 256);
+	~SlabAllocator();
+	/** bigger objects (of derived classes) come from the heap */
+	void* Alloc(size_t size);
+	void Free(void* object, size_t size);
+	unsigned long Live() const { return live; }
+	/** prints the usage of all the allocators */
+	static void PrintStats();
+};
+
+#endif
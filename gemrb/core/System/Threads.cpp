@@ -0,0 +1,173 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "System/Threads.h"
+
+#include <cassert>
+
+#ifdef WIN32
+
+Mutex::Mutex()
+{
+	InitializeCriticalSection(&cs);
+}
+
+Mutex::~Mutex()
+{
+	DeleteCriticalSection(&cs);
+}
+
+void Mutex::Lock()
+{
+	EnterCriticalSection(&cs);
+}
+
+void Mutex::Unlock()
+{
+	LeaveCriticalSection(&cs);
+}
+
+//an auto-reset event stays signalled until the waiter wakes up, so
+//there is no lost wakeup between unlocking the mutex and waiting
+WaitCondition::WaitCondition()
+{
+	event = CreateEvent(NULL, FALSE, FALSE, NULL);
+}
+
+WaitCondition::~WaitCondition()
+{
+	CloseHandle(event);
+}
+
+void WaitCondition::Wait(Mutex& mutex)
+{
+	mutex.Unlock();
+	WaitForSingleObject(event, INFINITE);
+	mutex.Lock();
+}
+
+void WaitCondition::Signal()
+{
+	SetEvent(event);
+}
+
+DWORD WINAPI Thread::Run(LPVOID self)
+{
+	Thread *thread = (Thread *) self;
+	thread->func(thread->arg);
+	return 0;
+}
+
+bool Thread::Start(ThreadFunc f, void *a)
+{
+	assert(!running);
+	func = f;
+	arg = a;
+	handle = CreateThread(NULL, 0, Run, this, 0, NULL);
+	running = handle != NULL;
+	return running;
+}
+
+void Thread::Join()
+{
+	if (!running) return;
+	WaitForSingleObject(handle, INFINITE);
+	CloseHandle(handle);
+	running = false;
+}
+
+#else
+
+Mutex::Mutex()
+{
+	pthread_mutex_init(&mutex, NULL);
+}
+
+Mutex::~Mutex()
+{
+	pthread_mutex_destroy(&mutex);
+}
+
+void Mutex::Lock()
+{
+	pthread_mutex_lock(&mutex);
+}
+
+void Mutex::Unlock()
+{
+	pthread_mutex_unlock(&mutex);
+}
+
+WaitCondition::WaitCondition()
+{
+	pthread_cond_init(&cond, NULL);
+}
+
+WaitCondition::~WaitCondition()
+{
+	pthread_cond_destroy(&cond);
+}
+
+void WaitCondition::Wait(Mutex& mutex)
+{
+	pthread_cond_wait(&cond, &mutex.mutex);
+}
+
+void WaitCondition::Signal()
+{
+	pthread_cond_signal(&cond);
+}
+
+void* Thread::Run(void *self)
+{
+	Thread *thread = (Thread *) self;
+	thread->func(thread->arg);
+	return NULL;
+}
+
+bool Thread::Start(ThreadFunc f, void *a)
+{
+	assert(!running);
+	func = f;
+	arg = a;
+	running = pthread_create(&handle, NULL, Run, this) == 0;
+	return running;
+}
+
+void Thread::Join()
+{
+	if (!running) return;
+	pthread_join(handle, NULL);
+	running = false;
+}
+
+#endif
+
+Thread::Thread()
+{
+	func = NULL;
+	arg = NULL;
+	running = false;
+}
+
+Thread::~Thread()
+{
+	assert(!running);
+}
@@ -0,0 +1,106 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+/**
+ * @file Threads.h
+ * Declares Mutex, MutexLock, WaitCondition and Thread, thin wrappers around
+ * the native threading primitives (so the core doesn't depend on SDL).
+ * @author The GemRB Project
+ */
+
+#ifndef THREADS_H
+#define THREADS_H
+
+#include "exports.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+class GEM_EXPORT Mutex {
+private:
+#ifdef WIN32
+	CRITICAL_SECTION cs;
+#else
+	pthread_mutex_t mutex;
+#endif
+	friend class WaitCondition;
+public:
+	Mutex();
+	~Mutex();
+	void Lock();
+	void Unlock();
+};
+
+/** locks the mutex for the lifetime of the object */
+class MutexLock {
+private:
+	Mutex& mutex;
+public:
+	MutexLock(Mutex& m) : mutex(m) { mutex.Lock(); }
+	~MutexLock() { mutex.Unlock(); }
+};
+
+/**
+ * @class WaitCondition
+ * Condition variable. Only a single thread may wait on it at a time
+ * and wakeups may be spurious, so always wait in a loop.
+ */
+
+class GEM_EXPORT WaitCondition {
+private:
+#ifdef WIN32
+	HANDLE event;
+#else
+	pthread_cond_t cond;
+#endif
+public:
+	WaitCondition();
+	~WaitCondition();
+	/** unlocks the (locked) mutex while waiting */
+	void Wait(Mutex& mutex);
+	void Signal();
+};
+
+class GEM_EXPORT Thread {
+public:
+	typedef void (*ThreadFunc)(void *arg);
+private:
+	ThreadFunc func;
+	void *arg;
+	bool running;
+#ifdef WIN32
+	HANDLE handle;
+	static DWORD WINAPI Run(LPVOID self);
+#else
+	pthread_t handle;
+	static void* Run(void *self);
+#endif
+public:
+	Thread();
+	/** the thread has to be joined before destruction */
+	~Thread();
+	bool Start(ThreadFunc func, void *arg);
+	void Join();
+};
+
+#endif
@@ -26,12 +26,14 @@
 #include "Scriptable/Container.h"
 #include "Scriptable/Door.h"
 #include "Scriptable/InfoPoint.h"
+#include "System/Profiler.h"
 
 TileMap::TileMap(void)
 {
 	XCellCount = 0;
 	YCellCount = 0;
 	LargeMap = !core->HasFeature(GF_SMALL_FOG);
+	fogW = fogH = 0;
 }
 
 TileMap::~TileMap(void)
@@ -207,6 +209,7 @@ void TileMap::AddRainOverlay(TileOverlay* overlay)
 
 void TileMap::DrawOverlays(Region screen, int rain)
 {
+	PROFILE_SCOPE(PROFILE_OVERLAYS);
 	if (rain) {
 		overlays[0]->Draw( screen, rain_overlays );
 	} else {
@@ -228,9 +231,175 @@ void TileMap::DrawOverlays(Region screen, int rain)
 
 #define FOG(i)  vid->BlitSprite( core->FogSprites[i], r.x, r.y, true, &r )
 
+// Cached state of a fog cell: the edge masks of the explored and visible
+//   areas (as described in DrawFogEdges) and two flags
+#define FOG_EXPLORED_EDGES 0x000f
+#define FOG_VISIBLE_SHIFT  4
+#define FOG_INVISIBLE      0x0100
+#define FOG_BLACK          0x0200
+
+static ieWord GetFogCode(const ieByte* explored_mask, const ieByte* visible_mask, int w, int h, int x, int y)
+{
+	// Unexplored tiles are all black
+	if (! IS_EXPLORED( x, y )) {
+		return FOG_BLACK;
+	}
+	int e = ! IS_EXPLORED( x, y - 1);
+	if (! IS_EXPLORED( x - 1, y )) e |= 2;
+	if (! IS_EXPLORED( x, y + 1 )) e |= 4;
+	if (! IS_EXPLORED( x + 1, y )) e |= 8;
+	//this is black too (the gray of invisibility doesn't show on it)
+	if (e == 15) {
+		return FOG_BLACK;
+	}
+
+	// Invisible tiles are all gray
+	if (! IS_VISIBLE( x, y )) {
+		return e | FOG_INVISIBLE;
+	}
+	int v = ! IS_VISIBLE( x, y - 1);
+	if (! IS_VISIBLE( x - 1, y )) v |= 2;
+	if (! IS_VISIBLE( x, y + 1 )) v |= 4;
+	if (! IS_VISIBLE( x + 1, y )) v |= 8;
+	//this is unseen too
+	if (v == 15) {
+		return e | FOG_INVISIBLE;
+	}
+	return e | (v << FOG_VISIBLE_SHIFT);
+}
+
+// If a tile is adjacent to an unexplored (or invisible) one, we draw
+//   border sprite (gradient black/gray <-> transparent)
+// Tiles in four cardinal directions have these
+//   values.
+//
+//      1
+//    2   8
+//      4
+//
+// Values of those unexplored are
+//   added together, the resulting number being
+//   an index of shadow sprite to use. For now,
+//   some tiles are made 'on the fly' by
+//   drawing two or more tiles
+// base is 0 for the explored and 16 for the visible sprites
+static void DrawFogEdges(Video* vid, int base, int e, const Region& r)
+{
+	switch (e) {
+	case 1:
+	case 2:
+	case 3:
+	case 4:
+	case 6:
+	case 8:
+	case 9:
+	case 12:
+		FOG( base + e );
+		break;
+	case 5:
+		FOG( base + 1 );
+		FOG( base + 4 );
+		break;
+	case 7:
+		FOG( base + 3 );
+		FOG( base + 6 );
+		break;
+	case 10:
+		FOG( base + 2 );
+		FOG( base + 8 );
+		break;
+	case 11:
+		FOG( base + 3 );
+		FOG( base + 9 );
+		break;
+	case 13:
+		FOG( base + 9 );
+		FOG( base + 12 );
+		break;
+	case 14:
+		FOG( base + 6 );
+		FOG( base + 12 );
+		break;
+	}
+}
+
+// Recomputes the cells around the bits that changed since the last call,
+//   and the black runs of their rows
+void TileMap::UpdateFogCells(ieByte* explored_mask, ieByte* visible_mask, int w, int h)
+{
+	int size = (w * h + 7) / 8;
+	int x, y;
+
+	if (!size) {
+		return;
+	}
+	if (w != fogW || h != fogH) {
+		fogW = w;
+		fogH = h;
+		fogCells.resize(w * h);
+		fogRuns.resize(w * h);
+		for (y = 0; y < h; y++) {
+			for (x = 0; x < w; x++) {
+				fogCells[y * w + x] = GetFogCode( explored_mask, visible_mask, w, h, x, y );
+			}
+		}
+		fogDirtyRows.assign(h, 1);
+	} else {
+		if (!memcmp( &fogExplored[0], explored_mask, size ) &&
+			!memcmp( &fogVisible[0], visible_mask, size )) {
+			return;
+		}
+		for (int i = 0; i < size; i++) {
+			int changed = (fogExplored[i] ^ explored_mask[i]) | (fogVisible[i] ^ visible_mask[i]);
+			if (!changed) {
+				continue;
+			}
+			for (int bit = 0; bit < 8; bit++) {
+				if (!(changed & (1 << bit)) || i * 8 + bit >= w * h) {
+					continue;
+				}
+				// the cell and its neighbours (their edges) change
+				int cx = (i * 8 + bit) % w;
+				int cy = (i * 8 + bit) / w;
+				for (y = cy - 1; y <= cy + 1; y++) {
+					if (y < 0 || y >= h) {
+						continue;
+					}
+					fogDirtyRows[y] = 1;
+					for (x = cx - 1; x <= cx + 1; x++) {
+						if (x < 0 || x >= w || (x != cx && y != cy)) {
+							continue;
+						}
+						fogCells[y * w + x] = GetFogCode( explored_mask, visible_mask, w, h, x, y );
+					}
+				}
+			}
+		}
+	}
+
+	for (y = 0; y < h; y++) {
+		if (!fogDirtyRows[y]) {
+			continue;
+		}
+		fogDirtyRows[y] = 0;
+		ieWord run = 0;
+		for (x = w - 1; x >= 0; x--) {
+			if (fogCells[y * w + x] & FOG_BLACK) {
+				run++;
+			} else {
+				run = 0;
+			}
+			fogRuns[y * w + x] = run;
+		}
+	}
+
+	fogExplored.assign(explored_mask, explored_mask + size);
+	fogVisible.assign(visible_mask, visible_mask + size);
+}
 
 void TileMap::DrawFogOfWar(ieByte* explored_mask, ieByte* visible_mask, Region viewport)
 {
+	PROFILE_SCOPE(PROFILE_FOGDRAW);
 	// viewport - pos & size of the control
 	int w = XCellCount * CELL_RATIO;
 	int h = YCellCount * CELL_RATIO;
@@ -240,6 +409,8 @@ void TileMap::DrawFogOfWar(ieByte* explored_mask, ieByte* visible_mask, Region v
 	}
 	Color black = { 0, 0, 0, 255 };
 
+	UpdateFogCells( explored_mask, visible_mask, w, h );
+
 	Video* vid = core->GetVideoDriver();
 	Region vp = vid->GetViewport();
 
@@ -269,144 +440,33 @@ void TileMap::DrawFogOfWar(ieByte* explored_mask, ieByte* visible_mask, Region v
 		dx++;
 		dy++;
 	}
+	if (dx > w) {
+		dx = w;
+	}
 	for (int y = sy; y < dy && y < h; y++) {
-		for (int x = sx; x < dx && x < w; x++) {
+		int x = sx;
+		while (x < dx) {
 			Region r = Region(x0 + viewport.x + ( (x - sx) * CELL_SIZE ), y0 + viewport.y + ( (y - sy) * CELL_SIZE ), CELL_SIZE, CELL_SIZE);
-			if (! IS_EXPLORED( x, y )) {
-				// Unexplored tiles are all black
-				vid->DrawRect(r, black, true, true);
-				continue;  // Don't draw 'invisible' fog
-			}
-			else {
-				// If an explored tile is adjacent to an
-				//   unexplored one, we draw border sprite
-				//   (gradient black <-> transparent)
-				// Tiles in four cardinal directions have these
-				//   values.
-				//
-				//      1
-				//    2   8
-				//      4
-				//
-				// Values of those unexplored are
-				//   added together, the resulting number being
-				//   an index of shadow sprite to use. For now,
-				//   some tiles are made 'on the fly' by
-				//   drawing two or more tiles
-
-				int e = ! IS_EXPLORED( x, y - 1);
-				if (! IS_EXPLORED( x - 1, y )) e |= 2;
-				if (! IS_EXPLORED( x, y + 1 )) e |= 4;
-				if (! IS_EXPLORED( x + 1, y )) e |= 8;
-
-				switch (e) {
-				case 1:
-				case 2:
-				case 3:
-				case 4:
-				case 6:
-				case 8:
-				case 9:
-				case 12:
-					FOG( e );
-					break;
-				case 5:
-					FOG( 1 );
-					FOG( 4 );
-					break;
-				case 7:
-					FOG( 3 );
-					FOG( 6 );
-					break;
-				case 10:
-					FOG( 2 );
-					FOG( 8 );
-					break;
-				case 11:
-					FOG( 3 );
-					FOG( 9 );
-					break;
-				case 13:
-					FOG( 9 );
-					FOG( 12 );
-					break;
-				case 14:
-					FOG( 6 );
-					FOG( 12 );
-					break;
-				case 15: //this is black too
-					vid->DrawRect(r, black, true, true);
-					break;
+			int run = fogRuns[y * w + x];
+			if (run) {
+				// a row of black cells is a single rectangle
+				if (run > dx - x) {
+					run = dx - x;
 				}
+				r.w = run * CELL_SIZE;
+				vid->DrawRect(r, black, true, true);
+				x += run;
+				continue;
 			}
 
-			if (! IS_VISIBLE( x, y )) {
-				// Invisible tiles are all gray
+			ieWord code = fogCells[y * w + x];
+			DrawFogEdges( vid, 0, code & FOG_EXPLORED_EDGES, r );
+			if (code & FOG_INVISIBLE) {
 				FOG( 16 );
-				continue;  // Don't draw 'invisible' fog
-			}
-			else {
-				// If a visible tile is adjacent to an
-				//   invisible one, we draw border sprite
-				//   (gradient gray <-> transparent)
-				// Tiles in four cardinal directions have these
-				//   values.
-				//
-				//      1
-				//    2   8
-				//      4
-				//
-				// Values of those invisible are
-				//   added together, the resulting number being
-				//   an index of shadow sprite to use. For now,
-				//   some tiles are made 'on the fly' by
-				//   drawing two or more tiles
-
-				int e = ! IS_VISIBLE( x, y - 1);
-				if (! IS_VISIBLE( x - 1, y )) e |= 2;
-				if (! IS_VISIBLE( x, y + 1 )) e |= 4;
-				if (! IS_VISIBLE( x + 1, y )) e |= 8;
-
-				switch (e) {
-				case 1:
-				case 2:
-				case 3:
-				case 4:
-				case 6:
-				case 8:
-				case 9:
-				case 12:
-					FOG( 16 + e );
-					break;
-				case 5:
-					FOG( 16 + 1 );
-					FOG( 16 + 4 );
-					break;
-				case 7:
-					FOG( 16 + 3 );
-					FOG( 16 + 6 );
-					break;
-				case 10:
-					FOG( 16 + 2 );
-					FOG( 16 + 8 );
-					break;
-				case 11:
-					FOG( 16 + 3 );
-					FOG( 16 + 9 );
-					break;
-				case 13:
-					FOG( 16 + 9 );
-					FOG( 16 + 12 );
-					break;
-				case 14:
-					FOG( 16 + 6 );
-					FOG( 16 + 12 );
-					break;
-				case 15: //this is unseen too
-					FOG( 16 );
-					break;
-				}
+			} else {
+				DrawFogEdges( vid, 16, code >> FOG_VISIBLE_SHIFT, r );
 			}
+			x++;
 		}
 	}
 }
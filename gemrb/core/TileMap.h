@@ -43,6 +43,17 @@ private:
 	std::vector< InfoPoint*> infoPoints;
 	std::vector< TileObject*> tiles;
 	bool LargeMap;
+	//the fog of war masks drawn last, only the cells around the
+	//changed bits are recomputed
+	std::vector< ieByte> fogExplored, fogVisible;
+	//the fog sprites of each cell
+	std::vector< ieWord> fogCells;
+	//the number of black cells starting at each cell, in its row
+	std::vector< ieWord> fogRuns;
+	std::vector< char> fogDirtyRows;
+	int fogW, fogH;
+
+	void UpdateFogCells(ieByte* explored_mask, ieByte* visible_mask, int w, int h);
 public:
 	TileMap(void);
 	~TileMap(void);
@@ -106,6 +106,14 @@ Variables::iterator Variables::GetNextAssoc(iterator rNextPosition, const char*&
 	return ( iterator ) pAssocNext;
 }
 
+unsigned int Variables::serials = 0;
+
+//new serials invalidate the handles of this table
+inline void Variables::Changed()
+{
+	m_nSerial = ++serials;
+}
+
 Variables::Variables(int nBlockSize, int nHashTableSize)
 {
 	assert( nBlockSize > 0 );
@@ -119,6 +127,7 @@ Variables::Variables(int nBlockSize, int nHashTableSize)
 	m_pBlocks = NULL;
 	m_nBlockSize = nBlockSize;
 	m_type = GEM_VARIABLES_INT;
+	Changed();
 }
 
 void Variables::InitHashTable(unsigned int nHashSize, bool bAllocNow)
@@ -140,6 +149,7 @@ void Variables::InitHashTable(unsigned int nHashSize, bool bAllocNow)
 		memset( m_pHashTable, 0, sizeof( Variables::MyAssoc * ) * nHashSize );
 	}
 	m_nHashTableSize = nHashSize;
+	Changed();
 }
 
 void Variables::RemoveAll(ReleaseFun fun)
@@ -181,6 +191,7 @@ void Variables::RemoveAll(ReleaseFun fun)
 		p = pNext;
 	}
 	m_pBlocks = NULL;
+	Changed();
 }
 
 Variables::~Variables()
@@ -209,6 +220,7 @@ Variables::MyAssoc* Variables::NewAssoc(const char* key)
 	m_pFreeList = m_pFreeList->pNext;
 	m_nCount++;
 	assert( m_nCount > 0 ); // make sure we don't overflow
+	Changed();
 	if (m_lParseKey) {
 		MyCopyKey( pAssoc->key, key );
 	} else {
@@ -237,6 +249,7 @@ void Variables::FreeAssoc(Variables::MyAssoc* pAssoc)
 	m_pFreeList = pAssoc;
 	m_nCount--;
 	assert( m_nCount >= 0 ); // make sure we don't underflow
+	Changed();
 
 	// if no more elements, cleanup completely
 	if (m_nCount == 0) {
@@ -336,6 +349,23 @@ bool Variables::Lookup(const char* key, ieDword& rValue) const
 	return true;
 }
 
+bool Variables::Lookup(const char* key, ieDword& rValue, Handle& handle) const
+{
+	assert(m_type==GEM_VARIABLES_INT);
+	if (handle.table != this || handle.serial != m_nSerial) {
+		unsigned int nHash;
+		handle.table = this;
+		handle.serial = m_nSerial;
+		handle.assoc = GetAssocAt( key, nHash );
+	}
+	if (handle.assoc == NULL) {
+		return false;
+	} // not in map
+
+	rValue = handle.assoc->Value.nValue;
+	return true;
+}
+
 void Variables::SetAtCopy(const char* key, const char* value)
 {
 	size_t len = strlen(value)+1;
@@ -55,6 +55,12 @@ protected:
 public:
 	// abstract iteration position
 	typedef MyAssoc *iterator;
+	// a variable looked up once, valid until one is added or removed
+	struct Handle {
+		const Variables* table;
+		unsigned int serial;
+		iterator assoc;
+	};
 public:
 	// Construction
 	Variables(int nBlockSize = 10, int nHashTableSize = 2049);
@@ -89,6 +95,8 @@ public:
 	bool Lookup(const char* key, ieDword& rValue) const;
 	bool Lookup(const char* key, char*& dest) const;
 	bool Lookup(const char* key, void*& dest) const;
+	//same as the above, but the variable is remembered in the handle
+	bool Lookup(const char* key, ieDword& rValue, Handle& handle) const;
 
 	// Operations
 	void SetAtCopy(const char* key, const char* newValue);
@@ -112,10 +120,13 @@ protected:
 	MemBlock* m_pBlocks;
 	int m_nBlockSize;
 	int m_type; //could be string or ieDword 
+	unsigned int m_nSerial; //changes when variables are added or removed
+	static unsigned int serials;
 
 	Variables::MyAssoc* NewAssoc(const char* key);
 	void FreeAssoc(Variables::MyAssoc*);
 	Variables::MyAssoc* GetAssocAt(const char*, unsigned int&) const;
+	inline void Changed();
 	inline bool MyCopyKey(char*& dest, const char* key) const;
 	inline unsigned int MyCompareKey(const char* key, const char *str) const;
 	inline unsigned int MyHashKey(const char*) const;
@@ -228,3 +228,13 @@ void Video::MoveViewportTo(int x, int y)
 	}
 }
 
+void Video::SetFrameRate(int fps, int mode)
+{
+	pacer.SetRate(fps, mode);
+}
+
+const FramePacer& Video::GetFramePacer() const
+{
+	return pacer;
+}
+
@@ -34,6 +34,7 @@
 #include "Polygon.h"
 #include "ScriptedAnimation.h"
 #include "GUI/EventMgr.h"
+#include "System/FramePacer.h"
 
 class AnimationFactory;
 class Palette;
@@ -222,6 +223,11 @@ public:
 	Region GetViewport(void) const;
 	void SetViewport(int x, int y, unsigned int w, unsigned int h);
 	void MoveViewportTo(int x, int y);
+	/** limits SwapBuffers to fps frames per second (<= 0: uncapped),
+	 *  mode is a PaceMode */
+	void SetFrameRate(int fps, int mode);
+	/** the frame times, for the fps display */
+	const FramePacer& GetFramePacer() const;
 protected:
 	int DisableMouse;
 	short xCorr, yCorr;
@@ -229,6 +235,7 @@ protected:
 	Region Viewport;
 	int width,height,bpp;
 	bool fullscreen;
+	FramePacer pacer;
 
 	unsigned char Gamma10toGamma22[256];
 	unsigned char Gamma22toGamma10[256];
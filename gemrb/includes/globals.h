@@ -202,6 +202,7 @@ GEM_EXPORT char* strlwr(char* string);
 
 #ifdef WIN32
 #define GetTime(store) store = GetTickCount()
+#define GetTimeUsec(store) store = GetTickCount()*1000
 #else
 #include <sys/time.h>
 #define GetTime(store) \
@@ -210,6 +211,13 @@ GEM_EXPORT char* strlwr(char* string);
 		gettimeofday(&tv, NULL); \
 		store = (tv.tv_usec/1000) + (tv.tv_sec*1000); \
 	}
+//microsecond resolution, for profiling
+#define GetTimeUsec(store) \
+	{ \
+		struct timeval tv; \
+		gettimeofday(&tv, NULL); \
+		store = tv.tv_usec + (tv.tv_sec*1000000); \
+	}
 #endif
 
 inline int MIN(int a, int b)
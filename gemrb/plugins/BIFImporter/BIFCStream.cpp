@@ -0,0 +1,301 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "BIFCStream.h"
+
+#include "win32def.h"
+
+#include "Interface.h"
+#include "System/FileStream.h"
+#include "System/MappedStream.h"
+#include "System/MemoryStream.h"
+
+#include <algorithm>
+
+//signature and uncompressed size
+#define BIFC_HEADER_SIZE 12
+
+BIFCStream::BIFCStream(DataStream *source, Index *index, unsigned long size)
+	: source(source), index(index), comp(PLUGIN_COMPRESSION_ZLIB)
+{
+	index->refcount++;
+	this->size = size;
+	for (int i = 0; i < BIFC_CACHE_SIZE; i++) {
+		cache[i].block = -1;
+		cache[i].lastused = 0;
+		cache[i].data = NULL;
+	}
+	cacheClock = 0;
+}
+
+BIFCStream::~BIFCStream()
+{
+	for (int i = 0; i < BIFC_CACHE_SIZE; i++) {
+		delete cache[i].data;
+	}
+	if (!--index->refcount) {
+		delete index;
+	}
+	delete source;
+}
+
+BIFCStream* BIFCStream::OpenFile(const char* filename)
+{
+	DataStream *source = MappedStream::OpenFile(filename);
+	if (!source) {
+		source = FileStream::OpenFile(filename);
+		if (!source) {
+			return NULL;
+		}
+	}
+
+	char Signature[8];
+	ieDword declen;
+	source->Read( Signature, 8 );
+	source->ReadDword( &declen );
+	if (strncmp( Signature, "BIFCV1.0", 8 ) ) {
+		delete source;
+		return NULL;
+	}
+
+	char name[_MAX_PATH];
+	snprintf(name, _MAX_PATH, "%s.idx", source->filename);
+	strlwr(name);
+
+	Index *index = new Index();
+	index->refcount = 0;
+	if (!LoadIndex(name, source, index)) {
+		print( "Indexing %s\n", filename );
+		if (!ScanIndex(source, index, declen)) {
+			printMessage("BIFImporter", "Corrupt archive: %s\n", LIGHT_RED, filename);
+			delete index;
+			delete source;
+			return NULL;
+		}
+		SaveIndex(name, source, index);
+	}
+
+	BIFCStream *stream = new BIFCStream(source, index, declen);
+	strncpy(stream->filename, source->filename, sizeof(stream->filename));
+	strncpy(stream->originalfile, filename, _MAX_PATH);
+	return stream;
+}
+
+bool BIFCStream::ScanIndex(DataStream *source, Index *index, ieDword declen)
+{
+	Block block;
+	ieDword offset = 0;
+	unsigned long pos = BIFC_HEADER_SIZE;
+
+	index->blocks.clear();
+	while (pos < source->Size()) {
+		source->Seek( pos, GEM_STREAM_START );
+		block.offset = offset;
+		block.dataPos = pos + 8;
+		if (source->ReadDword( &block.declen ) != 4 ||
+			source->ReadDword( &block.complen ) != 4) {
+			return false;
+		}
+		index->blocks.push_back(block);
+		offset += block.declen;
+		pos += 8 + block.complen;
+	}
+	return pos == source->Size() && offset == declen;
+}
+
+//the index is only valid for the same archive: the block sizes have
+//to add up to its size
+bool BIFCStream::LoadIndex(const char *name, DataStream *source, Index *index)
+{
+	char path[_MAX_PATH];
+	PathJoin(path, core->CachePath, name, NULL);
+	FileStream *str = FileStream::OpenFile(path);
+	if (!str) {
+		return false;
+	}
+
+	char Signature[8];
+	ieDword filesize, count;
+	str->Read( Signature, 8 );
+	str->ReadDword( &filesize );
+	str->ReadDword( &count );
+	if (strncmp( Signature, "BIFCIDX1", 8 ) || filesize != source->Size() ||
+		str->Remains() != count * 8) {
+		delete str;
+		return false;
+	}
+
+	Block block;
+	ieDword offset = 0;
+	unsigned long pos = BIFC_HEADER_SIZE;
+	index->blocks.clear();
+	index->blocks.reserve(count);
+	for (ieDword i = 0; i < count; i++) {
+		str->ReadDword( &block.declen );
+		str->ReadDword( &block.complen );
+		block.offset = offset;
+		block.dataPos = pos + 8;
+		index->blocks.push_back(block);
+		offset += block.declen;
+		pos += 8 + block.complen;
+	}
+	delete str;
+	return pos == filesize;
+}
+
+void BIFCStream::SaveIndex(const char *name, DataStream *source, Index *index)
+{
+	char path[_MAX_PATH];
+	PathJoin(path, core->CachePath, name, NULL);
+	FileStream str;
+	if (!str.Create(path)) {
+		return;
+	}
+
+	ieDword filesize = source->Size();
+	ieDword count = index->blocks.size();
+	str.Write( "BIFCIDX1", 8 );
+	str.WriteDword( &filesize );
+	str.WriteDword( &count );
+	for (ieDword i = 0; i < count; i++) {
+		str.WriteDword( &index->blocks[i].declen );
+		str.WriteDword( &index->blocks[i].complen );
+	}
+}
+
+DataStream* BIFCStream::Clone()
+{
+	DataStream *copy = source->Clone();
+	if (!copy) {
+		return NULL;
+	}
+	BIFCStream *stream = new BIFCStream(copy, index, size);
+	strncpy(stream->filename, filename, sizeof(filename));
+	strncpy(stream->originalfile, originalfile, _MAX_PATH);
+	return stream;
+}
+
+//returns the inflated block, from the cache if possible
+DataStream* BIFCStream::GetBlock(int block)
+{
+	int slot = 0;
+	for (int i = 0; i < BIFC_CACHE_SIZE; i++) {
+		if (cache[i].block == block) {
+			cache[i].lastused = ++cacheClock;
+			return cache[i].data;
+		}
+		if (cache[i].lastused < cache[slot].lastused) {
+			slot = i;
+		}
+	}
+
+	const Block &b = index->blocks[block];
+	CachedBlock &entry = cache[slot];
+	delete entry.data;
+	entry.block = -1;
+	entry.lastused = 0;
+	entry.data = new MemoryStream(originalfile, malloc(b.declen), b.declen);
+
+	source->Seek( b.dataPos, GEM_STREAM_START );
+	if (comp->Decompress( entry.data, source, b.complen ) != GEM_OK ||
+		entry.data->GetPos() != b.declen) {
+		printMessage("BIFImporter", "Cannot inflate block %d of %s\n", LIGHT_RED, block, originalfile);
+		delete entry.data;
+		entry.data = NULL;
+		return NULL;
+	}
+	entry.block = block;
+	entry.lastused = ++cacheClock;
+	return entry.data;
+}
+
+int BIFCStream::Read(void* dest, unsigned int length)
+{
+	//we don't allow partial reads anyway, so it isn't a problem that
+	//i don't adjust length here (partial reads are evil)
+	if (Pos+length>size ) {
+		return GEM_ERROR;
+	}
+
+	char *out = (char *) dest;
+	unsigned long pos = Pos + (Encrypted ? 2 : 0);
+	unsigned int left = length;
+	while (left) {
+		//the last block starting at or before pos
+		std::vector<Block>::const_iterator it = std::lower_bound(index->blocks.begin(), index->blocks.end(), (ieDword) pos + 1);
+		int block = (int) (it - index->blocks.begin()) - 1;
+		if (block < 0) {
+			return GEM_ERROR;
+		}
+		DataStream *data = GetBlock(block);
+		if (!data) {
+			return GEM_ERROR;
+		}
+		unsigned long skip = pos - index->blocks[block].offset;
+		unsigned int chunk = index->blocks[block].declen - skip;
+		if (chunk > left) {
+			chunk = left;
+		}
+		data->Seek( skip, GEM_STREAM_START );
+		if (data->Read( out, chunk ) != (int) chunk) {
+			return GEM_ERROR;
+		}
+		out += chunk;
+		pos += chunk;
+		left -= chunk;
+	}
+	if (Encrypted) {
+		ReadDecrypted( dest, length );
+	}
+	Pos += length;
+	return length;
+}
+
+int BIFCStream::Write(const void* /*src*/, unsigned int /*length*/)
+{
+	//the archive is read only
+	return GEM_ERROR;
+}
+
+int BIFCStream::Seek(int newpos, int type)
+{
+	switch (type) {
+		case GEM_CURRENT_POS:
+			Pos += newpos;
+			break;
+
+		case GEM_STREAM_START:
+			Pos = newpos;
+			break;
+
+		case GEM_STREAM_END:
+			Pos = size - newpos;
+			break;
+
+		default:
+			return GEM_ERROR;
+	}
+	//we went past the buffer
+	if (Pos>size) {
+		print("[Streams]: Invalid seek position: %ld (limit: %ld)\n", Pos, size);
+		return GEM_ERROR;
+	}
+	return GEM_OK;
+}
@@ -0,0 +1,86 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef BIFCSTREAM_H
+#define BIFCSTREAM_H
+
+#include <vector>
+
+#include "globals.h"
+
+#include "Compressor.h"
+#include "System/DataStream.h"
+
+//number of inflated blocks kept around per stream
+#define BIFC_CACHE_SIZE 16
+
+/**
+ * @class BIFCStream
+ * Read-only view of the uncompressed contents of a BIFCV1.0 archive.
+ * The archive is a sequence of separately deflated blocks, so only the
+ * blocks covering the read range need to be inflated. The block index is
+ * saved in the cache directory, so it needs to be built only once.
+ */
+
+class BIFCStream : public DataStream {
+private:
+	struct Block {
+		ieDword offset;  //in the uncompressed archive
+		ieDword dataPos; //of the deflated data in the file
+		ieDword complen;
+		ieDword declen;
+
+		bool operator < (ieDword pos) const { return offset < pos; }
+	};
+	//shared by the clones
+	struct Index {
+		int refcount;
+		std::vector<Block> blocks;
+	};
+	struct CachedBlock {
+		int block;
+		unsigned long lastused;
+		DataStream *data;
+	};
+
+	DataStream *source;
+	Index *index;
+	PluginHolder<Compressor> comp;
+	CachedBlock cache[BIFC_CACHE_SIZE];
+	unsigned long cacheClock;
+
+	BIFCStream(DataStream *source, Index *index, unsigned long size);
+	DataStream* GetBlock(int block);
+	static bool ScanIndex(DataStream *source, Index *index, ieDword declen);
+	static bool LoadIndex(const char *name, DataStream *source, Index *index);
+	static void SaveIndex(const char *name, DataStream *source, Index *index);
+public:
+	~BIFCStream();
+	DataStream* Clone();
+
+	int Read(void* dest, unsigned int length);
+	int Write(const void* src, unsigned int length);
+	int Seek(int pos, int startpos);
+public:
+	/** returns NULL if the file is not a valid BIFCV1.0 archive */
+	static BIFCStream* OpenFile(const char* filename);
+};
+
+#endif
@@ -20,6 +20,8 @@
 
 #include "BIFImporter.h"
 
+#include "BIFCStream.h"
+
 #include "win32def.h"
 
 #include "Compressor.h"
@@ -27,19 +29,22 @@
 #include "Interface.h"
 #include "System/SlicedStream.h"
 #include "System/FileStream.h"
+#include "System/MappedStream.h"
+
+#include <algorithm>
 
-BIFImporter::FileEntry::FileEntry(ieDword Offset, ieDword Size)
-	: offset(Offset), size(Size)
+BIFImporter::FileEntry::FileEntry(ieDword Locator, ieDword Offset, ieDword Size)
+	: locator(Locator), offset(Offset), size(Size)
 {
 }
 
-BIFImporter::TileEntry::TileEntry(ieDword Offset, ieDword Count, ieDword Size)
-	: offset(Offset), count(Count), size(Size)
+BIFImporter::TileEntry::TileEntry(ieDword Locator, ieDword Offset, ieDword Count, ieDword Size)
+	: locator(Locator), offset(Offset), count(Count), size(Size)
 {
 }
 
 BIFImporter::BIFImporter()
-	: stream(NULL)
+	: stream(NULL), mapped(NULL)
 {
 }
 
@@ -49,6 +54,19 @@ BIFImporter::~BIFImporter()
 }
 
 int BIFImporter::DecompressSaveGame(DataStream *compressed)
+{
+	//read the chunks straight from memory instead of fread-ing each one
+	MappedStream* map = MappedStream::OpenFile(compressed->originalfile);
+	if (!map) {
+		return DecompressSave(compressed);
+	}
+	map->Seek(compressed->GetPos(), GEM_STREAM_START);
+	int ret = DecompressSave(map);
+	delete map;
+	return ret;
+}
+
+int BIFImporter::DecompressSave(DataStream *compressed)
 {
 	char Signature[8];
 	compressed->Read( Signature, 8 );
@@ -89,6 +107,7 @@ int BIFImporter::CreateArchive(DataStream *compressed)
 {
 	delete stream;
 	stream = NULL;
+	mapped = NULL;
 
 	if (!compressed) {
 		return GEM_ERROR;
@@ -128,10 +147,23 @@ int BIFImporter::AddToSaveGame(DataStream *str, DataStream *uncompressed)
 	return GEM_OK;
 }
 
+//replaces the plain file stream with a mapping of the same file
+void BIFImporter::MapStream()
+{
+	MappedStream* map = MappedStream::OpenFile(stream->originalfile);
+	if (!map) {
+		return;
+	}
+	map->Seek(stream->GetPos(), GEM_STREAM_START);
+	delete stream;
+	stream = mapped = map;
+}
+
 int BIFImporter::OpenArchive(const char* filename)
 {
 	delete stream;
 	stream = NULL;
+	mapped = NULL;
 
 	FileStream* file = FileStream::OpenFile(filename);
 	if( !file) {
@@ -148,6 +180,7 @@ int BIFImporter::OpenArchive(const char* filename)
 		stream = gamedata->AddCacheFile( filename );
 		if (!stream)
 			return GEM_ERROR;
+		MapStream();
 		stream->Read( Signature, 8 );
 		strcpy( path, filename );
 		ReadBIF();
@@ -173,6 +206,7 @@ int BIFImporter::OpenArchive(const char* filename)
 		delete compressed;
 		if (!stream)
 			return GEM_ERROR;
+		MapStream();
 		stream->Read( Signature, 8 );
 		if (strncmp( Signature, "BIFFV1  ", 8 ) == 0)
 			ReadBIF();
@@ -182,57 +216,11 @@ int BIFImporter::OpenArchive(const char* filename)
 	}
 
 	if (strncmp( Signature, "BIFCV1.0", 8 ) == 0) {
-		//print("'BIFCV1.0' Compressed File Found\n");
-		stream = gamedata->OpenCacheFile(compressed->filename);
-		if (stream) {
-			//print("Found in Cache\n");
-			delete compressed;
-			stream->Read( Signature, 8 );
-			if (strncmp( Signature, "BIFFV1  ", 8 ) == 0) {
-				ReadBIF();
-			} else
-				return GEM_ERROR;
-			return GEM_OK;
-		}
-		print( "Decompressing\n" );
+		delete compressed;
 		if (!core->IsAvailable( PLUGIN_COMPRESSION_ZLIB ))
 			return GEM_ERROR;
-		PluginHolder<Compressor> comp(PLUGIN_COMPRESSION_ZLIB);
-		ieDword unCompBifSize;
-		compressed->ReadDword( &unCompBifSize );
-		print( "\nDecompressing file: [..........]" );
-		fflush(stdout);
-		FileStream *out = gamedata->CreateCacheFile(compressed->filename);
-		if (!out) {
-			printMessage("BIFImporter", "Cannot write %s.\n", RED, path);
-			return GEM_ERROR;
-		}
-		ieDword finalsize = 0;
-		int laststep = 0;
-		while (finalsize < unCompBifSize) {
-			ieDword complen, declen;
-			compressed->ReadDword( &declen );
-			compressed->ReadDword( &complen );
-			if (comp->Decompress( out, compressed, complen ) != GEM_OK) {
-				return GEM_ERROR;
-			}
-			finalsize = out->GetPos();
-			if (( int ) ( finalsize * ( 10.0 / unCompBifSize ) ) != laststep) {
-				laststep++;
-				print( "\b\b\b\b\b\b\b\b\b\b\b" );
-				int l;
-
-				for (l = 0; l < laststep; l++)
-					print( "|" );
-				for (; l < 10; l++)//l starts from laststep
-					print( "." );
-				print( "]" );
-				fflush(stdout);
-			}
-		}
-		print( "\n" );
-		stream = gamedata->OpenCacheFile(compressed->filename);
-		delete compressed;
+		//the blocks are inflated on demand, no need to unpack the whole archive
+		stream = BIFCStream::OpenFile( filename );
 		if (!stream)
 			return GEM_ERROR;
 		stream->Read( Signature, 8 );
@@ -249,22 +237,28 @@ int BIFImporter::OpenArchive(const char* filename)
 DataStream* BIFImporter::GetStream(unsigned long Resource, unsigned long Type)
 {
 	if (Type == IE_TIS_CLASS_ID) {
-		TileEntryMap::const_iterator it = tiles.find(Resource & 0xfc000);
+		TileEntry key(Resource & 0xfc000, 0, 0, 0);
+		std::vector<TileEntry>::const_iterator it = std::lower_bound(tiles.begin(), tiles.end(), key);
 
-		if (it == tiles.end())
+		if (it == tiles.end() || it->locator != key.locator)
 			return 0;
 
-		const TileEntry &entry = it->second;
+		const TileEntry &entry = *it;
 
+		if (mapped)
+			return mapped->Slice(entry.offset, entry.size * entry.count);
 		return SliceStream(stream, entry.offset, entry.size * entry.count);
 	} else {
-		FileEntryMap::const_iterator it = files.find(Resource & 0x3fff);
+		FileEntry key(Resource & 0x3fff, 0, 0);
+		std::vector<FileEntry>::const_iterator it = std::lower_bound(files.begin(), files.end(), key);
 
-		if (it == files.end())
+		if (it == files.end() || it->locator != key.locator)
 			return 0;
 
-		const FileEntry &entry = it->second;
+		const FileEntry &entry = *it;
 
+		if (mapped)
+			return mapped->Slice(entry.offset, entry.size);
 		return SliceStream(stream, entry.offset, entry.size);
 	}
 	return NULL;
@@ -283,6 +277,11 @@ void BIFImporter::ReadBIF()
 	ieDword locator, count, size;
 	ieWord dummy;
 
+	files.clear();
+	tiles.clear();
+	files.reserve(fileCount);
+	tiles.reserve(tileCount);
+
 	for (ieDword i = 0; i < fileCount; ++i) {
 		stream->ReadDword(&locator);
 		stream->ReadDword(&offset);
@@ -290,7 +289,7 @@ void BIFImporter::ReadBIF()
 		stream->ReadWord(&dummy); // type
 		stream->ReadWord(&dummy); // unknown
 
-		files.insert(FileEntryPair(locator & 0x3fff, FileEntry(offset, size)));
+		files.push_back(FileEntry(locator & 0x3fff, offset, size));
 	}
 
 	for (ieDword i = 0; i < tileCount; ++i) {
@@ -301,8 +300,13 @@ void BIFImporter::ReadBIF()
 		stream->ReadWord(&dummy); // type
 		stream->ReadWord(&dummy); // unknown
 
-		tiles.insert(TileEntryPair(locator & 0xfc000, TileEntry(offset, count, size)));
+		tiles.push_back(TileEntry(locator & 0xfc000, offset, count, size));
 	}
+
+	//the tables are usually sorted already; stable, so the first
+	//of duplicate locators wins, like it did with map::insert
+	std::stable_sort(files.begin(), files.end());
+	std::stable_sort(tiles.begin(), tiles.end());
 }
 
 #include "plugindef.h"
@@ -21,8 +21,7 @@
 #ifndef BIFIMPORTER_H
 #define BIFIMPORTER_H
 
-#include <set>
-#include <map>
+#include <vector>
 
 #include "ArchiveImporter.h"
 
@@ -30,34 +29,37 @@
 
 #include "System/DataStream.h"
 
+class MappedStream;
+
 class BIFImporter : public ArchiveImporter {
 private:
+	//both tables are kept sorted by locator, for binary searching
 	struct FileEntry {
+		ieDword locator;
 		ieDword offset;
 		ieDword size;
 
-		FileEntry(ieDword Offset, ieDword Size);
+		FileEntry(ieDword Locator, ieDword Offset, ieDword Size);
+		bool operator < (const FileEntry& other) const { return locator < other.locator; }
 	};
 
-	typedef std::pair<ieDword, FileEntry> FileEntryPair;
-	typedef std::map<ieDword, FileEntry> FileEntryMap;
-
 	struct TileEntry {
+		ieDword locator;
 		ieDword offset;
 		ieDword count;
 		ieDword size;
 
-		TileEntry(ieDword Offset, ieDword Count, ieDword Size);
+		TileEntry(ieDword Locator, ieDword Offset, ieDword Count, ieDword Size);
+		bool operator < (const TileEntry& other) const { return locator < other.locator; }
 	};
 
-	typedef std::pair<ieDword, TileEntry> TileEntryPair;
-	typedef std::map<ieDword, TileEntry> TileEntryMap;
-
-	FileEntryMap files;
-	TileEntryMap tiles;
+	std::vector<FileEntry> files;
+	std::vector<TileEntry> tiles;
 
 	char path[_MAX_PATH];
 	DataStream* stream;
+	//same as stream, if the archive could be mapped
+	MappedStream* mapped;
 
 public:
 	BIFImporter();
@@ -70,6 +72,8 @@ public:
 
 private:
 	void ReadBIF();
+	void MapStream();
+	int DecompressSave(DataStream *compressed);
 };
 
 #endif
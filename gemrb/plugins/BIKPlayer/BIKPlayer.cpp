@@ -30,10 +30,6 @@
  * Copyright (c) 2009 Konstantin Shishkov
 */
 
-#if defined(__HAIKU__)
-#include <unistd.h>
-#endif
-
 #include "BIKPlayer.h"
 
 #include "rational.h"
@@ -66,9 +62,11 @@ BIKPlayer::BIKPlayer(void)
 	maxRow = 0;
 	rowCount = 0;
 	frameCount = 0;
+	benchmark = false;
 	//force initialisation of static tables
 	memset(bink_trees, 0, sizeof(bink_trees));
 	memset(table, 0, sizeof(table));
+	dsputil_init(&dsp);
 }
 
 BIKPlayer::~BIKPlayer(void)
@@ -224,93 +222,86 @@ int BIKPlayer::Play()
 	return ret;
 }
 
-//this code could be in the movieplayer parent class
-void static get_current_time(long &sec, long &usec) {
-#ifdef _WIN32
-	DWORD time;
-	time = GetTickCount();
-
-	sec = time / 1000;
-	usec = (time % 1000) * 1000;
-#else
-	struct timeval tv;
-	gettimeofday(&tv, NULL);
-
-	sec = tv.tv_sec;
-	usec = tv.tv_usec;
-#endif
-}
-
-void BIKPlayer::timer_start()
+int BIKPlayer::Benchmark()
 {
-	get_current_time(timer_last_sec, timer_last_usec);
-}
-
-void BIKPlayer::timer_wait()
-{
-	long sec, usec;
-	get_current_time(sec, usec);
-
-	while (sec > timer_last_sec) {
-		usec += 1000000;
-		timer_last_sec++;
+	if (!validVideo) {
+		return -1;
 	}
-
-	//quick hack, we should rather use the rational time base as ffmpeg
-	frame_wait = v_timebase.num*1000000/v_timebase.den;
-	while (usec - timer_last_usec > (long)frame_wait) {
-		usec -= frame_wait;
-		video_frameskip++;
+	benchmark = true;
+	benchRead = benchAudio = benchVideo = 0;
+	frameCount = 0;
+	int ret = 0;
+	unsigned long start, end;
+	GetTimeUsec( start );
+	if (sound_init(false)) {
+		ret = 1;
+	} else if (video_init(header.width, header.height)) {
+		ret = 2;
+	} else {
+		while (next_frame()) ;
 	}
+	GetTimeUsec( end );
 
-	long to_sleep = frame_wait - (usec - timer_last_usec);
-#ifdef _WIN32
-	Sleep(to_sleep / 1000);
-#else
-	usleep(to_sleep);
-#endif
-
-	timer_start();
+	EndAudio();
+	EndVideo();
+	av_freep((void **) &inbuff);
+	benchmark = false;
+	if (ret) {
+		return ret;
+	}
+
+	unsigned int count = frameCount ? frameCount : 1;
+	unsigned long total = end - start;
+	printMessage("BIKPlayer", "Benchmark: %u frames (%ux%u) decoded in %lu ms, %.1f fps\n", WHITE,
+		frameCount, header.width, header.height, total/1000,
+		total ? frameCount * 1000000.0 / total : 0.0);
+	printMessage("BIKPlayer", "Per frame (usec): read %lu, audio %lu, video %lu\n", WHITE,
+		benchRead/count, benchAudio/count, benchVideo/count);
+	return 0;
 }
 
 bool BIKPlayer::next_frame()
 {
-	if (timer_last_sec) {
-		timer_wait();
-	}
+	unsigned long t0 = 0, t1 = 0, t2 = 0, t3 = 0;
+
 	if(frameCount>=header.framecount) {
 		return false;
 	}
+	if (benchmark) GetTimeUsec( t0 );
 	binkframe frame = frames[frameCount++];
 	str->Seek(frame.pos, GEM_STREAM_START);
 	ieDword audframesize;
 	str->ReadDword(&audframesize);
 	frame.size = str->Read( inbuff, frame.size - 4 );
+	if (benchmark) GetTimeUsec( t1 );
 	if (DecodeAudioFrame(inbuff, audframesize)) {
 		//buggy frame, we stop immediately
 		//return false;
 	}
+	if (benchmark) GetTimeUsec( t2 );
 	if (DecodeVideoFrame(inbuff+audframesize, frame.size-audframesize)) {
 		//buggy frame, we stop immediately
 		return false;
 	}
-	if (!timer_last_sec) {
-		timer_start();
+	if (benchmark) {
+		GetTimeUsec( t3 );
+		benchRead += t1 - t0;
+		benchAudio += t2 - t1;
+		benchVideo += t3 - t2;
 	}
 	return true;
 }
 
-int BIKPlayer::doPlay()
+bool BIKPlayer::DecodeFrame()
 {
-	int done = 0;
+	return next_frame();
+}
 
+int BIKPlayer::doPlay()
+{
 	//bink is always truecolor
 	g_truecolor = 1;
 
-	frame_wait = 0;
-	timer_last_sec = 0;
-	video_frameskip = 0;
-
 	if (sound_init( core->GetAudioDrv()->CanPlay())) {
 		//sound couldn't be initialized
 		return 1;
@@ -325,10 +316,8 @@ int BIKPlayer::doPlay()
 		return 2;
 	}
 
-	while (!done && next_frame()) {
-		done = video->PollMovieEvents();
-	}
-
+	//quick hack, we should rather use the rational time base as ffmpeg
+	PlayQueued(v_timebase.num*1000000/v_timebase.den);
 	return 0;
 }
 
@@ -338,6 +327,20 @@ unsigned int BIKPlayer::fileRead(unsigned int pos, void* buf, unsigned int count
 	return str->Read( buf, count );
 }
 
+//a decoded picture, followed by its three planes
+struct BIKFrame {
+	unsigned int strides[3];
+	unsigned int bufw, bufh, w, h, dstx, dsty;
+	ieDword titleref;
+};
+
+//rows of the (subsampled) planes
+static inline unsigned int plane_rows(int plane, unsigned int bufh)
+{
+	return plane ? bufh / 2 : bufh;
+}
+
+//copies the picture, it is shown later by the main thread
 void BIKPlayer::showFrame(unsigned char** buf, unsigned int *strides, unsigned int bufw,
 	unsigned int bufh, unsigned int w, unsigned int h, unsigned int dstx, unsigned int dsty)
 {
@@ -353,7 +356,41 @@ void BIKPlayer::showFrame(unsigned char** buf, unsigned int *strides, unsigned i
 			titleref = strRef[rowCount-1];
 		}
 	}
-	video->showYUVFrame(buf,strides,bufw,bufh,w,h,dstx,dsty, titleref);
+
+	unsigned int size = sizeof(BIKFrame);
+	int plane;
+	for (plane = 0; plane < 3; plane++) {
+		size += strides[plane] * plane_rows(plane, bufh);
+	}
+	BIKFrame *frame = (BIKFrame *) malloc(size);
+	char *data = (char *) (frame + 1);
+	for (plane = 0; plane < 3; plane++) {
+		unsigned int len = strides[plane] * plane_rows(plane, bufh);
+		memcpy(data, buf[plane], len);
+		data += len;
+		frame->strides[plane] = strides[plane];
+	}
+	frame->bufw = bufw;
+	frame->bufh = bufh;
+	frame->w = w;
+	frame->h = h;
+	frame->dstx = dstx;
+	frame->dsty = dsty;
+	frame->titleref = titleref;
+	QueueFrame((char *) frame);
+}
+
+void BIKPlayer::PresentFrame(char *data)
+{
+	BIKFrame *frame = (BIKFrame *) data;
+	unsigned char *planes[3];
+	unsigned char *plane = (unsigned char *) (frame + 1);
+	for (int i = 0; i < 3; i++) {
+		planes[i] = plane;
+		plane += frame->strides[i] * plane_rows(i, frame->bufh);
+	}
+	video->showYUVFrame(planes, frame->strides, frame->bufw, frame->bufh,
+		frame->w, frame->h, frame->dstx, frame->dsty, frame->titleref);
 }
 
 int BIKPlayer::setAudioStream()
@@ -373,7 +410,7 @@ void BIKPlayer::freeAudioStream(int stream)
 void BIKPlayer::queueBuffer(int stream, unsigned short bits, int channels, short* memory, int size, int samplerate)
 {
 	if (stream > -1)
-		core->GetAudioDrv()->QueueBuffer(stream, bits, channels, memory, size, samplerate);
+		QueueAudio(stream, bits, channels, memory, size, samplerate);
 }
 
 
@@ -392,14 +429,17 @@ int BIKPlayer::sound_init(bool need_init)
 	int frame_len_bits;
 	int ret;
 
-	if(need_init) {
+	if (benchmark) {
+		//decode without a stream to play it on
+		s_stream = -1;
+	} else if(need_init) {
 		s_stream = setAudioStream();
 	} else {
 		s_stream = -1;
 		return 0;
 	}
 
-	if(s_stream<0) {
+	if(s_stream<0 && !benchmark) {
 		return 0;
 	}
 
@@ -710,7 +750,7 @@ void BIKPlayer::DecodeBlock(short *out)
 			ff_rdft_calc(&s_trans.rdft, coeffs);
 	}
 
-	ff_float_to_int16_interleave_c(out, (const float **)s_coeffs_ptr, s_frame_len, s_channels);
+	dsp.float_to_int16_interleave(out, (const float **)s_coeffs_ptr, s_frame_len, s_channels);
 
 	if (!s_first) {
 		unsigned int count = s_overlap_len * s_channels;
@@ -1369,6 +1409,22 @@ static void idct_add(uint8_t *dest, int line_size, DCTELEM *block)
 	add_pixels_nonclamped(block, dest, line_size);
 }
 
+void dsputil_init(DSPContext* c)
+{
+	c->idct = bink_idct;
+	c->idct_put = idct_put;
+	c->idct_add = idct_add;
+	c->put_pixels_nonclamped = put_pixels_nonclamped;
+	c->add_pixels_nonclamped = add_pixels_nonclamped;
+	c->copy_block = copy_block;
+	c->float_to_int16_interleave = ff_float_to_int16_interleave_c;
+#if HAVE_SSE2
+	if (mm_flags & FF_MM_SSE2) {
+		dsputil_init_sse2(c);
+	}
+#endif
+}
+
 int BIKPlayer::DecodeVideoFrame(void *data, int data_size)
 {
 	int blk, bw, bh;
@@ -1439,7 +1495,7 @@ int BIKPlayer::DecodeVideoFrame(void *data, int data_size)
 				}
 				switch (blk) {
 				case SKIP_BLOCK:
-					copy_block(block, prev, dst, stride);
+					dsp.copy_block(block, prev, dst, stride);
 					break;
 				case SCALED_BLOCK:
 					blk = get_value(BINK_SRC_SUB_BLOCK_TYPES);
@@ -1472,7 +1528,7 @@ int BIKPlayer::DecodeVideoFrame(void *data, int data_size)
 						clear_block(block);
 						block[0] = get_value(BINK_SRC_INTRA_DC);
 						read_dct_coeffs(block, c_scantable.permutated,true);
-						bink_idct(block);
+						dsp.idct(block);
 						for (j = 0; j < 8; j++) {
 							for (i = 0; i < 8; i++) {
 								PUT2x2(dst, stride, i, j, block[i + j*8]);
@@ -1513,7 +1569,7 @@ int BIKPlayer::DecodeVideoFrame(void *data, int data_size)
 				case MOTION_BLOCK:
 					xoff = get_value(BINK_SRC_X_OFF);
 					yoff = get_value(BINK_SRC_Y_OFF);
-					copy_block(block, prev + xoff + yoff*stride, dst, stride);
+					dsp.copy_block(block, prev + xoff + yoff*stride, dst, stride);
 					break;
 				case RUN_BLOCK:
 					scan = bink_patterns[v_gb.get_bits(4)];
@@ -1542,17 +1598,17 @@ int BIKPlayer::DecodeVideoFrame(void *data, int data_size)
 				case RESIDUE_BLOCK:
 					xoff = get_value(BINK_SRC_X_OFF);
 					yoff = get_value(BINK_SRC_Y_OFF);
-					copy_block(block, prev + xoff + yoff*stride, dst, stride);
+					dsp.copy_block(block, prev + xoff + yoff*stride, dst, stride);
 					clear_block(block);
 					v = v_gb.get_bits(7);
 					read_residue(block, v);
-					add_pixels_nonclamped(block, dst, stride);
+					dsp.add_pixels_nonclamped(block, dst, stride);
 					break;
 				case INTRA_BLOCK:
 					clear_block(block);
 					block[0] = get_value(BINK_SRC_INTRA_DC);
 					read_dct_coeffs(block, c_scantable.permutated,true);
-					idct_put(dst, stride, block);
+					dsp.idct_put(dst, stride, block);
 					break;
 				case FILL_BLOCK:
 					v = get_value(BINK_SRC_COLORS);
@@ -1563,11 +1619,11 @@ int BIKPlayer::DecodeVideoFrame(void *data, int data_size)
 				case INTER_BLOCK:
 					xoff = get_value(BINK_SRC_X_OFF);
 					yoff = get_value(BINK_SRC_Y_OFF);
-					copy_block(block, prev + xoff + yoff*stride, dst, stride);
+					dsp.copy_block(block, prev + xoff + yoff*stride, dst, stride);
 					clear_block(block);
 					block[0] = get_value(BINK_SRC_INTER_DC);
 					read_dct_coeffs(block, c_scantable.permutated,false);
-					idct_add(dst, stride, block);
+					dsp.idct_add(dst, stride, block);
 					break;
 				case PATTERN_BLOCK:
 					c1 = get_value(BINK_SRC_COLORS);
@@ -1594,16 +1650,13 @@ int BIKPlayer::DecodeVideoFrame(void *data, int data_size)
 		v_gb.get_bits_align32();
 	}
 
-	if (video_frameskip) {
-		video_frameskip--;
-		video_skippedframes++;
-	} else {
+	if (!benchmark) {
 		unsigned int dest_x = (outputwidth - header.width) >> 1;
 		unsigned int dest_y = (outputheight - header.height) >> 1;
 		showFrame((ieByte **) c_pic.data, (unsigned int *) c_pic.linesize, header.width, header.height, header.width, header.height, dest_x, dest_y);
 	}
 
-	//release the old frame even when frame is skipped
+	//the shown frame was copied
 	release_buffer(&c_last);
 	memcpy(&c_last, &c_pic, sizeof(AVFrame));
 	memset(&c_pic, 0, sizeof(AVFrame));
@@ -163,6 +163,10 @@ private:
 	ieDword maxRow;
 	ieDword rowCount;
 	ieDword frameCount;
+
+	//decoding only, with the time spent in each stage (usec)
+	bool benchmark;
+	unsigned long benchRead, benchAudio, benchVideo;
 	
 	//audio context (consider packing it in a struct)
 	unsigned int s_frame_len;
@@ -191,16 +195,11 @@ private:
 
 	//video context (consider packing it in a struct)
 	AVRational v_timebase;
-	long timer_last_sec;
-	long timer_last_usec;
-	unsigned int frame_wait;
-	bool video_rendered_frame;
-	unsigned int video_frameskip;
 	bool done;
 	int outputwidth, outputheight;
-	unsigned int video_skippedframes;
 	//bink specific
 	ScanTable c_scantable;
+	DSPContext dsp;
 	Bundle c_bundle[BINK_NB_SRC];  ///< bundles for decoding all data types
 	Tree c_col_high[16];         ///< trees for decoding high nibble in "colours" data type
 	int  c_col_lastval;          ///< value of last decoded high nibble in "colours" data type 
@@ -212,8 +211,6 @@ private:
 	AVFrame c_pic, c_last;
 
 private:
-	void timer_start();
-	void timer_wait();
 	void segment_video_play();
 	bool next_frame();
 	int doPlay();
@@ -248,12 +245,16 @@ private:
 	int DecodeVideoFrame(void *data, int data_size);
 	int EndAudio();
 	int EndVideo();
+protected:
+	bool DecodeFrame();
+	void PresentFrame(char *data);
 public:
 	BIKPlayer(void);
 	~BIKPlayer(void);
 	bool Open(DataStream* stream);
 	void CallBackAtFrames(ieDword cnt, ieDword *arg, ieDword *arg2);
 	int Play();	
+	int Benchmark();
 };
 
 #endif
@@ -55,21 +55,50 @@ void ff_init_scantable(uint8_t *, ScanTable *st, const uint8_t *src_scantable);
  */
 #define emms_c()
 
+/* x86 compilers with SSE2 intrinsics, the kernels are in dsputil_sse2.cpp */
+#if (defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))) || \
+	(defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64)))
+#define HAVE_SSE2 1
+#endif
+
+#define FF_MM_SSE2 0x0010 ///< PIV SSE2 functions
+
 /* should be defined by architectures supporting
    one or more MultiMedia extension */
+#if HAVE_SSE2
 int mm_support(void);
 extern int mm_flags;
+#else
+#define mm_flags 0
+#define mm_support() 0
+#endif
 
 #define DECLARE_ALIGNED_16(t, v) DECLARE_ALIGNED(16, t, v)
 #define DECLARE_ALIGNED_8(t, v)  DECLARE_ALIGNED(8, t, v)
 
-#define mm_flags 0
-#define mm_support() 0
-
 #ifndef STRIDE_ALIGN
 #   define STRIDE_ALIGN 8
 #endif
 
+/**
+ * The block and sample functions of the Bink decoder, filled in by
+ * dsputil_init with the fastest versions the cpu supports.
+ */
+typedef struct DSPContext {
+    void (*idct)(DCTELEM *block);
+    void (*idct_put)(uint8_t *dest, int line_size, DCTELEM *block);
+    void (*idct_add)(uint8_t *dest, int line_size, DCTELEM *block);
+    void (*put_pixels_nonclamped)(const DCTELEM *block, uint8_t *pixels, int line_size);
+    void (*add_pixels_nonclamped)(const DCTELEM *block, uint8_t *pixels, int line_size);
+    /* copies the 8x8 block at src to dst, leaving it in block too */
+    void (*copy_block)(DCTELEM *block, const uint8_t *src, uint8_t *dst, int stride);
+    void (*float_to_int16_interleave)(int16_t *dst, const float **src, long len, int channels);
+} DSPContext;
+
+void dsputil_init(DSPContext* c);
+void dsputil_init_sse2(DSPContext* c);
+void bink_idct(DCTELEM *block);
+
 /* FFT computation */
 
 /* NOTE: soon integer code will be added, so you must use the
@@ -148,6 +177,10 @@ extern SINTABLE(65536);
 int ff_fft_init(FFTContext *s, int nbits, int inverse);
 void ff_fft_permute_c(FFTContext *s, FFTComplex *z);
 void ff_fft_calc_c(FFTContext *s, FFTComplex *z);
+#if HAVE_SSE2
+/* the loop of the split radix pass, from the second pair of z on */
+void ff_fft_pass_sse2(FFTComplex *z, const FFTSample *wre, unsigned int o1, unsigned int n);
+#endif
 
 /**
  * Do the permutation needed BEFORE calling ff_fft_calc().
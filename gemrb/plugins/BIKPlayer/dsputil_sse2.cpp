@@ -0,0 +1,339 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2010 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+// SSE2 versions of the Bink block, sample and fft functions.
+// They are only used if the cpu has SSE2 (see mm_flags), and give
+// exactly the same results as the C versions in BIKPlayer.cpp and fft.cpp.
+
+// the intrinsics have to come before the integer type macros of common.h
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#include <cpuid.h>
+#include <emmintrin.h>
+//allows building the kernels without -msse2
+#define SSE2_TARGET __attribute__((target("sse2")))
+#define SSE2_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <emmintrin.h>
+#include <intrin.h>
+#define SSE2_TARGET
+#define SSE2_INLINE __forceinline
+#endif
+
+#include "dsputil.h"
+
+#if HAVE_SSE2
+
+int mm_support(void)
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	return (info[3] & (1<<26)) ? FF_MM_SSE2 : 0;
+#else
+	unsigned int eax, ebx, ecx, edx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return 0;
+	return (edx & bit_SSE2) ? FF_MM_SSE2 : 0;
+#endif
+}
+
+int mm_flags = mm_support();
+
+/* fft */
+
+/**
+ * The do loop of PASS in fft.cpp, two complex numbers at a time.
+ * The products are negated with the sign bit and not subtracted, which
+ * is exact, so the result is the same as that of the C loop.
+ */
+SSE2_TARGET void ff_fft_pass_sse2(FFTComplex *z, const FFTSample *wre, unsigned int o1, unsigned int n)
+{
+	const FFTSample *wim = wre + o1;
+	unsigned int o2 = 2*o1, o3 = 3*o1;
+	const __m128 negim = _mm_castsi128_ps(_mm_set_epi32(0x80000000, 0, 0x80000000, 0));
+	const __m128 negre = _mm_castsi128_ps(_mm_set_epi32(0, 0x80000000, 0, 0x80000000));
+
+	do {
+		z += 2;
+		wre += 2;
+		wim -= 2;
+		__m128 vre = _mm_set_ps(wre[1], wre[1], wre[0], wre[0]);
+		__m128 vim = _mm_set_ps(wim[-1], wim[-1], wim[0], wim[0]);
+		__m128 a0 = _mm_loadu_ps(&z[0].re);
+		__m128 a1 = _mm_loadu_ps(&z[o1].re);
+		__m128 a2 = _mm_loadu_ps(&z[o2].re);
+		__m128 a3 = _mm_loadu_ps(&z[o3].re);
+
+		//(t1, t2) and (t5, t6) of TRANSFORM
+		__m128 a2s = _mm_shuffle_ps(a2, a2, _MM_SHUFFLE(2,3,0,1));
+		__m128 a3s = _mm_shuffle_ps(a3, a3, _MM_SHUFFLE(2,3,0,1));
+		__m128 p = _mm_add_ps(_mm_mul_ps(a2, vre), _mm_xor_ps(_mm_mul_ps(a2s, vim), negim));
+		__m128 q = _mm_add_ps(_mm_mul_ps(a3, vre), _mm_xor_ps(_mm_mul_ps(a3s, vim), negre));
+
+		//BUTTERFLIES: s is (t5, t6), d is (t3, -t4)
+		__m128 s = _mm_add_ps(q, p);
+		__m128 d = _mm_sub_ps(q, p);
+		__m128 e = _mm_xor_ps(_mm_shuffle_ps(d, d, _MM_SHUFFLE(2,3,0,1)), negre);
+		_mm_storeu_ps(&z[o2].re, _mm_sub_ps(a0, s));
+		_mm_storeu_ps(&z[0].re, _mm_add_ps(a0, s));
+		_mm_storeu_ps(&z[o3].re, _mm_sub_ps(a1, e));
+		_mm_storeu_ps(&z[o1].re, _mm_add_ps(a1, e));
+	} while (--n);
+}
+
+/* idct */
+
+//the low 32 bits of v * c in each lane, like the int multiplications of
+//bink_idct, from 16 bit products (0 <= c < 0x8000)
+SSE2_TARGET static SSE2_INLINE __m128i mul_lo(__m128i v, int c)
+{
+	__m128i k = _mm_set1_epi16((short) c);
+	//lo*c + (hi*c << 16), the high half of hi*c is shifted out
+	return _mm_add_epi32(_mm_mullo_epi16(v, k), _mm_slli_epi32(_mm_mulhi_epu16(v, k), 16));
+}
+
+#define MUL(v, c) _mm_srai_epi32(mul_lo(v, c), 11)
+#define ADD(a, b) _mm_add_epi32(a, b)
+#define SUB(a, b) _mm_sub_epi32(a, b)
+
+//one pass of bink_idct on four columns (or rows) at once
+SSE2_TARGET static SSE2_INLINE void idct_1d(__m128i *v)
+{
+	__m128i t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, tA, tB, tC;
+
+	t0 = ADD(v[0], v[4]);
+	t1 = SUB(v[0], v[4]);
+	t2 = ADD(v[2], v[6]);
+	t3 = SUB(v[2], v[6]);
+	t3 = SUB(MUL(t3, 0xB50), t2);
+
+	t4 = SUB(t0, t2);
+	t5 = ADD(t0, t2);
+	t6 = ADD(t1, t3);
+	t7 = SUB(t1, t3);
+
+	t0 = ADD(v[5], v[3]);
+	t1 = SUB(v[5], v[3]);
+	t2 = ADD(v[1], v[7]);
+	t3 = SUB(v[1], v[7]);
+
+	t8 = ADD(t2, t0);
+	t9 = ADD(t3, t1);
+	t9 = MUL(t9, 0xEC8);
+	tA = SUB(ADD(_mm_srai_epi32(SUB(_mm_setzero_si128(), mul_lo(t1, 0x14E8)), 11), t9), t8);
+	tB = SUB(t2, t0);
+	tB = SUB(MUL(tB, 0xB50), tA);
+	tC = SUB(ADD(MUL(t3, 0x8A9), tB), t9);
+
+	v[0] = ADD(t5, t8);
+	v[7] = SUB(t5, t8);
+	v[1] = ADD(t6, tA);
+	v[6] = SUB(t6, tA);
+	v[2] = ADD(t7, tB);
+	v[5] = SUB(t7, tB);
+	v[4] = ADD(t4, tC);
+	v[3] = SUB(t4, tC);
+}
+
+#undef MUL
+#undef ADD
+#undef SUB
+
+SSE2_TARGET static SSE2_INLINE void transpose4(__m128i *a, __m128i *b, __m128i *c, __m128i *d)
+{
+	__m128i t0 = _mm_unpacklo_epi32(*a, *b);
+	__m128i t1 = _mm_unpacklo_epi32(*c, *d);
+	__m128i t2 = _mm_unpackhi_epi32(*a, *b);
+	__m128i t3 = _mm_unpackhi_epi32(*c, *d);
+	*a = _mm_unpacklo_epi64(t0, t1);
+	*b = _mm_unpackhi_epi64(t0, t1);
+	*c = _mm_unpacklo_epi64(t2, t3);
+	*d = _mm_unpackhi_epi64(t2, t3);
+}
+
+//the four rows of cols (left and right half) rounded and stored as shorts
+SSE2_TARGET static SSE2_INLINE void store_rows(DCTELEM *block, __m128i *cols)
+{
+	const __m128i round = _mm_set1_epi32(0x7F);
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		//the C version truncates the ints to shorts
+		cols[i] = _mm_srai_epi32(_mm_add_epi32(cols[i], round), 8);
+		cols[i] = _mm_srai_epi32(_mm_slli_epi32(cols[i], 16), 16);
+	}
+	transpose4(cols, cols + 1, cols + 2, cols + 3);
+	transpose4(cols + 4, cols + 5, cols + 6, cols + 7);
+	for (i = 0; i < 4; i++) {
+		_mm_storeu_si128((__m128i *) (block + 8*i), _mm_packs_epi32(cols[i], cols[i+4]));
+	}
+}
+
+SSE2_TARGET static void bink_idct_sse2(DCTELEM *block)
+{
+	//left and right half of each row
+	__m128i left[8], right[8];
+	//the columns of the top and bottom half of the block
+	__m128i top[8], bottom[8];
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		__m128i row = _mm_loadu_si128((const __m128i *) (block + 8*i));
+		left[i] = _mm_srai_epi32(_mm_unpacklo_epi16(row, row), 16);
+		right[i] = _mm_srai_epi32(_mm_unpackhi_epi16(row, row), 16);
+	}
+	idct_1d(left);
+	idct_1d(right);
+
+	for (i = 0; i < 4; i++) {
+		top[i] = left[i];
+		top[i+4] = right[i];
+		bottom[i] = left[i+4];
+		bottom[i+4] = right[i+4];
+	}
+	transpose4(top, top + 1, top + 2, top + 3);
+	transpose4(top + 4, top + 5, top + 6, top + 7);
+	transpose4(bottom, bottom + 1, bottom + 2, bottom + 3);
+	transpose4(bottom + 4, bottom + 5, bottom + 6, bottom + 7);
+	idct_1d(top);
+	idct_1d(bottom);
+
+	store_rows(block, top);
+	store_rows(block + 32, bottom);
+}
+
+/* pixels */
+
+SSE2_TARGET static void put_pixels_nonclamped_sse2(const DCTELEM *block, uint8_t *pixels, int line_size)
+{
+	const __m128i mask = _mm_set1_epi16(0xFF);
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		__m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i *) block), mask);
+		_mm_storel_epi64((__m128i *) pixels, _mm_packus_epi16(b, b));
+		pixels += line_size;
+		block += 8;
+	}
+}
+
+SSE2_TARGET static void add_pixels_nonclamped_sse2(const DCTELEM *block, uint8_t *pixels, int line_size)
+{
+	const __m128i mask = _mm_set1_epi16(0xFF);
+	const __m128i zero = _mm_setzero_si128();
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		__m128i p = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) pixels), zero);
+		p = _mm_add_epi16(p, _mm_loadu_si128((const __m128i *) block));
+		p = _mm_and_si128(p, mask);
+		_mm_storel_epi64((__m128i *) pixels, _mm_packus_epi16(p, p));
+		pixels += line_size;
+		block += 8;
+	}
+}
+
+SSE2_TARGET static void copy_block_sse2(DCTELEM *block, const uint8_t *src, uint8_t *dst, int stride)
+{
+	const __m128i zero = _mm_setzero_si128();
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		__m128i p = _mm_loadl_epi64((const __m128i *) src);
+		_mm_storel_epi64((__m128i *) dst, p);
+		_mm_storeu_si128((__m128i *) block, _mm_unpacklo_epi8(p, zero));
+		src += stride;
+		dst += stride;
+		block += 8;
+	}
+}
+
+SSE2_TARGET static void idct_put_sse2(uint8_t *dest, int line_size, DCTELEM *block)
+{
+	bink_idct_sse2(block);
+	put_pixels_nonclamped_sse2(block, dest, line_size);
+}
+
+SSE2_TARGET static void idct_add_sse2(uint8_t *dest, int line_size, DCTELEM *block)
+{
+	bink_idct_sse2(block);
+	add_pixels_nonclamped_sse2(block, dest, line_size);
+}
+
+/* samples */
+
+//clamped like float_to_int16_one, then truncated
+SSE2_TARGET static SSE2_INLINE __m128i float_to_int32_sse2(const float *src)
+{
+	__m128 f = _mm_loadu_ps(src);
+	f = _mm_min_ps(_mm_max_ps(f, _mm_set1_ps(-32768.0f)), _mm_set1_ps(32767.0f));
+	return _mm_cvttps_epi32(f);
+}
+
+static inline int16_t float_to_int16_one(float f)
+{
+	if (f > 32767.0)
+		return 32767;
+	else if (f < -32768.0)
+		return -32768;
+	return (int16_t) (int32_t) f;
+}
+
+SSE2_TARGET static void float_to_int16_interleave_sse2(int16_t *dst, const float **src, long len, int channels)
+{
+	long i = 0;
+
+	if (channels == 2) {
+		for (; i + 4 <= len; i += 4) {
+			__m128i l = float_to_int32_sse2(src[0] + i);
+			__m128i r = float_to_int32_sse2(src[1] + i);
+			__m128i lo = _mm_unpacklo_epi32(l, r);
+			__m128i hi = _mm_unpackhi_epi32(l, r);
+			_mm_storeu_si128((__m128i *) (dst + 2*i), _mm_packs_epi32(lo, hi));
+		}
+		for (; i < len; i++) {
+			dst[2*i]   = float_to_int16_one(src[0][i]);
+			dst[2*i+1] = float_to_int16_one(src[1][i]);
+		}
+		return;
+	}
+	//one channel
+	for (; i + 8 <= len; i += 8) {
+		__m128i a = float_to_int32_sse2(src[0] + i);
+		__m128i b = float_to_int32_sse2(src[0] + i + 4);
+		_mm_storeu_si128((__m128i *) (dst + i), _mm_packs_epi32(a, b));
+	}
+	for (; i < len; i++) {
+		dst[i] = float_to_int16_one(src[0][i]);
+	}
+}
+
+void dsputil_init_sse2(DSPContext* c)
+{
+	c->idct = bink_idct_sse2;
+	c->idct_put = idct_put_sse2;
+	c->idct_add = idct_add_sse2;
+	c->put_pixels_nonclamped = put_pixels_nonclamped_sse2;
+	c->add_pixels_nonclamped = add_pixels_nonclamped_sse2;
+	c->copy_block = copy_block_sse2;
+	c->float_to_int16_interleave = float_to_int16_interleave_sse2;
+}
+
+#endif
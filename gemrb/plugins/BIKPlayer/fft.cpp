@@ -243,6 +243,16 @@ av_cold void ff_fft_end(FFTContext *s)
     BUTTERFLIES(a0,a1,a2,a3)\
 }
 
+#if HAVE_SSE2
+#define PASS_SSE2 \
+    if (mm_flags & FF_MM_SSE2) {\
+        ff_fft_pass_sse2(z, wre, o1, n);\
+        return;\
+    }
+#else
+#define PASS_SSE2
+#endif
+
 /* z[0...8n-1], w[1...2n-1] */
 #define PASS(name)\
 static void name(FFTComplex *z, const FFTSample *wre, unsigned int n)\
@@ -256,6 +266,7 @@ static void name(FFTComplex *z, const FFTSample *wre, unsigned int n)\
 \
     TRANSFORM_ZERO(z[0],z[o1],z[o2],z[o3]);\
     TRANSFORM(z[1],z[o1+1],z[o2+1],z[o3+1],wre[1],wim[-1]);\
+    PASS_SSE2\
     do {\
         z += 2;\
         wre += 2;\
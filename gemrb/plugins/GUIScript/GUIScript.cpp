@@ -55,6 +55,7 @@
 #include "Scriptable/Door.h"
 #include "Scriptable/InfoPoint.h"
 #include "System/FileStream.h"
+#include "System/Profiler.h"
 #include "System/VFS.h"
 
 #include <cstdio>
@@ -3626,6 +3627,18 @@ static PyObject* GemRB_PlaySound(PyObject * /*self*/, PyObject* args)
 	return Py_None;
 }
 
+PyDoc_STRVAR( GemRB_PrintSoundStats__doc,
+"PrintSoundStats()\n\n"
+"Prints the size, hits, misses and evictions of the sound cache." );
+
+static PyObject* GemRB_PrintSoundStats(PyObject * /*self*/, PyObject * /*args*/)
+{
+	core->GetAudioDrv()->PrintStats();
+
+	Py_INCREF( Py_None );
+	return Py_None;
+}
+
 PyDoc_STRVAR( GemRB_DrawWindows__doc,
 "DrawWindows()\n\n"
 "Refreshes the User Interface." );
@@ -10098,6 +10111,7 @@ static PyMethodDef GemRBMethods[] = {
 	METHOD(Quit, METH_NOARGS),
 	METHOD(QuitGame, METH_NOARGS),
 	METHOD(PlaySound, METH_VARARGS),
+	METHOD(PrintSoundStats, METH_NOARGS),
 	METHOD(PlayMovie, METH_VARARGS),
 	METHOD(RemoveItem, METH_VARARGS),
 	METHOD(RemoveSpell, METH_VARARGS),
@@ -10554,6 +10568,7 @@ PyObject *GUIScript::CallbackFunction(const char* fname, PyObject* pArgs)
 
 bool GUIScript::RunFunction(const char *ModuleName, const char* FunctionName, bool error, int intparam)
 {
+	PROFILE_SCOPE(PROFILE_GUISCRIPT);
 	if (!Py_IsInitialized()) {
 		return false;
 	}
@@ -234,7 +234,7 @@ static EffectDesc effectnames[] = {
 	{ "ChillTouch", fx_chill_touch, 0, -1 }, //ec (how)
 	{ "ChillTouchPanic", fx_chill_touch_panic, 0, -1 }, //ec (iwd2)
 	{ "CrushingDamage", fx_crushing_damage, EFFECT_DICED, -1 }, //ed
-	{ "SaveBonus", fx_save_bonus, 0, -1 }, //ee
+	{ "SaveBonus", fx_save_bonus, EFFECT_STATIC, -1 }, //ee
 	{ "SlowPoison", fx_slow_poison, 0, -1 }, //ef
 	{ "IWDMonsterSummoning", fx_iwd_monster_summoning, EFFECT_NO_ACTOR, -1 }, //f0
 	{ "VampiricTouch", fx_vampiric_touch, EFFECT_DICED, -1 }, //f1
@@ -286,7 +286,7 @@ static EffectDesc effectnames[] = {
 	{ "BeholderDispelMagic", fx_beholder_dispel_magic, 0, -1 },//125
 	{ "HarpyWail", fx_harpy_wail, 0, -1 }, //126
 	{ "JackalWereGaze", fx_jackalwere_gaze, 0, -1 }, //127
-	{ "UseMagicDeviceModifier", fx_use_magic_device_modifier, 0, -1 }, //12a
+	{ "UseMagicDeviceModifier", fx_use_magic_device_modifier, EFFECT_STATIC, -1 }, //12a
 	//unhardcoded hacks for IWD
 	{ "AlterAnimation", fx_alter_animation, EFFECT_NO_ACTOR, -1 }, //399
 	//iwd2 effects
@@ -27,14 +27,22 @@
 #include "Interface.h"
 #include "ResourceDesc.h"
 #include "System/FileStream.h"
+#include "System/Profiler.h"
 
 KEYImporter::KEYImporter(void)
 {
 	description = NULL;
+	cacheClock = 0;
+	cacheHits = 0;
+	cacheMisses = 0;
 }
 
 KEYImporter::~KEYImporter(void)
 {
+	if (Profiler::Enabled && description) {
+		printMessage("KEYImporter", "%s archive cache: %u hits, %u misses\n", WHITE,
+			description, cacheHits, cacheMisses);
+	}
 	free(description);
 	for (unsigned int i = 0; i < biffiles.size(); i++) {
 		free( biffiles[i].name );
@@ -241,6 +249,35 @@ static void FindBIFOnCD(BIFEntry *entry)
 	entry->found = PathExists(entry, core->CD[entry->cd-1]);
 }
 
+// keeps the last few BIFs open, so switching between them doesn't
+// reopen the file and reparse its tables every time
+ArchiveImporter *KEYImporter::GetArchive(unsigned int bifnum)
+{
+	cacheClock++;
+	unsigned int oldest = 0;
+	for (unsigned int i = 0; i < KEY_CACHE_SIZE; i++) {
+		if (cache[i].bifnum == bifnum) {
+			cache[i].lastused = cacheClock;
+			cacheHits++;
+			return cache[i].plugin.get();
+		}
+		if (cache[i].lastused < cache[oldest].lastused) {
+			oldest = i;
+		}
+	}
+	cacheMisses++;
+
+	PluginHolder<ArchiveImporter> ai(IE_BIF_CLASS_ID);
+	if (ai->OpenArchive( biffiles[bifnum].path ) == GEM_ERROR) {
+		print("Cannot open archive %s\n", biffiles[bifnum].path );
+		return NULL;
+	}
+	cache[oldest].bifnum = bifnum;
+	cache[oldest].lastused = cacheClock;
+	cache[oldest].plugin = ai;
+	return ai.get();
+}
+
 DataStream* KEYImporter::GetStream(const char *resname, ieWord type)
 {
 	if (type == 0)
@@ -260,18 +297,12 @@ DataStream* KEYImporter::GetStream(const char *resname, ieWord type)
 		return NULL;
 	}
 
-	// simple one-BIF cache to avoid opening the same BIF repeatedly
-	if (lastSeenCache.bifnum != bifnum) {
-		PluginHolder<ArchiveImporter> ai(IE_BIF_CLASS_ID);
-		if (ai->OpenArchive( biffiles[bifnum].path ) == GEM_ERROR) {
-			print("Cannot open archive %s\n", biffiles[bifnum].path );
-			return NULL;
-		}
-		lastSeenCache.bifnum = bifnum;
-		lastSeenCache.plugin = ai;
+	ArchiveImporter *ai = GetArchive(bifnum);
+	if (!ai) {
+		return NULL;
 	}
 
-	DataStream* ret = lastSeenCache.plugin->GetStream( *ResLocator, type );
+	DataStream* ret = ai->GetStream( *ResLocator, type );
 	if (ret) {
 		strnlwrcpy( ret->filename, resname, 8 );
 		strcat( ret->filename, "." );
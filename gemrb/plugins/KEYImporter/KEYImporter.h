@@ -39,10 +39,14 @@ struct BIFEntry {
 	bool found;
 };
 
+//number of archives kept open at once
+#define KEY_CACHE_SIZE 8
+
 struct KEYCache {
-	KEYCache() { bifnum = 0xffffffff; }
+	KEYCache() { bifnum = 0xffffffff; lastused = 0; }
 
 	unsigned int bifnum;
+	unsigned int lastused;
 	PluginHolder<ArchiveImporter> plugin;
 };
 
@@ -51,10 +55,15 @@ private:
 	std::vector< BIFEntry> biffiles;
 	HashMap<ieDword> resources;
 
-	KEYCache lastSeenCache;
+	//LRU of the opened archives, areas tend to pull from several at once
+	KEYCache cache[KEY_CACHE_SIZE];
+	unsigned int cacheClock;
+	unsigned int cacheHits, cacheMisses;
 
 	/** Gets the stream assoicated to a RESKey */
 	DataStream *GetStream(const char *resname, ieWord type);
+	/** Returns the opened archive for a bif, NULL if it can't be opened */
+	ArchiveImporter *GetArchive(unsigned int bifnum);
 public:
 	KEYImporter(void);
 	~KEYImporter(void);
@@ -65,6 +74,8 @@ public:
 	/* returns resource */
 	DataStream* GetResource(const char* resname, SClass_ID type);
 	DataStream* GetResource(const char* resname, const ResourceDesc &type);
+	unsigned int GetCacheHits() const { return cacheHits; }
+	unsigned int GetCacheMisses() const { return cacheMisses; }
 };
 
 #endif
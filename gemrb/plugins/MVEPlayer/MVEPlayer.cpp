@@ -46,6 +46,7 @@ static ieDword *strRef = NULL;
 MVEPlay::MVEPlay(void)
 {
 	video = core->GetVideoDriver();
+	player = NULL;
 }
 
 MVEPlay::~MVEPlay(void)
@@ -87,9 +88,13 @@ int MVEPlay::Play()
 	return doPlay( );
 }
 
+bool MVEPlay::DecodeFrame()
+{
+	return player->next_frame();
+}
+
 int MVEPlay::doPlay()
 {
-	int done = 0;
 	MVEPlayer player(this);
 
 	memset( g_palette, 0, 768 );
@@ -110,9 +115,9 @@ int MVEPlay::doPlay()
 
 	g_truecolor = player.is_truecolour();
 
-	while (!done && player.next_frame()) {
-		done = video->PollMovieEvents();
-	}
+	this->player = &player;
+	PlayQueued(player.get_frame_wait());
+	this->player = NULL;
 
 	video->DrawMovieSubtitle(0);
 	return 0;
@@ -126,6 +131,15 @@ unsigned int MVEPlay::fileRead(void* buf, unsigned int count)
 	return ( numread == count );
 }
 
+//a decoded picture, followed by its pixels
+struct MVEFrame {
+	unsigned int bufw, bufh, sx, sy, w, h, dstx, dsty;
+	int truecolor;
+	unsigned char palette[768];
+	ieDword titleref;
+};
+
+//copies the picture (and palette), it is shown later by the main thread
 void MVEPlay::showFrame(unsigned char* buf, unsigned int bufw,
 	unsigned int bufh, unsigned int sx, unsigned int sy, unsigned int w,
 	unsigned int h, unsigned int dstx, unsigned int dsty)
@@ -142,7 +156,30 @@ void MVEPlay::showFrame(unsigned char* buf, unsigned int bufw,
 			titleref = strRef[rowCount-1];
 		}
 	}
-	video->showFrame(buf,bufw,bufh,sx,sy,w,h,dstx,dsty, g_truecolor, g_palette, titleref);
+
+	unsigned int size = bufw * bufh * (g_truecolor ? 2 : 1);
+	MVEFrame *frame = (MVEFrame *) malloc(sizeof(MVEFrame) + size);
+	memcpy(frame + 1, buf, size);
+	frame->bufw = bufw;
+	frame->bufh = bufh;
+	frame->sx = sx;
+	frame->sy = sy;
+	frame->w = w;
+	frame->h = h;
+	frame->dstx = dstx;
+	frame->dsty = dsty;
+	frame->truecolor = g_truecolor;
+	memcpy(frame->palette, g_palette, 768);
+	frame->titleref = titleref;
+	QueueFrame((char *) frame);
+}
+
+void MVEPlay::PresentFrame(char *data)
+{
+	MVEFrame *frame = (MVEFrame *) data;
+	video->showFrame((unsigned char *) (frame + 1), frame->bufw, frame->bufh,
+		frame->sx, frame->sy, frame->w, frame->h, frame->dstx, frame->dsty,
+		frame->truecolor, frame->palette, frame->titleref);
 }
 
 void MVEPlay::setPalette(unsigned char* p, unsigned start, unsigned count)
@@ -176,7 +213,7 @@ void MVEPlay::queueBuffer(int stream, unsigned short bits,
 			int size, int samplerate)
 {
 	if (stream > -1)
-		core->GetAudioDrv()->QueueBuffer(stream, bits, channels, memory, size, samplerate) ;
+		QueueAudio(stream, bits, channels, memory, size, samplerate);
 }
 
 
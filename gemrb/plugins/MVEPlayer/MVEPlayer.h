@@ -33,6 +33,7 @@ class MVEPlay : public MoviePlayer {
 private:
 	Video *video;
 	bool validVideo;
+	class MVEPlayer *player;
 	int doPlay();
 	unsigned int fileRead(void* buf, unsigned int count);
 	void showFrame(unsigned char* buf, unsigned int bufw,
@@ -46,6 +47,9 @@ private:
 	void queueBuffer(int stream, unsigned short bits,
 				int channels, short* memory,
 				int size, int samplerate);
+protected:
+	bool DecodeFrame();
+	void PresentFrame(char *data);
 public:
 	MVEPlay(void);
 	~MVEPlay(void);
@@ -0,0 +1,596 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "NullVideo.h"
+
+#include "AnimationFactory.h"
+#include "Palette.h"
+#include "SpriteCover.h"
+
+#include <cassert>
+#include <cstring>
+
+// this is what the vptr of a non-BAM sprite points to
+// it mirrors the few bits of an SDL_Surface the core cares about
+struct NullSurface {
+	int w, h, bpp;
+	ieDword mask[4]; //r,g,b,a
+	void* pixels;
+	Palette* pal; //8 bit surfaces only
+};
+
+static NullSurface* CreateSurface(int w, int h, int bpp, void* pixels)
+{
+	NullSurface* surf = new NullSurface;
+	surf->w = w;
+	surf->h = h;
+	surf->bpp = bpp;
+	memset(surf->mask, 0, sizeof(surf->mask));
+	surf->pixels = pixels;
+	surf->pal = NULL;
+	return surf;
+}
+
+static void FreeSurface(NullSurface* surf)
+{
+	if (surf->pal) {
+		surf->pal->Release();
+	}
+	delete surf;
+}
+
+static inline unsigned char MaskedChannel(ieDword val, ieDword mask)
+{
+	if (!mask) {
+		return 0xff;
+	}
+	while (!(mask&1)) {
+		mask >>= 1;
+		val >>= 1;
+	}
+	val &= mask;
+	//scale 5 and 6 bit channels up to 8 bits
+	while (mask < 0x80) {
+		mask = (mask<<1)|1;
+		val = (val<<1)|(val&1);
+	}
+	return (unsigned char) val;
+}
+
+NullVideoDriver::NullVideoDriver(void)
+{
+	Cursor[0] = NULL;
+	Cursor[1] = NULL;
+	Cursor[2] = NULL;
+	CursorIndex = 0;
+	CursorPos.x = 0;
+	CursorPos.y = 0;
+	DisableMouse = 0;
+	xCorr = 0;
+	yCorr = 0;
+	width = 0;
+	height = 0;
+	bpp = 0;
+	fullscreen = false;
+	QuitPending = false;
+}
+
+NullVideoDriver::~NullVideoDriver(void)
+{
+	// same as for SDLVideo, the drag cursor has to be freed earlier
+	assert(Cursor[2] == NULL);
+}
+
+int NullVideoDriver::Init(void)
+{
+	return GEM_OK;
+}
+
+int NullVideoDriver::CreateDisplay(int w, int h, int b, bool fs)
+{
+	printMessage( "NullVideo", "Creating headless display\n", WHITE );
+	width = w;
+	height = h;
+	bpp = b;
+	fullscreen = fs;
+	Viewport.x = Viewport.y = 0;
+	Viewport.w = width;
+	Viewport.h = height;
+	ClipRect = Viewport;
+	return GEM_OK;
+}
+
+void NullVideoDriver::SetDisplayTitle(char* /*title*/, char* /*icon*/)
+{
+}
+
+bool NullVideoDriver::ToggleFullscreenMode(int set_reset)
+{
+	if (set_reset==-1) {
+		set_reset=!fullscreen;
+	}
+	if (fullscreen != (bool) set_reset) {
+		fullscreen = (bool) set_reset;
+		return true;
+	}
+	return false;
+}
+
+// there is no frame limiter here on purpose, the caller decides the pace
+int NullVideoDriver::SwapBuffers(void)
+{
+	if (QuitPending) {
+		QuitPending = false;
+		return GEM_ERROR;
+	}
+	return GEM_OK;
+}
+
+bool NullVideoDriver::ToggleGrabInput()
+{
+	return false;
+}
+
+void NullVideoDriver::InitSpriteCover(SpriteCover* sc, int flags)
+{
+	sc->flags = flags;
+	sc->pixels = new unsigned char[sc->Width * sc->Height];
+	memset(sc->pixels, 0, sc->Width * sc->Height);
+}
+
+void NullVideoDriver::AddPolygonToSpriteCover(SpriteCover* /*sc*/, Wall_Polygon* /*poly*/)
+{
+}
+
+void NullVideoDriver::DestroySpriteCover(SpriteCover* sc)
+{
+	delete[] sc->pixels;
+	sc->pixels = 0;
+}
+
+void NullVideoDriver::GetMousePos(int &x, int &y)
+{
+	x = CursorPos.x;
+	y = CursorPos.y;
+}
+
+void NullVideoDriver::MoveMouse(unsigned int x, unsigned int y)
+{
+	CursorPos.x = (short) x;
+	CursorPos.y = (short) y;
+}
+
+void NullVideoDriver::ClickMouse(unsigned int /*button*/)
+{
+}
+
+Sprite2D* NullVideoDriver::CreateSprite(int w, int h, int bpp, ieDword rMask,
+	ieDword gMask, ieDword bMask, ieDword aMask, void* pixels, bool /*cK*/, int /*index*/)
+{
+	Sprite2D* spr = new Sprite2D();
+	NullSurface* surf = CreateSurface(w, h, bpp, pixels);
+	surf->mask[0] = rMask;
+	surf->mask[1] = gMask;
+	surf->mask[2] = bMask;
+	surf->mask[3] = aMask;
+	spr->vptr = surf;
+	spr->pixels = pixels;
+	spr->Width = w;
+	spr->Height = h;
+	spr->Bpp = bpp;
+	return spr;
+}
+
+Sprite2D* NullVideoDriver::CreateSprite8(int w, int h, int bpp, void* pixels,
+	void* palette, bool /*cK*/, int /*index*/)
+{
+	Sprite2D* spr = new Sprite2D();
+	NullSurface* surf = CreateSurface(w, h, 8, pixels);
+	surf->pal = new Palette();
+	int colorcount = bpp == 8 ? 256 : 16;
+	if (palette) {
+		memcpy(surf->pal->col, palette, colorcount*sizeof(Color));
+	}
+	spr->vptr = surf;
+	spr->pixels = pixels;
+	spr->Width = w;
+	spr->Height = h;
+	spr->Bpp = bpp;
+	return spr;
+}
+
+Sprite2D* NullVideoDriver::CreateSpriteBAM8(int w, int h, bool rle,
+					 const unsigned char* pixeldata,
+					 AnimationFactory* datasrc,
+					 Palette* palette, int transindex)
+{
+	Sprite2D* spr = new Sprite2D();
+	spr->BAM = true;
+	Sprite2D_BAM_Internal* data = new Sprite2D_BAM_Internal;
+	spr->vptr = data;
+
+	palette->IncRef();
+	data->pal = palette;
+	data->transindex = transindex;
+	data->flip_hor = false;
+	data->flip_ver = false;
+	data->RLE = rle;
+	data->source = datasrc;
+	datasrc->IncDataRefCount();
+
+	spr->pixels = (const void*)pixeldata;
+	spr->Width = w;
+	spr->Height = h;
+	spr->Bpp = 8;
+
+	return spr;
+}
+
+void NullVideoDriver::FreeSprite(Sprite2D*& spr)
+{
+	if(!spr)
+		return;
+	assert(spr->RefCount > 0);
+	if (--spr->RefCount > 0) {
+		spr = NULL;
+		return;
+	}
+
+	if (spr->BAM) {
+		if (spr->vptr) {
+			Sprite2D_BAM_Internal* tmp = (Sprite2D_BAM_Internal*)spr->vptr;
+			tmp->source->DecDataRefCount();
+			delete tmp;
+		}
+	} else {
+		if (spr->vptr) {
+			FreeSurface( (NullSurface*) spr->vptr );
+		}
+		free( (void*)spr->pixels );
+	}
+	delete spr;
+	spr = NULL;
+}
+
+Sprite2D* NullVideoDriver::DuplicateSprite(const Sprite2D* sprite)
+{
+	if (!sprite) return NULL;
+	Sprite2D* dest = 0;
+
+	if (!sprite->BAM) {
+		NullSurface* surf = (NullSurface*) sprite->vptr;
+		int size = sprite->Width*sprite->Height*(surf->bpp/8);
+		void *newpixels = malloc( size );
+		memcpy(newpixels, sprite->pixels, size);
+		if (surf->pal) {
+			dest = CreateSprite8(sprite->Width, sprite->Height, 8,
+				newpixels, surf->pal->col, true, 0);
+		} else {
+			dest = CreateSprite(sprite->Width, sprite->Height, surf->bpp,
+				surf->mask[0], surf->mask[1], surf->mask[2], surf->mask[3],
+				newpixels);
+		}
+	} else {
+		Sprite2D_BAM_Internal* data = (Sprite2D_BAM_Internal*) sprite->vptr;
+
+		dest = CreateSpriteBAM8(sprite->Width, sprite->Height, data->RLE,
+			(const unsigned char*) sprite->pixels, data->source, data->pal,
+			data->transindex);
+		Sprite2D_BAM_Internal* destdata = (Sprite2D_BAM_Internal*)dest->vptr;
+		destdata->flip_ver = data->flip_ver;
+		destdata->flip_hor = data->flip_hor;
+	}
+
+	dest->XPos = sprite->XPos;
+	dest->YPos = sprite->YPos;
+	return dest;
+}
+
+void NullVideoDriver::BlitSpriteRegion(const Sprite2D* /*spr*/, const Region& /*size*/,
+	int /*x*/, int /*y*/, bool /*anchor*/, const Region* /*clip*/)
+{
+}
+
+void NullVideoDriver::BlitTile(const Sprite2D* /*spr*/, const Sprite2D* /*mask*/,
+	int /*x*/, int /*y*/, const Region* /*clip*/, bool /*trans*/)
+{
+}
+
+void NullVideoDriver::BlitSprite(const Sprite2D* /*spr*/, int /*x*/, int /*y*/,
+	bool /*anchor*/, const Region* /*clip*/)
+{
+}
+
+void NullVideoDriver::BlitGameSprite(const Sprite2D* /*spr*/, int /*x*/, int /*y*/,
+	unsigned int /*flags*/, Color /*tint*/, SpriteCover* /*cover*/,
+	Palette* /*palette*/, const Region* /*clip*/, bool /*anchor*/)
+{
+}
+
+void NullVideoDriver::SetCursor(Sprite2D* up, Sprite2D* down)
+{
+	Cursor[0] = up;
+	Cursor[1] = down;
+}
+
+void NullVideoDriver::SetDragCursor(Sprite2D* drag)
+{
+	FreeSprite(Cursor[2]);
+	if (drag) {
+		Cursor[2] = drag;
+		CursorIndex = 2;
+	} else {
+		CursorIndex = 0;
+		Cursor[2] = NULL;
+	}
+}
+
+//the screen is always black
+Sprite2D* NullVideoDriver::GetScreenshot( Region r )
+{
+	unsigned int Width = r.w ? r.w : width;
+	unsigned int Height = r.h ? r.h : height;
+
+	void* pixels = calloc( Width * Height, 3 );
+	return CreateSprite( Width, Height, 24, 0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000, pixels, false, 0 );
+}
+
+void NullVideoDriver::ConvertToVideoFormat(Sprite2D* /*sprite*/)
+{
+}
+
+void NullVideoDriver::SetPalette(void *data, Palette* pal)
+{
+	NullSurface* surf = (NullSurface*) data;
+	if (!surf->pal) {
+		surf->pal = new Palette();
+	}
+	memcpy(surf->pal->col, pal->col, sizeof(surf->pal->col));
+}
+
+void NullVideoDriver::DrawRect(const Region& /*rgn*/, const Color& /*color*/, bool /*fill*/, bool /*clipped*/)
+{
+}
+
+void NullVideoDriver::DrawRectSprite(const Region& /*rgn*/, const Color& /*color*/, const Sprite2D* /*sprite*/)
+{
+}
+
+void NullVideoDriver::SetPixel(short /*x*/, short /*y*/, const Color& /*color*/, bool /*clipped*/)
+{
+}
+
+void NullVideoDriver::GetPixel(short /*x*/, short /*y*/, Color& c)
+{
+	c.r = c.g = c.b = 0;
+	c.a = 0xff;
+}
+
+long NullVideoDriver::GetPixel(void *vptr, unsigned short x, unsigned short y)
+{
+	NullSurface* surf = (NullSurface*) vptr;
+	int bytes = surf->bpp/8;
+	const unsigned char* pixel = (const unsigned char*) surf->pixels + (y*surf->w + x)*bytes;
+
+	switch (bytes) {
+	case 1:
+		return *pixel;
+	case 2:
+		return *(const ieWord*) pixel;
+	case 3:
+		return pixel[0] | (pixel[1]<<8) | (pixel[2]<<16);
+	default:
+		return *(const ieDword*) pixel;
+	}
+}
+
+void NullVideoDriver::GetPixel(void *vptr, unsigned short x, unsigned short y, Color &c)
+{
+	NullSurface* surf = (NullSurface*) vptr;
+	long val = GetPixel(vptr, x, y);
+
+	if (surf->pal) {
+		c = surf->pal->col[val&0xff];
+		c.a = 0xff;
+		return;
+	}
+	c.r = MaskedChannel((ieDword) val, surf->mask[0]);
+	c.g = MaskedChannel((ieDword) val, surf->mask[1]);
+	c.b = MaskedChannel((ieDword) val, surf->mask[2]);
+	c.a = MaskedChannel((ieDword) val, surf->mask[3]);
+}
+
+void NullVideoDriver::DrawCircle(short /*cx*/, short /*cy*/, unsigned short /*r*/,
+	const Color& /*color*/, bool /*clipped*/)
+{
+}
+
+void NullVideoDriver::DrawEllipseSegment(short /*cx*/, short /*cy*/, unsigned short /*xr*/,
+	unsigned short /*yr*/, const Color& /*color*/, double /*anglefrom*/,
+	double /*angleto*/, bool /*drawlines*/, bool /*clipped*/)
+{
+}
+
+void NullVideoDriver::DrawEllipse(short /*cx*/, short /*cy*/, unsigned short /*xr*/,
+	unsigned short /*yr*/, const Color& /*color*/, bool /*clipped*/)
+{
+}
+
+void NullVideoDriver::DrawPolyline(Gem_Polygon* /*poly*/, const Color& /*color*/, bool /*fill*/)
+{
+}
+
+void NullVideoDriver::DrawLine(short /*x1*/, short /*y1*/, short /*x2*/, short /*y2*/,
+	const Color& /*color*/, bool /*clipped*/)
+{
+}
+
+bool NullVideoDriver::Quit()
+{
+	QuitPending = true;
+	return true;
+}
+
+Palette* NullVideoDriver::GetPalette(void *vptr)
+{
+	NullSurface* surf = (NullSurface*) vptr;
+	if (!surf->pal) {
+		return NULL;
+	}
+	return new Palette(surf->pal->col);
+}
+
+Sprite2D *NullVideoDriver::MirrorSpriteVertical(const Sprite2D* sprite, bool MirrorAnchor)
+{
+	if (!sprite || !sprite->vptr)
+		return NULL;
+
+	Sprite2D* dest = DuplicateSprite(sprite);
+
+	if (!sprite->BAM) {
+		int pitch = dest->Width*(((NullSurface*) dest->vptr)->bpp/8);
+		unsigned char* tmp = (unsigned char*) malloc( pitch );
+		unsigned char* top = (unsigned char*) dest->pixels;
+		unsigned char* bottom = top + ( dest->Height - 1 ) * pitch;
+		for (int y = 0; y < dest->Height / 2; y++) {
+			memcpy(tmp, top, pitch);
+			memcpy(top, bottom, pitch);
+			memcpy(bottom, tmp, pitch);
+			top += pitch;
+			bottom -= pitch;
+		}
+		free(tmp);
+	} else {
+		Sprite2D_BAM_Internal* destdata = (Sprite2D_BAM_Internal*)dest->vptr;
+		destdata->flip_ver = !destdata->flip_ver;
+	}
+
+	dest->XPos = sprite->XPos;
+	if (MirrorAnchor)
+		dest->YPos = sprite->Height - sprite->YPos;
+	else
+		dest->YPos = sprite->YPos;
+
+	return dest;
+}
+
+Sprite2D *NullVideoDriver::MirrorSpriteHorizontal(const Sprite2D* sprite, bool MirrorAnchor)
+{
+	if (!sprite || !sprite->vptr)
+		return NULL;
+
+	Sprite2D* dest = DuplicateSprite(sprite);
+
+	if (!sprite->BAM) {
+		int bytes = ((NullSurface*) dest->vptr)->bpp/8;
+		for (int y = 0; y < dest->Height; y++) {
+			unsigned char * dst = (unsigned char *) dest->pixels + ( y * dest->Width * bytes );
+			unsigned char * src = dst + ( dest->Width - 1 ) * bytes;
+			for (int x = 0; x < dest->Width / 2; x++) {
+				for (int i = 0; i < bytes; i++) {
+					unsigned char swp = dst[i];
+					dst[i] = src[i];
+					src[i] = swp;
+				}
+				dst += bytes;
+				src -= bytes;
+			}
+		}
+	} else {
+		Sprite2D_BAM_Internal* destdata = (Sprite2D_BAM_Internal*)dest->vptr;
+		destdata->flip_hor = !destdata->flip_hor;
+	}
+
+	if (MirrorAnchor)
+		dest->XPos = sprite->Width - sprite->XPos;
+	else
+		dest->XPos = sprite->XPos;
+	dest->YPos = sprite->YPos;
+
+	return dest;
+}
+
+void NullVideoDriver::SetFadeColor(int /*r*/, int /*g*/, int /*b*/)
+{
+}
+
+void NullVideoDriver::SetFadePercent(int /*percent*/)
+{
+}
+
+void NullVideoDriver::SetClipRect(const Region* clip)
+{
+	if (clip) {
+		ClipRect = *clip;
+	} else {
+		ClipRect = Region(0, 0, width, height);
+	}
+}
+
+void NullVideoDriver::GetClipRect(Region& clip)
+{
+	clip = ClipRect;
+}
+
+void NullVideoDriver::InitMovieScreen(int &w, int &h, bool /*yuv*/)
+{
+	w = width;
+	h = height;
+}
+
+void NullVideoDriver::SetMovieFont(Font* /*stfont*/, Palette* /*pal*/)
+{
+}
+
+void NullVideoDriver::showFrame(unsigned char* /*buf*/, unsigned int /*bufw*/,
+	unsigned int /*bufh*/, unsigned int /*sx*/, unsigned int /*sy*/,
+	unsigned int /*w*/, unsigned int /*h*/, unsigned int /*dstx*/,
+	unsigned int /*dsty*/, int /*truecolor*/, unsigned char* /*palette*/,
+	ieDword /*titleref*/)
+{
+}
+
+void NullVideoDriver::showYUVFrame(unsigned char** /*buf*/, unsigned int* /*strides*/,
+	unsigned int /*bufw*/, unsigned int /*bufh*/,
+	unsigned int /*w*/, unsigned int /*h*/,
+	unsigned int /*dstx*/, unsigned int /*dsty*/,
+	ieDword /*titleref*/)
+{
+}
+
+void NullVideoDriver::DrawMovieSubtitle(ieStrRef /*text*/)
+{
+}
+
+// there is nobody to watch it, so skip the movie right away
+int NullVideoDriver::PollMovieEvents()
+{
+	return 1;
+}
+
+void NullVideoDriver::SetGamma(int /*brightness*/, int /*contrast*/)
+{
+}
+
+#include "plugindef.h"
+
+GEMRB_PLUGIN(0x3D07A6E, "Null Video Driver")
+PLUGIN_DRIVER(NullVideoDriver, "none")
+END_PLUGIN()
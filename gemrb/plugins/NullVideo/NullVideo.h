@@ -0,0 +1,138 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef NULLVIDEODRIVER_H
+#define NULLVIDEODRIVER_H
+
+#include "Video.h"
+
+#include "win32def.h"
+
+/**
+ * Headless video driver. Nothing is ever drawn, but sprites keep
+ * their pixel data and palettes, so the core can still query them
+ * (pixel transparency, palette swaps, mirroring).
+ * Select it with VideoDriver=none in GemRB.cfg.
+ */
+
+class NullVideoDriver : public Video {
+private:
+	Sprite2D* Cursor[3];
+	unsigned short CursorIndex;
+	Point CursorPos;
+	Region ClipRect;
+	bool QuitPending;
+public:
+	NullVideoDriver(void);
+	~NullVideoDriver(void);
+	int Init(void);
+	int CreateDisplay(int width, int height, int bpp, bool fullscreen);
+	void SetDisplayTitle(char* title, char* icon);
+	bool ToggleFullscreenMode(int set_reset=-1);
+	int SwapBuffers(void);
+	bool ToggleGrabInput();
+	short GetWidth() { return (short) width; }
+	short GetHeight() { return (short) height; }
+
+	void InitSpriteCover(SpriteCover* sc, int flags);
+	void AddPolygonToSpriteCover(SpriteCover* sc, Wall_Polygon* poly);
+	void DestroySpriteCover(SpriteCover* sc);
+
+	void GetMousePos(int &x, int &y);
+	void MoveMouse(unsigned int x, unsigned int y);
+	void ClickMouse(unsigned int button);
+	Sprite2D* CreateSprite(int w, int h, int bpp, ieDword rMask,
+		ieDword gMask, ieDword bMask, ieDword aMask, void* pixels,
+		bool cK = false, int index = 0);
+	Sprite2D* CreateSprite8(int w, int h, int bpp, void* pixels,
+		void* palette, bool cK = false, int index = 0);
+	Sprite2D* CreateSpriteBAM8(int w, int h, bool RLE,
+		const unsigned char* pixeldata, AnimationFactory* datasrc,
+		Palette* palette, int transindex);
+	bool SupportsBAMSprites() { return true; }
+	void FreeSprite(Sprite2D*& spr);
+	Sprite2D* DuplicateSprite(const Sprite2D* spr);
+	void BlitSpriteRegion(const Sprite2D* spr, const Region& size, int x, int y,
+		bool anchor = true, const Region* clip = NULL);
+	void BlitTile(const Sprite2D* spr, const Sprite2D* mask, int x, int y, const Region* clip, bool trans);
+	void BlitSprite(const Sprite2D* spr, int x, int y, bool anchor = false,
+		const Region* clip = NULL);
+	void BlitGameSprite(const Sprite2D* spr, int x, int y, unsigned int flags, Color tint,
+		SpriteCover* cover, Palette *palette = NULL,
+		const Region* clip = NULL, bool anchor = false);
+	void SetCursor(Sprite2D* up, Sprite2D* down);
+	void SetDragCursor(Sprite2D* drag);
+	Sprite2D* GetScreenshot( Region r );
+	void ConvertToVideoFormat(Sprite2D* sprite);
+	void SetPalette(void* data, Palette* pal);
+	void DrawRect(const Region& rgn, const Color& color, bool fill = true, bool clipped = false);
+	void DrawRectSprite(const Region& rgn, const Color& color, const Sprite2D* sprite);
+	void SetPixel(short x, short y, const Color& color, bool clipped = false);
+	void GetPixel(short x, short y, Color& color);
+	long GetPixel(void *, unsigned short x, unsigned short y);
+	void GetPixel(void *, unsigned short x, unsigned short y, Color &color);
+	void DrawCircle(short cx, short cy, unsigned short r, const Color& color, bool clipped = true);
+	void DrawEllipseSegment(short cx, short cy, unsigned short xr, unsigned short yr, const Color& color,
+		double anglefrom, double angleto, bool drawlines = true, bool clipped = true);
+	void DrawEllipse(short cx, short cy, unsigned short xr,
+		unsigned short yr, const Color& color, bool clipped = true);
+	void DrawPolyline(Gem_Polygon* poly, const Color& color,
+		bool fill = false);
+	void DrawLine(short x1, short y1, short x2, short y2,
+		const Color& color, bool clipped = false);
+	bool Quit();
+	Palette* GetPalette(void *vptr);
+	Sprite2D *MirrorSpriteVertical(const Sprite2D *sprite, bool MirrorAnchor);
+	Sprite2D *MirrorSpriteHorizontal(const Sprite2D *sprite, bool MirrorAnchor);
+
+	void ConvertToGame(short& x, short& y)
+	{
+		x += Viewport.x;
+		y += Viewport.y;
+	}
+
+	void ConvertToScreen(short&x, short& y)
+	{
+		x -= Viewport.x;
+		y -= Viewport.y;
+	}
+
+	void SetFadeColor(int r, int g, int b);
+	void SetFadePercent(int percent);
+	void SetClipRect(const Region* clip);
+	void GetClipRect(Region& clip);
+	void InitMovieScreen(int &w, int &h, bool yuv=false);
+	void SetMovieFont(Font *stfont, Palette *pal);
+	void showFrame(unsigned char* buf, unsigned int bufw,
+		unsigned int bufh, unsigned int sx, unsigned int sy,
+		unsigned int w, unsigned int h, unsigned int dstx,
+		unsigned int dsty, int truecolor, unsigned char *palette,
+		ieDword titleref);
+	void showYUVFrame(unsigned char** buf, unsigned int *strides,
+		unsigned int bufw, unsigned int bufh,
+		unsigned int w, unsigned int h,
+		unsigned int dstx, unsigned int dsty,
+		ieDword titleref);
+	void DrawMovieSubtitle(ieStrRef text);
+	int PollMovieEvents();
+	void SetGamma(int brightness, int contrast);
+};
+
+#endif
@@ -21,6 +21,7 @@
 #include "OpenALAudio.h"
 
 #include "GameData.h"
+#include "System/Profiler.h"
 
 #include <cassert>
 #include <cstdio>
@@ -98,7 +99,8 @@ void AudioStream::ClearProcessedBuffers()
 
 void AudioStream::ClearIfStopped()
 {
-	if (free || locked) return;
+	//a pending sound may not have started yet or ran out of decoded data
+	if (free || locked || pending) return;
 
 	if (!alIsSource(Source)) return;
 
@@ -122,6 +124,7 @@ void AudioStream::ClearIfStopped()
 
 void AudioStream::ForceClear()
 {
+	ReleasePending();
 	if (!alIsSource(Source)) return;
 
 	alSourceStop(Source);
@@ -130,6 +133,14 @@ void AudioStream::ForceClear()
 	ClearIfStopped();
 }
 
+void AudioStream::ReleasePending()
+{
+	if (pending) {
+		pending->loader->Release(pending);
+		pending = NULL;
+	}
+}
+
 OpenALAudioDriver::OpenALAudioDriver(void)
 {
 	alutContext = NULL;
@@ -138,6 +149,9 @@ OpenALAudioDriver::OpenALAudioDriver(void)
 	MusicSource = 0;
 	memset(MusicBuffer, 0, MUSICBUFFERS*sizeof(ALuint));
 	musicMutex = SDL_CreateMutex();
+	loader = NULL;
+	cachedBytes = 0;
+	cacheHits = cacheMisses = cacheEvictions = 0;
 	ambim = NULL;
 }
 
@@ -177,6 +191,7 @@ bool OpenALAudioDriver::Init(void)
 	stayAlive = true;
 	musicThread = SDL_CreateThread( MusicManager, this );
 
+	loader = new SoundLoader;
 	ambim = new AmbientMgrAL;
 	speech.free = true;
 	speech.ambient = false;
@@ -217,6 +232,12 @@ OpenALAudioDriver::~OpenALAudioDriver(void)
 		streams[i].ForceClear();
 	}
 	speech.ForceClear();
+	std::list<SoundRequest*>::iterator it;
+	for (it = preloads.begin(); it != preloads.end(); ++it) {
+		loader->Release(*it);
+	}
+	preloads.clear();
+	delete loader;
 	ResetMusics();
 	clearBufferCache(true);
 
@@ -246,28 +267,19 @@ ALuint OpenALAudioDriver::loadSound(const char *ResRef, unsigned int &time_lengt
 {
 	ALuint Buffer = 0;
 
-	CacheEntry *e;
-	void* p;
-
 	if (!ResRef[0]) {
 		return 0;
 	}
-	if(buffercache.Lookup(ResRef, p))
-	{
-		e = (CacheEntry*) p;
+	CacheEntry *e = LookupBuffer(ResRef);
+	CountLookup(e != NULL);
+	if (e) {
 		time_length = e->Length;
 		return e->Buffer;
 	}
 
 	//no cache entry...
-	alGenBuffers(1, &Buffer);
-	if (checkALError("Unable to create sound buffer", "ERROR")) {
-		return 0;
-	}
-
 	ResourceHolder<SoundMgr> acm(ResRef);
 	if (!acm) {
-		alDeleteBuffers( 1, &Buffer );
 		return 0;
 	}
 	int cnt = acm->get_length();
@@ -280,9 +292,60 @@ ALuint OpenALAudioDriver::loadSound(const char *ResRef, unsigned int &time_lengt
 	int cnt1 = acm->read_samples( memory, cnt ) * 2;
 	//Sound Length in milliseconds
 	time_length = ((cnt / riff_chans) * 1000) / samplerate;
-	//it is always reading the stuff into 16 bits
-	alBufferData( Buffer, GetFormatEnum( riff_chans, 16 ), memory, cnt1, samplerate );
+	Buffer = CreateBuffer(ResRef, memory, cnt1, riff_chans, samplerate, time_length);
 	free(memory);
+	return Buffer;
+}
+
+//returns the cached sound and marks it as recently used
+CacheEntry* OpenALAudioDriver::LookupBuffer(const char* ResRef)
+{
+	void* p;
+	if (!buffercache.Lookup(ResRef, p)) {
+		return NULL;
+	}
+	buffercache.Touch(ResRef);
+	return (CacheEntry*) p;
+}
+
+void OpenALAudioDriver::CountLookup(bool hit)
+{
+	if (hit) {
+		cacheHits++;
+		Profiler::Count(PROFILE_SOUND_HITS);
+	} else {
+		cacheMisses++;
+		Profiler::Count(PROFILE_SOUND_MISSES);
+	}
+}
+
+//the buffers of the playing (or looping) sounds are pinned in the cache
+bool OpenALAudioDriver::IsBufferPlaying(ALuint Buffer)
+{
+	if (!speech.free && speech.Buffer == Buffer) {
+		return true;
+	}
+	for (int i = 0; i < num_streams; i++) {
+		if (!streams[i].free && streams[i].Buffer == Buffer) {
+			return true;
+		}
+	}
+	return false;
+}
+
+//uploads the decoded sound and adds it to the cache
+ALuint OpenALAudioDriver::CreateBuffer(const char* ResRef, short* memory, int size,
+	int channels, int samplerate, unsigned int time_length)
+{
+	ALuint Buffer = 0;
+
+	alGenBuffers(1, &Buffer);
+	if (checkALError("Unable to create sound buffer", "ERROR")) {
+		return 0;
+	}
+
+	//it is always reading the stuff into 16 bits
+	alBufferData( Buffer, GetFormatEnum( channels, 16 ), memory, size, samplerate );
 
 	if (checkALError("Unable to fill buffer", "ERROR")) {
 		alDeleteBuffers( 1, &Buffer );
@@ -290,39 +353,55 @@ ALuint OpenALAudioDriver::loadSound(const char *ResRef, unsigned int &time_lengt
 		return 0;
 	}
 
-	e = new CacheEntry;
+	//make room first, so the new sound isn't evicted right away
+	while (cachedBytes + size > BUFFER_CACHE_BYTES && evictBuffer()) ;
+
+	CacheEntry *e = new CacheEntry;
 	e->Buffer = Buffer;
-	e->Length = ((cnt / riff_chans) * 1000) / samplerate;
+	e->Length = time_length;
+	e->Size = size;
 
 	buffercache.SetAt(ResRef, (void*)e);
+	cachedBytes += size;
 	//print("LoadSound: added %s to cache: %d. Cache size now %d\n", ResRef, e->Buffer, buffercache.GetCount());
-
-	if (buffercache.GetCount() > BUFFER_CACHE_SIZE) {
-		evictBuffer();
-	}
 	return Buffer;
 }
 
 Holder<SoundHandle> OpenALAudioDriver::Play(const char* ResRef, int XPos, int YPos, unsigned int flags, unsigned int *length)
 {
-	ALuint Buffer;
+	ALuint Buffer = 0;
 	unsigned int time_length;
+	SoundRequest *req = NULL;
 
 	if(ResRef == NULL) {
 		if((flags & GEM_SND_SPEECH) && alIsSource(speech.Source)) {
 			//So we want him to be quiet...
+			speech.ReleasePending();
 			alSourceStop( speech.Source );
 			checkALError("Unable to stop speech", "WARNING");
 			speech.ClearProcessedBuffers();
 		}
 		return Holder<SoundHandle>();
 	}
-
-	Buffer = loadSound( ResRef, time_length );
-	if (Buffer == 0) {
+	if (!ResRef[0]) {
 		return Holder<SoundHandle>();
 	}
 
+	CacheEntry *e = LookupBuffer(ResRef);
+	CountLookup(e != NULL);
+	if (e) {
+		Buffer = e->Buffer;
+		time_length = e->Length;
+	} else {
+		//it is decoded in the background and starts once it is ready,
+		//long sounds are streamed instead of being cached
+		req = loader->Load(ResRef, !(flags & GEM_SND_LOOPING));
+		if (!req) {
+			return Holder<SoundHandle>();
+		}
+		time_length = req->length;
+	}
+
 	if (length) {
 		*length = time_length;
 	}
@@ -336,18 +415,23 @@ Holder<SoundHandle> OpenALAudioDriver::Play(const char* ResRef, int XPos, int YP
 	};
 
 	ieDword volume = 100;
+	AudioStream *stream = NULL;
 
 	if (flags & GEM_SND_SPEECH) {
 		//speech has a single channel, if a new speech started
 		//we stop the previous one
+		speech.ReleasePending();
 		if(!speech.free && alIsSource(speech.Source)) {
 			alSourceStop( speech.Source );
 			checkALError("Unable to stop speech", "WARNING");
 			speech.ClearProcessedBuffers();
 		}
+		//the previous speech could have been streamed
+		speech.delete_buffers = false;
 		if(!alIsSource(speech.Source)) {
 			alGenSources( 1, &speech.Source );
 			if (checkALError("Error creating source for speech", "ERROR")) {
+				if (req) loader->Release(req);
 				return Holder<SoundHandle>();
 			}
 		}
@@ -364,65 +448,196 @@ Holder<SoundHandle> OpenALAudioDriver::Play(const char* ResRef, int XPos, int YP
 		alSourcef( speech.Source, AL_GAIN, 0.01f * volume );
 		alSourcei( speech.Source, AL_SOURCE_RELATIVE, flags & GEM_SND_RELATIVE );
 		alSourcefv( speech.Source, AL_POSITION, SourcePos );
-		assert(!speech.delete_buffers);
+		//no buffer clears the queue of a pending sound
 		alSourcei( speech.Source, AL_BUFFER, Buffer );
 		checkALError("Unable to set speech parameters", "WARNING");
 		speech.Buffer = Buffer;
-		alSourcePlay( speech.Source );
-		if (checkALError("Unable to play speech", "ERROR")) {
+		stream = &speech;
+	} else {
+		int i;
+		for (i = 0; i < num_streams; i++) {
+			streams[i].ClearIfStopped();
+			if (streams[i].free) {
+				break;
+			}
+		}
+
+		if (i == num_streams) {
+			// Failed to assign new sound.
+			// The buffercache will handle deleting Buffer.
+			if (req) loader->Release(req);
+			return Holder<SoundHandle>();
+		}
+		stream = streams + i;
+
+		// not speech
+		alGenSources( 1, &Source );
+		if (checkALError("Unable to create source", "ERROR")) {
+			if (req) loader->Release(req);
 			return Holder<SoundHandle>();
 		}
-		speech.handle = new OpenALSoundHandle(&speech);
-		return speech.handle.get();
+
+		alSourcef( Source, AL_PITCH, 1.0f );
+		alSourcefv( Source, AL_VELOCITY, SourceVel );
+		alSourcei( Source, AL_LOOPING, (flags & GEM_SND_LOOPING ? 1 : 0) );
+		alSourcef( Source, AL_REFERENCE_DISTANCE, REFERENCE_DISTANCE );
+		core->GetDictionary()->Lookup( "Volume SFX", volume );
+		alSourcef( Source, AL_GAIN, 0.01f * volume );
+		alSourcei( Source, AL_SOURCE_RELATIVE, flags & GEM_SND_RELATIVE );
+		alSourcefv( Source, AL_POSITION, SourcePos );
+		assert(!stream->delete_buffers);
+		if (Buffer) {
+			alSourcei( Source, AL_BUFFER, Buffer );
+		}
+
+		if (checkALError("Unable to set sound parameters", "ERROR")) {
+			alDeleteSources( 1, &Source );
+			if (req) loader->Release(req);
+			return Holder<SoundHandle>();
+		}
+
+		stream->Buffer = Buffer;
+		stream->Source = Source;
+		stream->free = false;
 	}
 
-	int stream = -1;
-	for (int i = 0; i < num_streams; i++) {
-		streams[i].ClearIfStopped();
-		if (streams[i].free) {
-			stream = i;
-			break;
+	stream->handle = new OpenALSoundHandle(stream);
+	if (req) {
+		stream->pending = req;
+		//it may be decoded already
+		ServicePending(*stream);
+	} else {
+		alSourcePlay( stream->Source );
+		if (checkALError("Unable to play sound", "ERROR")) {
+			stream->ForceClear();
+			return Holder<SoundHandle>();
 		}
 	}
+	return stream->handle.get();
+}
 
-	if (stream == -1) {
-		// Failed to assign new sound.
-		// The buffercache will handle deleting Buffer.
-		return Holder<SoundHandle>();
+//starts the pending sound once it is decoded, or keeps feeding a streamed
+//one with the decoded chunks
+void OpenALAudioDriver::ServicePending(AudioStream &stream)
+{
+	SoundRequest *req = stream.pending;
+	if (!req) {
+		return;
 	}
 
-	// not speech
-	alGenSources( 1, &Source );
-	if (checkALError("Unable to create source", "ERROR")) {
-		return Holder<SoundHandle>();
+	if (!req->streamed) {
+		if (!loader->IsDone(req)) {
+			return;
+		}
+		ALuint Buffer = 0;
+		//an earlier user of the same request could have uploaded it
+		CacheEntry *e = LookupBuffer(req->ResRef);
+		if (e) {
+			Buffer = e->Buffer;
+		} else if (req->sound.memory) {
+			Buffer = CreateBuffer(req->ResRef, req->sound.memory, req->sound.size,
+				req->channels, req->samplerate, req->length);
+		}
+		if (!Buffer) {
+			stream.ForceClear();
+			return;
+		}
+		stream.ReleasePending();
+		stream.Buffer = Buffer;
+		alSourcei( stream.Source, AL_BUFFER, Buffer );
+		alSourcePlay( stream.Source );
+		if (checkALError("Unable to play sound", "ERROR")) {
+			stream.ForceClear();
+		}
+		return;
 	}
 
-	alSourcef( Source, AL_PITCH, 1.0f );
-	alSourcefv( Source, AL_VELOCITY, SourceVel );
-	alSourcei( Source, AL_LOOPING, (flags & GEM_SND_LOOPING ? 1 : 0) );
-	alSourcef( Source, AL_REFERENCE_DISTANCE, REFERENCE_DISTANCE );
-	core->GetDictionary()->Lookup( "Volume SFX", volume );
-	alSourcef( Source, AL_GAIN, 0.01f * volume );
-	alSourcei( Source, AL_SOURCE_RELATIVE, flags & GEM_SND_RELATIVE );
-	alSourcefv( Source, AL_POSITION, SourcePos );
-	assert(!streams[stream].delete_buffers);
-	alSourcei( Source, AL_BUFFER, Buffer );
+	//the buffers of a streamed sound are deleted once played,
+	//like the ones of QueueBuffer
+	stream.delete_buffers = true;
+	stream.ClearProcessedBuffers();
+	SoundChunk chunk;
+	while (loader->TakeChunk(req, chunk)) {
+		ALuint Buffer;
+		alGenBuffers(1, &Buffer);
+		if (checkALError("Unable to create sound buffer", "ERROR")) {
+			free(chunk.memory);
+			continue;
+		}
+		alBufferData( Buffer, GetFormatEnum( req->channels, 16 ), chunk.memory, chunk.size, req->samplerate );
+		free(chunk.memory);
+		alSourceQueueBuffers( stream.Source, 1, &Buffer );
+		if (checkALError("Unable to queue sound buffer", "ERROR")) {
+			alDeleteBuffers( 1, &Buffer );
+		}
+	}
 
-	if (checkALError("Unable to set sound parameters", "ERROR")) {
-		return Holder<SoundHandle>();
+	ALint state, queued;
+	alGetSourcei( stream.Source, AL_SOURCE_STATE, &state );
+	alGetSourcei( stream.Source, AL_BUFFERS_QUEUED, &queued );
+	if (checkALError("Unable to query sound source state", "ERROR")) {
+		stream.ForceClear();
+		return;
+	}
+	if (loader->IsDone(req)) {
+		stream.ReleasePending();
+		if (!queued) {
+			//nothing was decoded or it already played
+			stream.ForceClear();
+			return;
+		}
+	}
+	//also restarts it if the decoding couldn't keep up
+	if (queued && state != AL_PLAYING) {
+		alSourcePlay( stream.Source );
+		checkALError("Unable to play sound", "ERROR");
 	}
+}
 
-	streams[stream].Buffer = Buffer;
-	streams[stream].Source = Source;
-	streams[stream].free = false;
-	alSourcePlay( Source );
+void OpenALAudioDriver::Update()
+{
+	if (!loader) return;
 
-	if (checkALError("Unable to play sound", "ERROR")) {
-		return Holder<SoundHandle>();
+	for (int i = 0; i < num_streams; i++) {
+		ServicePending(streams[i]);
 	}
+	ServicePending(speech);
+
+	std::list<SoundRequest*>::iterator it = preloads.begin();
+	while (it != preloads.end()) {
+		SoundRequest *req = *it;
+		if (!loader->IsDone(req)) {
+			++it;
+			continue;
+		}
+		if (req->sound.memory && !LookupBuffer(req->ResRef)) {
+			CreateBuffer(req->ResRef, req->sound.memory, req->sound.size,
+				req->channels, req->samplerate, req->length);
+		}
+		loader->Release(req);
+		it = preloads.erase(it);
+	}
+	loader->Collect();
+}
+
+void OpenALAudioDriver::Preload(const char* ResRef)
+{
+	void* p;
+	if (!loader || !ResRef || !ResRef[0] || buffercache.Lookup(ResRef, p)) {
+		return;
+	}
+	SoundRequest *req = loader->Load(ResRef, false);
+	if (req) {
+		preloads.push_back(req);
+	}
+}
 
-	streams[stream].handle = new OpenALSoundHandle(&streams[stream]);
-	return streams[stream].handle.get();
+void OpenALAudioDriver::PrintStats()
+{
+	printMessage("OpenAL", "Sound cache: %d sounds, %lu of %lu KB\n", WHITE,
+		buffercache.GetCount(), cachedBytes/1024, (unsigned long) BUFFER_CACHE_BYTES/1024);
+	printMessage("OpenAL", "%lu hits, %lu misses, %lu evictions\n", WHITE,
+		cacheHits, cacheMisses, cacheEvictions);
 }
 
 bool OpenALAudioDriver::IsSpeaking()
@@ -718,11 +933,19 @@ bool OpenALAudioDriver::evictBuffer()
 
 	while ((res = buffercache.getLRU(n, k, p)) == true) {
 		CacheEntry* e = (CacheEntry*)p;
+		if (IsBufferPlaying(e->Buffer)) {
+			++n;
+			continue;
+		}
 		alDeleteBuffers(1, &e->Buffer);
 		if (alGetError() == AL_NO_ERROR) {
 			// Buffer was unused. An error would have indicated
-			// the buffer was still attached to a source.
+			// the buffer was still attached to a source
+			// (queued ambients aren't tracked by the streams).
 
+			cachedBytes -= e->Size;
+			cacheEvictions++;
+			Profiler::Count(PROFILE_SOUND_EVICTIONS);
 			delete e;
 			buffercache.Remove(k);
 
@@ -746,6 +969,7 @@ void OpenALAudioDriver::clearBufferCache(bool force)
 		CacheEntry* e = (CacheEntry*)p;
 		alDeleteBuffers(1, &e->Buffer);
 		if (force || alGetError() == AL_NO_ERROR) {
+			cachedBytes -= e->Size;
 			delete e;
 			buffercache.Remove(k);
 		} else
@@ -24,6 +24,7 @@
 #include "Audio.h"
 
 #include "AmbientMgrAL.h"
+#include "SoundLoader.h"
 #include "StackLock.h"
 
 #include "ie_types.h"
@@ -54,7 +55,8 @@
 #endif
 
 #define RETRY 5
-#define BUFFER_CACHE_SIZE 100
+//decoded samples kept in the sound cache
+#define BUFFER_CACHE_BYTES (32*1024*1024)
 #define MAX_STREAMS 30
 #define MUSICBUFFERS 10
 #define REFERENCE_DISTANCE 50
@@ -75,7 +77,7 @@ public:
 };
 
 struct AudioStream {
-	AudioStream() : Buffer(0), Source(0), Duration(0), free(true), ambient(false), locked(false), delete_buffers(false) { }
+	AudioStream() : Buffer(0), Source(0), Duration(0), free(true), ambient(false), locked(false), delete_buffers(false), pending(NULL) { }
 
 	ALuint Buffer;
 	ALuint Source;
@@ -84,10 +86,13 @@ struct AudioStream {
 	bool ambient;
 	bool locked;
 	bool delete_buffers;
+	//the sound being decoded for this stream, it plays once it is ready
+	SoundRequest *pending;
 
 	void ClearIfStopped();
 	void ClearProcessedBuffers();
 	void ForceClear();
+	void ReleasePending();
 
 	Holder<OpenALSoundHandle> handle;
 };
@@ -95,6 +100,7 @@ struct AudioStream {
 struct CacheEntry {
 	ALuint Buffer;
 	unsigned int Length;
+	unsigned int Size; //in bytes
 };
 
 class OpenALAudioDriver : public Audio {
@@ -123,6 +129,9 @@ public:
 	void QueueBuffer(int stream, unsigned short bits,
 				int channels, short* memory,
 				int size, int samplerate) ;
+	void Update();
+	void Preload(const char* ResRef);
+	void PrintStats();
 private:
 	ALCcontext *alutContext;
 	ALuint MusicSource;
@@ -131,9 +140,20 @@ private:
 	ALuint MusicBuffer[MUSICBUFFERS];
 	Holder<SoundMgr> MusicReader;
 	LRUCache buffercache;
+	unsigned long cachedBytes;
+	unsigned long cacheHits, cacheMisses, cacheEvictions;
+	//sounds decoded for the cache only
+	std::list<SoundRequest*> preloads;
 	AudioStream speech;
 	AudioStream streams[MAX_STREAMS];
+	SoundLoader *loader;
 	ALuint loadSound(const char* ResRef, unsigned int &time_length);
+	CacheEntry* LookupBuffer(const char* ResRef);
+	void CountLookup(bool hit);
+	bool IsBufferPlaying(ALuint Buffer);
+	ALuint CreateBuffer(const char* ResRef, short* memory, int size,
+				int channels, int samplerate, unsigned int time_length);
+	void ServicePending(AudioStream &stream);
 	int num_streams;
 	int CountAvailableSources(int limit);
 	bool evictBuffer();
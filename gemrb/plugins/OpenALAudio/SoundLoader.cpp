@@ -0,0 +1,244 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "SoundLoader.h"
+
+#include "win32def.h"
+
+#include "GameData.h"
+
+SoundLoader::SoundLoader()
+{
+	quit = false;
+	running = 0;
+	for (int i = 0; i < LOADER_THREADS; i++) {
+		workers[i].loader = this;
+		if (workers[i].thread.Start(Run, workers+i)) {
+			running++;
+		}
+	}
+	if (!running) {
+		printMessage("OpenAL", "Cannot start the sound loader threads, sounds are decoded when played\n", YELLOW);
+	}
+}
+
+SoundLoader::~SoundLoader()
+{
+	mutex.Lock();
+	quit = true;
+	WakeUp();
+	mutex.Unlock();
+	for (int i = 0; i < LOADER_THREADS; i++) {
+		workers[i].thread.Join();
+	}
+	std::list<SoundRequest*>::iterator it;
+	for (it = requests.begin(); it != requests.end(); ++it) {
+		Delete(*it);
+	}
+	requests.clear();
+}
+
+void SoundLoader::Run(void *worker)
+{
+	Worker *w = (Worker *) worker;
+	w->loader->Work(w);
+}
+
+void SoundLoader::Work(Worker *worker)
+{
+	MutexLock lock(mutex);
+	while (!quit) {
+		SoundRequest *req = NextRequest();
+		if (!req) {
+			worker->wakeup.Wait(mutex);
+			continue;
+		}
+
+		//while decoding, the reader is owned by this thread
+		req->busy = true;
+		mutex.Unlock();
+		Decode(req);
+		mutex.Lock();
+		req->busy = false;
+	}
+}
+
+//whole sounds first, they are waited for; then the streamed sound with
+//the fewest chunks ahead
+SoundRequest* SoundLoader::NextRequest()
+{
+	SoundRequest *next = NULL;
+	std::list<SoundRequest*>::iterator it;
+	for (it = requests.begin(); it != requests.end(); ++it) {
+		SoundRequest *req = *it;
+		if (req->busy || req->finished || req->cancelled) {
+			continue;
+		}
+		if (!req->streamed) {
+			return req;
+		}
+		if (req->chunks.size() >= STREAM_CHUNKS_AHEAD) {
+			continue;
+		}
+		if (!next || req->chunks.size() < next->chunks.size()) {
+			next = req;
+		}
+	}
+	return next;
+}
+
+//called without holding the mutex, the results are stored with it held
+void SoundLoader::Decode(SoundRequest *req)
+{
+	int samples = req->streamed ? STREAM_CHUNK_SAMPLES : req->samples;
+	//multiply always by 2 because it is in 16 bits
+	short *memory = (short *) malloc(samples * 2);
+	int cnt = memory ? req->reader->read_samples(memory, samples) : 0;
+
+	MutexLock lock(mutex);
+	if (cnt <= 0) {
+		free(memory);
+		req->finished = true;
+		return;
+	}
+	SoundChunk chunk = { memory, cnt * 2 };
+	if (req->streamed) {
+		req->chunks.push_back(chunk);
+		req->finished = cnt < samples;
+	} else {
+		req->sound = chunk;
+		req->finished = true;
+	}
+}
+
+void SoundLoader::WakeUp()
+{
+	for (int i = 0; i < LOADER_THREADS; i++) {
+		workers[i].wakeup.Signal();
+	}
+}
+
+void SoundLoader::Delete(SoundRequest *req)
+{
+	free(req->sound.memory);
+	std::list<SoundChunk>::iterator it;
+	for (it = req->chunks.begin(); it != req->chunks.end(); ++it) {
+		free(it->memory);
+	}
+	delete req;
+}
+
+SoundRequest* SoundLoader::Load(const char *ResRef, bool allowStream)
+{
+	{
+		MutexLock lock(mutex);
+		std::list<SoundRequest*>::iterator it;
+		for (it = requests.begin(); it != requests.end(); ++it) {
+			SoundRequest *req = *it;
+			if (!req->streamed && !req->cancelled && !strnicmp(req->ResRef, ResRef, 8)) {
+				req->users++;
+				return req;
+			}
+		}
+	}
+
+	//the headers are read here, so the length is known right away
+	ResourceHolder<SoundMgr> acm(ResRef);
+	if (!acm) {
+		return NULL;
+	}
+	int channels = acm->get_channels();
+	int samplerate = acm->get_samplerate();
+	int samples = acm->get_length();
+	if (channels <= 0 || samplerate <= 0 || samples <= 0) {
+		return NULL;
+	}
+
+	SoundRequest *req = new SoundRequest();
+	req->loader = this;
+	strnlwrcpy(req->ResRef, ResRef, 8);
+	req->reader = acm;
+	req->channels = channels;
+	req->samplerate = samplerate;
+	req->samples = samples;
+	//Sound Length in milliseconds
+	req->length = ((samples / channels) * 1000) / samplerate;
+	req->streamed = allowStream && running && req->length > STREAM_SOUND_LENGTH;
+	req->users = 1;
+	req->busy = false;
+	req->finished = false;
+	req->cancelled = false;
+	req->sound.memory = NULL;
+	req->sound.size = 0;
+
+	if (!running) {
+		Decode(req);
+	}
+	MutexLock lock(mutex);
+	requests.push_back(req);
+	WakeUp();
+	return req;
+}
+
+void SoundLoader::Release(SoundRequest *req)
+{
+	if (--req->users) {
+		return;
+	}
+	MutexLock lock(mutex);
+	req->cancelled = true;
+	if (!req->busy) {
+		requests.remove(req);
+		Delete(req);
+	}
+}
+
+bool SoundLoader::IsDone(SoundRequest *req)
+{
+	MutexLock lock(mutex);
+	return req->finished && req->chunks.empty();
+}
+
+bool SoundLoader::TakeChunk(SoundRequest *req, SoundChunk &chunk)
+{
+	MutexLock lock(mutex);
+	if (req->chunks.empty()) {
+		return false;
+	}
+	chunk = req->chunks.front();
+	req->chunks.pop_front();
+	//there is room for the next one
+	WakeUp();
+	return true;
+}
+
+void SoundLoader::Collect()
+{
+	MutexLock lock(mutex);
+	std::list<SoundRequest*>::iterator it = requests.begin();
+	while (it != requests.end()) {
+		if ((*it)->cancelled && !(*it)->busy) {
+			Delete(*it);
+			it = requests.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
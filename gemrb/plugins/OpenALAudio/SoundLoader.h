@@ -0,0 +1,116 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef SOUNDLOADER_H
+#define SOUNDLOADER_H
+
+#include "ie_types.h"
+
+#include "Holder.h"
+#include "SoundMgr.h"
+#include "System/Threads.h"
+
+#include <list>
+
+//number of decoding threads
+#define LOADER_THREADS 2
+//non looping sounds longer than this (in milliseconds) are streamed
+#define STREAM_SOUND_LENGTH 5000
+//16 bit samples (of all channels) in a chunk of a streamed sound
+#define STREAM_CHUNK_SAMPLES 32768
+//chunks decoded ahead of the playback of a streamed sound
+#define STREAM_CHUNKS_AHEAD 4
+
+class SoundLoader;
+
+struct SoundChunk {
+	short *memory;
+	int size; //in bytes
+};
+
+/**
+ * A sound decoded in the background. Whole sounds are decoded at once,
+ * streamed ones in chunks, a few ahead of the playback.
+ * The main thread creates and deletes them, the workers only decode.
+ */
+
+struct SoundRequest {
+	SoundLoader *loader;
+	ieResRef ResRef;
+	Holder<SoundMgr> reader;
+	int channels;
+	int samplerate;
+	int samples;
+	unsigned int length; //in milliseconds
+	bool streamed;
+	//the streams waiting for it (main thread only)
+	int users;
+
+	//the rest is guarded by the loader mutex
+	bool busy;      //a worker is decoding it
+	bool finished;  //nothing left to decode
+	bool cancelled; //no users left, delete it when it isn't busy
+	SoundChunk sound; //whole sounds
+	std::list<SoundChunk> chunks; //streamed sounds
+};
+
+/**
+ * @class SoundLoader
+ * Pool of worker threads decoding sounds, so the main thread only has to
+ * upload the samples. Without threads everything is decoded right away.
+ */
+
+class SoundLoader {
+private:
+	struct Worker {
+		SoundLoader *loader;
+		Thread thread;
+		WaitCondition wakeup;
+	};
+
+	Mutex mutex;
+	Worker workers[LOADER_THREADS];
+	int running;
+	bool quit;
+	std::list<SoundRequest*> requests;
+
+	static void Run(void *worker);
+	void Work(Worker *worker);
+	SoundRequest* NextRequest();
+	void Decode(SoundRequest *req);
+	void WakeUp();
+	void Delete(SoundRequest *req);
+public:
+	SoundLoader();
+	~SoundLoader();
+	/** opens the sound and queues it for decoding, whole sounds already
+	 * being decoded are shared. The reference has to be given back with
+	 * Release. Returns NULL if the sound can't be opened. */
+	SoundRequest* Load(const char *ResRef, bool allowStream);
+	void Release(SoundRequest *req);
+	/** a whole sound was decoded or a streamed one was taken completely */
+	bool IsDone(SoundRequest *req);
+	/** the next decoded chunk of a streamed sound, the caller frees it */
+	bool TakeChunk(SoundRequest *req, SoundChunk &chunk);
+	/** deletes the released requests the workers were still busy with */
+	void Collect();
+};
+
+#endif
@@ -21,6 +21,8 @@
 #include "SDLVideo.h"
 
 #include "TileRenderer.inl"
+#include "TileRendererSSE2.inl"
+#include "SpriteRendererSSE2.inl"
 
 #include "AnimationFactory.h"
 #include "Audio.h"
@@ -31,6 +33,7 @@
 #include "SpriteCover.h"
 #include "GUI/Console.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cassert>
 #include <cstdio>
@@ -50,6 +53,8 @@ SDLVideoDriver::SDLVideoDriver(void)
 	GetTime( lastMouseTime );
 	backBuf=NULL;
 	extra=NULL;
+	fullUpdate = true;
+	fadeShown = false;
 	subtitlestrref = 0;
 	subtitletext = NULL;
 	overlay = NULL;
@@ -59,6 +64,7 @@ SDLVideoDriver::~SDLVideoDriver(void)
 {
 	core->FreeString(subtitletext); //may be NULL
 
+	FreeTileCache();
 	if(backBuf) SDL_FreeSurface( backBuf );
 	if(extra) SDL_FreeSurface( extra );
 	if (overlay) SDL_FreeYUVOverlay(overlay);
@@ -149,6 +155,7 @@ bool SDLVideoDriver::ToggleFullscreenMode(int set_reset)
 	if (fullscreen != set_reset) {
 		fullscreen=set_reset;
 		SDL_WM_ToggleFullScreen( disp );
+		fullUpdate = true;
 		//readjust mouse to original position
 		MoveMouse(CursorPos.x, CursorPos.y);
 		//synchronise internal variable
@@ -170,13 +177,8 @@ inline int GetModState(int modstate)
 int SDLVideoDriver::SwapBuffers(void)
 {
 	int ret = GEM_OK;
-	unsigned long time;
-	GetTime( time );
-	if (( time - lastTime ) < 33) {
-		SDL_Delay( 33 - (time - lastTime) );
-		GetTime( time );
-	}
-	lastTime = time;
+	pacer.Wait();
+	GetTime( lastTime );
 
 	bool ConsolePopped = core->ConsolePopped;
 
@@ -186,7 +188,25 @@ int SDLVideoDriver::SwapBuffers(void)
 
 	ret = PollEvents();
 
-	SDL_BlitSurface( backBuf, NULL, disp, NULL );
+	//the fade covers the whole screen, also in the frame it disappears
+	if (fadeColor.a || fadeShown) {
+		fullUpdate = true;
+	}
+	fadeShown = fadeColor.a != 0;
+
+	if (fullUpdate) {
+		SDL_BlitSurface( backBuf, NULL, disp, NULL );
+	} else {
+		//restore what the cursor and the tooltip covered last time
+		upd.insert(upd.end(), overlayRects.begin(), overlayRects.end());
+		for (size_t i = 0; i < upd.size(); i++) {
+			SDL_Rect rect = { upd[i].x, upd[i].y, upd[i].w, upd[i].h };
+			SDL_Rect dst = rect;
+			SDL_BlitSurface( backBuf, &rect, disp, &dst );
+		}
+	}
+	overlayRects.clear();
+
 	if (fadeColor.a) {
 		SDL_SetAlpha( extra, SDL_SRCALPHA, fadeColor.a );
 		SDL_Rect src = {
@@ -228,11 +248,97 @@ int SDLVideoDriver::SwapBuffers(void)
 		backBuf = tmp;
 	}
 
-	SDL_Flip( disp );
+	if (fullUpdate) {
+		SDL_Flip( disp );
+	} else {
+		upd.insert(upd.end(), overlayRects.begin(), overlayRects.end());
+		std::vector<SDL_Rect> rects(upd.size());
+		for (size_t i = 0; i < upd.size(); i++) {
+			rects[i].x = upd[i].x;
+			rects[i].y = upd[i].y;
+			rects[i].w = upd[i].w;
+			rects[i].h = upd[i].h;
+		}
+		if (rects.size()) {
+			SDL_UpdateRects( disp, rects.size(), &rects[0] );
+		}
+	}
+	upd.clear();
+	fullUpdate = false;
 
 	return ret;
 }
 
+//records a changed area of the back buffer (or of the display, while
+//the cursor and the tooltip are drawn), so SwapBuffers can copy and
+//update only what changed
+void SDLVideoDriver::MarkDirty(int x, int y, int w, int h)
+{
+	std::vector<Region>& rects = backBuf == disp ? overlayRects : upd;
+	if (fullUpdate && &rects == &upd) {
+		return;
+	}
+
+	//the current clip rectangle limits every drawing
+	const SDL_Rect& clip = backBuf->clip_rect;
+	if (x < clip.x) {
+		w -= clip.x - x;
+		x = clip.x;
+	}
+	if (y < clip.y) {
+		h -= clip.y - y;
+		y = clip.y;
+	}
+	if (x + w > clip.x + clip.w)
+		w = clip.x + clip.w - x;
+	if (y + h > clip.y + clip.h)
+		h = clip.y + clip.h - y;
+	if (w <= 0 || h <= 0) {
+		return;
+	}
+	if (&rects == &upd && w == disp->w && h == disp->h) {
+		fullUpdate = true;
+		upd.clear();
+		return;
+	}
+
+	Region r(x, y, w, h);
+	for (size_t i = 0; i < rects.size(); i++) {
+		Region& old = rects[i];
+		if (x >= old.x && y >= old.y && x + w <= old.x + old.w && y + h <= old.y + old.h) {
+			return;
+		}
+	}
+	//extend the last one for consecutive pixels (lines)
+	if (rects.size()) {
+		Region& last = rects.back();
+		if (x >= last.x - 1 && y >= last.y - 1 && x + w <= last.x + last.w + 1 && y + h <= last.y + last.h + 1) {
+			int x2 = std::max(last.x + last.w, x + w);
+			int y2 = std::max(last.y + last.h, y + h);
+			last.x = std::min(last.x, x);
+			last.y = std::min(last.y, y);
+			last.w = x2 - last.x;
+			last.h = y2 - last.y;
+			return;
+		}
+	}
+	rects.push_back(r);
+
+	//too many, merge them into their bounding box
+	if (rects.size() > 16) {
+		int x1 = rects[0].x, y1 = rects[0].y;
+		int x2 = x1 + rects[0].w, y2 = y1 + rects[0].h;
+		for (size_t i = 1; i < rects.size(); i++) {
+			x1 = std::min(x1, (int) rects[i].x);
+			y1 = std::min(y1, (int) rects[i].y);
+			x2 = std::max(x2, rects[i].x + rects[i].w);
+			y2 = std::max(y2, rects[i].y + rects[i].h);
+		}
+		rects.clear();
+		rects.push_back(Region(x1, y1, x2 - x1, y2 - y1));
+	}
+}
+
 int SDLVideoDriver::PollEvents() {
 	static bool lastevent = false; /* last event was a mousedown */
 	static unsigned long lastmousetime = 0;
@@ -380,8 +486,12 @@ int SDLVideoDriver::PollEvents() {
 			if (!ConsolePopped)
 				Evnt->MouseUp( event.button.x, event.button.y, 1 << ( event.button.button - 1 ), GetModState(SDL_GetModState()) );
 
+			break;
+		 case SDL_VIDEOEXPOSE:
+			fullUpdate = true;
 			break;
 		 case SDL_ACTIVEEVENT:
+			fullUpdate = true;
 			if (ConsolePopped) {
 				break;
 			}
@@ -434,6 +544,52 @@ void SDLVideoDriver::DestroySpriteCover(SpriteCover* sc)
 }
 
 
+// Walks the x of a polygon edge, (b.x*(py-a.y) + a.x*(b.y-py))/(b.y-a.y),
+// from scanline to scanline. While the dividend stays positive the
+// quotient and remainder are just stepped, giving the same values as
+// the division.
+class EdgeStepper {
+private:
+	int num, dnum, den;
+	int q, r, dq, dr;
+	bool divide;
+public:
+	EdgeStepper(const Point& a, const Point& b, int py, int rows)
+	{
+		den = b.y - a.y;
+		num = b.x * (py - a.y) + a.x * (b.y - py);
+		dnum = b.x - a.x;
+		if (den < 0) {
+			den = -den;
+			num = -num;
+			dnum = -dnum;
+		}
+		divide = num < 0 || num + dnum * (rows - 1) < 0;
+		q = num / den;
+		r = num % den;
+		dq = dnum / den;
+		dr = dnum % den;
+	}
+	int X() const { return q; }
+	void Step()
+	{
+		if (divide) {
+			num += dnum;
+			q = num / den;
+			return;
+		}
+		q += dq;
+		r += dr;
+		if (r >= den) {
+			r -= den;
+			q++;
+		} else if (r < 0) {
+			r += den;
+			q--;
+		}
+	}
+};
+
 // flags: 0 - never dither (full cover)
 //	1 - dither if polygon wants it
 //	2 - always dither
@@ -467,14 +623,11 @@ void SDLVideoDriver::AddPolygonToSpriteCover(SpriteCover* sc,
 		Point& d = poly->points[(redge+1)%(poly->count)];
 
 		unsigned char* line = sc->pixels + (y_top)*sc->Width;
-		for (int sy = y_top; sy < y_bot; ++sy) {
-			int py = sy + yoff;
-
-			// TODO: maybe use a 'real' line drawing algorithm to
-			// compute these values faster.
-
-			int lt = (b.x * (py - a.y) + a.x * (b.y - py))/(b.y - a.y);
-			int rt = (d.x * (py - c.y) + c.x * (d.y - py))/(d.y - c.y) + 1;
+		EdgeStepper left(a, b, y_top + yoff, y_bot - y_top);
+		EdgeStepper right(c, d, y_top + yoff, y_bot - y_top);
+		for (int sy = y_top; sy < y_bot; ++sy, left.Step(), right.Step()) {
+			int lt = left.X();
+			int rt = right.X() + 1;
 
 			lt -= xoff;
 			rt -= xoff;
@@ -593,6 +746,11 @@ void SDLVideoDriver::FreeSprite(Sprite2D*& spr)
 			// this delete also calls Release() on the used palette
 		}
 	} else {
+		std::map<const Sprite2D*, CachedTile>::iterator tile = tileCache.find(spr);
+		if (tile != tileCache.end()) {
+			SDL_FreeSurface( tile->second.surf );
+			tileCache.erase(tile);
+		}
 		if (spr->vptr) {
 			SDL_FreeSurface( ( SDL_Surface * ) spr->vptr );
 		}
@@ -639,6 +797,12 @@ void SDLVideoDriver::BlitSpriteRegion(const Sprite2D* spr, const Region& size, i
 {
 	if (!spr->vptr) return;
 
+	if (anchor) {
+		MarkDirty(x, y, size.w, size.h);
+	} else {
+		MarkDirty(x - Viewport.x, y - Viewport.y, size.w, size.h);
+	}
+
 	if (!spr->BAM) {
 		//TODO: Add the destination surface and rect to the Blit Pipeline
 		SDL_Rect drect;
@@ -855,8 +1019,9 @@ void SDLVideoDriver::BlitTile(const Sprite2D* spr, const Sprite2D* mask, int x,
 	if (y + h > clipy + cliph)
 		h -= (y + h - clipy - cliph);
 
-	const Uint8* data = (Uint8*) (( SDL_Surface * ) spr->vptr)->pixels;
-	const SDL_Color* pal = (( SDL_Surface * ) spr->vptr)->format->palette->colors;
+	if (w <= 0 || h <= 0)
+		return;
+	MarkDirty(x + rx, y + ry, w, h);
 
 	const Uint8* mask_data = 0;
 	Uint8 ck = 0;
@@ -865,48 +1030,113 @@ void SDLVideoDriver::BlitTile(const Sprite2D* spr, const Sprite2D* mask, int x,
 		ck = (( SDL_Surface * ) mask->vptr)->format->colorkey;
 	}
 
-	bool tint = false;
-	Color tintcol = {0,0,0,0};
-
+	const Color* tint = NULL;
 	if (core->GetGame()) {
-		const Color* totint = core->GetGame()->GetGlobalTint();
-		if (totint) {
-			tintcol = *totint;
-			tint = true;
-		}
+		tint = core->GetGame()->GetGlobalTint();
+	}
+
+	const SDL_Surface* tile = GetCachedTile(spr, tint);
+
+	if (!trans && !mask) {
+		BlitTile_copy(backBuf, x, y, rx, ry, w, h, tile);
+		return;
 	}
 
+#ifdef TILE_SSE2
+	if (TileSSE2) {
+		Uint32 halfmask = trans ? TRBlender_HalfTrans(backBuf->format).mask : 0;
+		if (backBuf->format->BytesPerPixel == 4)
+			BlitTile_sse2<Uint32>(backBuf, x, y, rx, ry, w, h, tile, mask_data, ck, halfmask);
+		else
+			BlitTile_sse2<Uint16>(backBuf, x, y, rx, ry, w, h, tile, mask_data, ck, halfmask);
+		return;
+	}
+#endif
+
 #define DO_BLIT \
 		if (backBuf->format->BytesPerPixel == 4) \
-			BlitTile_internal<Uint32>(backBuf, x, y, rx, ry, w, h, data, pal, mask_data, ck, T, B); \
+			BlitTile_cached<Uint32>(backBuf, x, y, rx, ry, w, h, tile, mask_data, ck, B); \
 		else \
-			BlitTile_internal<Uint16>(backBuf, x, y, rx, ry, w, h, data, pal, mask_data, ck, T, B); \
+			BlitTile_cached<Uint16>(backBuf, x, y, rx, ry, w, h, tile, mask_data, ck, B); \
 
 
 	if (trans) {
 		TRBlender_HalfTrans B(backBuf->format);
-
-		if (tint) {
-			TRTinter_Tint T(tintcol);
-			DO_BLIT
-		} else {
-			TRTinter_NoTint T;
-			DO_BLIT
-		}
+		DO_BLIT
 	} else {
 		TRBlender_Opaque B(backBuf->format);
+		DO_BLIT
+	}
 
-		if (tint) {
-			TRTinter_Tint T(tintcol);
-			DO_BLIT
-		} else {
-			TRTinter_NoTint T;
-			DO_BLIT
+#undef DO_BLIT
+
+}
+
+//returns the tile converted to the format of the back buffer, the
+//conversion is redone only if the global tint (or the format) changed
+SDL_Surface* SDLVideoDriver::GetCachedTile(const Sprite2D* spr, const Color* tint)
+{
+	SDL_PixelFormat* fmt = backBuf->format;
+	std::map<const Sprite2D*, CachedTile>::iterator it = tileCache.find(spr);
+	if (it != tileCache.end()) {
+		CachedTile& cached = it->second;
+		SDL_PixelFormat* cfmt = cached.surf->format;
+		if (cfmt->BytesPerPixel == fmt->BytesPerPixel && cfmt->Rmask == fmt->Rmask &&
+			cfmt->Gmask == fmt->Gmask && cfmt->Bmask == fmt->Bmask) {
+			if (!tint && !cached.tinted) {
+				return cached.surf;
+			}
+			if (tint && cached.tinted && cached.tint.r == tint->r &&
+				cached.tint.g == tint->g && cached.tint.b == tint->b) {
+				return cached.surf;
+			}
 		}
+		SDL_FreeSurface( cached.surf );
+		tileCache.erase(it);
+	}
+
+	//the tiles of a whole area can be a lot, start over if there are too many
+	if (tileCache.size() >= TILE_CACHE_SIZE) {
+		FreeTileCache();
+	}
+
+	SDL_Surface* surf = SDL_CreateRGBSurface( SDL_SWSURFACE, 64, 64, fmt->BitsPerPixel,
+		fmt->Rmask, fmt->Gmask, fmt->Bmask, 0 );
+	const Uint8* data = (Uint8*) (( SDL_Surface * ) spr->vptr)->pixels;
+	const SDL_Color* pal = (( SDL_Surface * ) spr->vptr)->format->palette->colors;
+	TRBlender_Opaque B(surf->format);
+
+#define DO_BLIT \
+		if (surf->format->BytesPerPixel == 4) \
+			BlitTile_internal<Uint32>(surf, 0, 0, 0, 0, 64, 64, data, pal, 0, 0, T, B); \
+		else \
+			BlitTile_internal<Uint16>(surf, 0, 0, 0, 0, 64, 64, data, pal, 0, 0, T, B); \
+
+	CachedTile cached;
+	cached.surf = surf;
+	cached.tinted = tint != NULL;
+	if (tint) {
+		cached.tint = *tint;
+		TRTinter_Tint T(*tint);
+		DO_BLIT
+	} else {
+		TRTinter_NoTint T;
+		DO_BLIT
 	}
 
 #undef DO_BLIT
 
+	tileCache[spr] = cached;
+	return surf;
+}
+
+void SDLVideoDriver::FreeTileCache()
+{
+	std::map<const Sprite2D*, CachedTile>::iterator it;
+	for (it = tileCache.begin(); it != tileCache.end(); ++it) {
+		SDL_FreeSurface( it->second.surf );
+	}
+	tileCache.clear();
 }
 
 
@@ -915,6 +1145,12 @@ void SDLVideoDriver::BlitSprite(const Sprite2D* spr, int x, int y, bool anchor,
 {
 	if (!spr->vptr) return;
 
+	if (anchor) {
+		MarkDirty(x - spr->XPos, y - spr->YPos, spr->Width, spr->Height);
+	} else {
+		MarkDirty(x - spr->XPos - Viewport.x, y - spr->YPos - Viewport.y, spr->Width, spr->Height);
+	}
+
 	if (!spr->BAM) {
 		//TODO: Add the destination surface and rect to the Blit Pipeline
 		SDL_Rect drect;
@@ -1048,6 +1284,12 @@ void SDLVideoDriver::BlitGameSprite(const Sprite2D* spr, int x, int y,
 {
 	if (!spr->vptr) return;
 
+	if (anchor) {
+		MarkDirty(x - spr->XPos, y - spr->YPos, spr->Width, spr->Height);
+	} else {
+		MarkDirty(x - spr->XPos - Viewport.x, y - spr->YPos - Viewport.y, spr->Width, spr->Height);
+	}
+
 	// WARNING: this pointer is only valid with BAM sprites
 	Sprite2D_BAM_Internal* data = 0;
 
@@ -1159,6 +1401,46 @@ void SDLVideoDriver::BlitGameSprite(const Sprite2D* spr, int x, int y,
 #undef TINT_ALPHA
 #undef PALETTE_ALPHA
 
+#ifdef TILE_SSE2
+	unsigned int ssemode = 0;
+	if (TileSSE2 && spr->BAM && RLE) {
+		if (remflags == (blit_COVERED | BLIT_TINTED)) {
+			ssemode = SPRITE_SSE2_TINT;
+		} else if (remflags == (blit_COVERED | BLIT_TINTED | BLIT_TRANSSHADOW)) {
+			ssemode = SPRITE_SSE2_TINT | SPRITE_SSE2_SHADOW;
+		} else if ((remflags & ~blit_COVERED) == BLIT_HALFTRANS) {
+			ssemode = SPRITE_SSE2_HALFTRANS;
+		}
+	}
+	if (ssemode) {
+		SpriteBlit s;
+		s.rle = rle;
+		s.width = spr->Width;
+		s.height = spr->Height;
+		s.transindex = data->transindex;
+		s.col = palette->col;
+		s.tx = tx;
+		s.ty = ty;
+		s.hflip = hflip;
+		s.vflip = vflip;
+		SpriteClip(backBuf, clip, s);
+		s.cover = cover ? cover->pixels : NULL;
+		s.coverw = cover ? cover->Width : 0;
+		s.coverx = cover ? COVERX : 0;
+		s.covery = cover ? COVERY : 0;
+		s.tint = tint;
+		s.mode = ssemode;
+		if (backBuf->format->BytesPerPixel == 4) {
+			s.shadowcol = shadowcol32;
+			s.halfmask = mask32;
+			BlitSpriteRLE_sse2<Uint32>(backBuf, s);
+		} else {
+			s.shadowcol = shadowcol16;
+			s.halfmask = mask16;
+			BlitSpriteRLE_sse2<Uint16>(backBuf, s);
+		}
+	} else
+#endif
 	if (spr->BAM && remflags == (blit_COVERED | BLIT_TINTED)) {
 
 #define COVER
@@ -1607,7 +1889,9 @@ void SDLVideoDriver::DrawRect(const Region& rgn, const Color& color, bool fill,
 	if (fill) {
 		if ( SDL_ALPHA_TRANSPARENT == color.a ) {
 			return;
-		} else if ( SDL_ALPHA_OPAQUE == color.a ) {
+		}
+		MarkDirty(rgn.x, rgn.y, rgn.w, rgn.h);
+		if ( SDL_ALPHA_OPAQUE == color.a ) {
 			long val = SDL_MapRGBA( backBuf->format, color.r, color.g, color.b, color.a );
 			SDL_FillRect( backBuf, &drect, val );
 		} else {
@@ -1716,6 +2000,7 @@ void SDLVideoDriver::SetPixel(short x, short y, const Color& color, bool clipped
 		}
 	}
 
+	MarkDirty(x, y, 1, 1);
 	unsigned char * pixels = ( ( unsigned char * ) backBuf->pixels ) +
 		( ( y * disp->w + x) * disp->format->BytesPerPixel );
 
@@ -2105,6 +2390,8 @@ void SDLVideoDriver::DrawPolyline(Gem_Polygon* poly, const Color& color, bool fi
 
 		Uint16 mask16 = (Uint16)mask32;
 
+		MarkDirty(poly->BBox.x - Viewport.x + xCorr, poly->BBox.y - Viewport.y + yCorr,
+			poly->BBox.w + 1, poly->BBox.h + 1);
 		SDL_LockSurface(backBuf);
 		std::list<Trapezoid>::iterator iter;
 		for (iter = poly->trapezoids.begin(); iter != poly->trapezoids.end();
@@ -2380,6 +2667,7 @@ void SDLVideoDriver::InitMovieScreen(int &w, int &h, bool yuv)
 		// BIKPlayer outputs PIX_FMT_YUV420P which is YV12
 		overlay = SDL_CreateYUVOverlay(w, h, SDL_YV12_OVERLAY, disp);
 	}
+	fullUpdate = true;
 	SDL_LockSurface( disp );
 	memset( disp->pixels, 0,
 		disp->w * disp->h * disp->format->BytesPerPixel );
@@ -2407,6 +2695,9 @@ void SDLVideoDriver::showFrame(unsigned char* buf, unsigned int bufw,
 {
 	int i;
 	SDL_Surface* sprite;
+
+	//the movie is drawn on the display, the back buffer has to replace it later
+	fullUpdate = true;
 	SDL_Rect srcRect, destRect;
 
 	assert( bufw == w && bufh == h );
@@ -2450,6 +2741,8 @@ void SDLVideoDriver::showYUVFrame(unsigned char** buf, unsigned int *strides,
 	ieDword titleref) {
 	SDL_Rect destRect;
 
+	fullUpdate = true;
+
 	assert( /* bufw == w && */ bufh == h );
 
 	SDL_LockYUVOverlay(overlay);
@@ -27,12 +27,20 @@
 
 #include <SDL.h>
 
+#include <map>
+
+//upper limit of tiles converted to the display format (64x64 each)
+#define TILE_CACHE_SIZE 4096
+
 class SDLVideoDriver : public Video {
 private:
 	SDL_Surface* disp;
 	SDL_Surface* backBuf;
 	SDL_Surface* extra;
 	std::vector< Region> upd;//Regions of the Screen to Update in the next SwapBuffer operation.
+	bool fullUpdate; //everything changed, upd is not used
+	std::vector< Region> overlayRects; //drawn straight on disp (cursor, tooltip)
+	bool fadeShown;
 	Sprite2D* Cursor[3];
 	SDL_Rect CursorPos;
 	unsigned short CursorIndex;
@@ -49,6 +57,13 @@ private:
 	ieDword subtitlestrref;
 	/* yuv overlay for bink movie */
 	SDL_Overlay *overlay;
+	/* area tiles already converted to the display format */
+	struct CachedTile {
+		SDL_Surface* surf;
+		bool tinted;
+		Color tint;
+	};
+	std::map<const Sprite2D*, CachedTile> tileCache;
 public:
 	SDLVideoDriver(void);
 	~SDLVideoDriver(void);
@@ -163,6 +178,9 @@ public:
 
 private:
 	void DrawMovieSubtitle(ieDword strRef);
+	SDL_Surface* GetCachedTile(const Sprite2D* spr, const Color* tint);
+	void MarkDirty(int x, int y, int w, int h);
+	void FreeTileCache();
 
 public:
 	long GetPixel(void *data, unsigned short x, unsigned short y);
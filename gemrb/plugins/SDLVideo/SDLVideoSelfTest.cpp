@@ -0,0 +1,492 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2010 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+// Compares the SSE2 tile and sprite blitters with the scalar ones they
+// replace, on random data at 16 and 32bpp. Only built with
+// -DSDLVIDEO_SELFTEST=1; run it as "SDLVideoSelfTest [iterations [seed]]".
+// It returns 0 if every blit gave the same pixels.
+
+#include <SDL.h>
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "RGBAColor.h"
+
+//just the fields the blitters use
+struct Region {
+	int x, y, w, h;
+};
+
+#include "TileRenderer.inl"
+#include "TileRendererSSE2.inl"
+#include "SpriteRendererSSE2.inl"
+
+#ifdef TILE_SSE2
+
+struct TestSprite {
+	int Width, Height;
+	int XPos, YPos;
+};
+
+struct TestBAM {
+	bool RLE;
+	int transindex;
+};
+
+struct TestPalette {
+	Color col[256];
+};
+
+struct TestCover {
+	Uint8* pixels;
+	int XPos, YPos;
+	int Width, Height;
+};
+
+//the same combinations as SDLVideoDriver::BlitGameSprite
+enum TestMode {
+	TEST_TINTED,
+	TEST_TRANSSHADOW,
+	TEST_HALFTRANS,
+	TEST_MODES
+};
+
+static const char* ModeNames[TEST_MODES] = {
+	"covered, tinted", "covered, tinted, transshadow", "halftrans"
+};
+
+static const unsigned int ModeFlags[TEST_MODES] = {
+	SPRITE_SSE2_TINT, SPRITE_SSE2_TINT | SPRITE_SSE2_SHADOW, SPRITE_SSE2_HALFTRANS
+};
+
+static unsigned int seed;
+
+static unsigned int Random(unsigned int n)
+{
+	seed = seed*1103515245 + 12345;
+	return ((seed >> 8) & 0xffffff) % n;
+}
+
+static int Random(int lo, int hi)
+{
+	return lo + (int) Random((unsigned int) (hi - lo + 1));
+}
+
+static void FillRandom(SDL_Surface* surf)
+{
+	Uint8* p = (Uint8*) surf->pixels;
+	for (int i = 0; i < surf->pitch*surf->h; i++) {
+		p[i] = (Uint8) Random(256);
+	}
+}
+
+static void RandomClipRect(SDL_Surface* surf)
+{
+	if (Random(2u)) {
+		SDL_SetClipRect(surf, NULL);
+		return;
+	}
+	SDL_Rect r;
+	r.x = (Sint16) Random(0, surf->w/2);
+	r.y = (Sint16) Random(0, surf->h/2);
+	r.w = (Uint16) Random(0, surf->w);
+	r.h = (Uint16) Random(0, surf->h);
+	SDL_SetClipRect(surf, &r);
+}
+
+//RLE encodes random pixels: the transparent runs may go on in the next row
+static Uint8* RandomSprite(const TestSprite& spr, int transindex)
+{
+	int size = spr.Width*spr.Height;
+	Uint8* rle = (Uint8*) malloc(2*size);
+	Uint8* out = rle;
+	int i = 0;
+	while (i < size) {
+		if (Random(3u) == 0) {
+			int run = Random(1, 300);
+			if (run > size - i) run = size - i;
+			*out++ = (Uint8) transindex;
+			*out++ = (Uint8) (run - 1);
+			i += run;
+			continue;
+		}
+		Uint8 p;
+		do {
+			//plenty of shadow pixels
+			p = (Uint8) (Random(4u) ? Random(256u) : 1);
+		} while (p == transindex);
+		*out++ = p;
+		i++;
+	}
+	return rle;
+}
+
+template<typename PixelType>
+static void BlitScalar(SDL_Surface* backBuf, const TestSprite* spr, const TestBAM* data,
+	const TestPalette* palette, const Region* clip, const TestCover* cover,
+	const Uint8* rle, int tx, int ty, bool hflip, bool vflip, Color tint, TestMode mode)
+{
+	Uint32 shadowcol32 = 0, mask32;
+	Uint16 shadowcol16 = 0, mask16;
+
+	if (mode == TEST_TRANSSHADOW) {
+		shadowcol32 = SDL_MapRGBA(backBuf->format, palette->col[1].r/2,
+									palette->col[1].g/2, palette->col[1].b/2, 0);
+		shadowcol16 = (Uint16)shadowcol32;
+	}
+
+	mask32 = (backBuf->format->Rmask >> 1) & backBuf->format->Rmask;
+	mask32 |= (backBuf->format->Gmask >> 1) & backBuf->format->Gmask;
+	mask32 |= (backBuf->format->Bmask >> 1) & backBuf->format->Bmask;
+	mask16 = (Uint16)mask32;
+
+#define FLIP
+#define HFLIP_CONDITIONAL hflip
+#define VFLIP_CONDITIONAL vflip
+#define RLE data->RLE
+#define PAL palette
+#define COVERX (cover->XPos - spr->XPos)
+#define COVERY (cover->YPos - spr->YPos)
+#define USE_PALETTE
+#define SRCDATA rle
+
+	if (mode == TEST_TINTED) {
+
+#define COVER
+#define SPECIALPIXEL
+#define TINT
+
+		if (sizeof(PixelType) == 4) {
+#undef BPP16
+#include "SDLVideoDriver.inl"
+		} else {
+#define BPP16
+#include "SDLVideoDriver.inl"
+		}
+
+#undef COVER
+#undef TINT
+#undef SPECIALPIXEL
+
+	} else if (mode == TEST_TRANSSHADOW) {
+
+#define COVER
+#define TINT
+
+		if (sizeof(PixelType) == 4) {
+#undef BPP16
+#define SPECIALPIXEL if (p == 1) { *pix = ((*pix >> 1)&mask32) + shadowcol32; } else
+#include "SDLVideoDriver.inl"
+#undef SPECIALPIXEL
+		} else {
+#define BPP16
+#define SPECIALPIXEL if (p == 1) { *pix = ((*pix >> 1)&mask16) + shadowcol16; } else
+#include "SDLVideoDriver.inl"
+#undef SPECIALPIXEL
+		}
+
+#undef COVER
+#undef TINT
+
+	} else if (!cover) {
+
+#define HALFALPHA
+#define SPECIALPIXEL
+
+		if (sizeof(PixelType) == 4) {
+#undef BPP16
+#include "SDLVideoDriver.inl"
+		} else {
+#define BPP16
+#include "SDLVideoDriver.inl"
+		}
+
+#undef HALFALPHA
+#undef SPECIALPIXEL
+
+	} else {
+
+#define HALFALPHA
+#define COVER
+#define SPECIALPIXEL
+
+		if (sizeof(PixelType) == 4) {
+#undef BPP16
+#include "SDLVideoDriver.inl"
+		} else {
+#define BPP16
+#include "SDLVideoDriver.inl"
+		}
+
+#undef HALFALPHA
+#undef COVER
+#undef SPECIALPIXEL
+
+	}
+
+#undef FLIP
+#undef HFLIP_CONDITIONAL
+#undef VFLIP_CONDITIONAL
+#undef RLE
+#undef PAL
+#undef COVERX
+#undef COVERY
+#undef USE_PALETTE
+#undef SRCDATA
+#undef BPP16
+}
+
+template<typename PixelType>
+static void BlitSSE2(SDL_Surface* backBuf, const TestSprite* spr, const TestBAM* data,
+	const TestPalette* palette, const Region* clip, const TestCover* cover,
+	const Uint8* rle, int tx, int ty, bool hflip, bool vflip, Color tint, TestMode mode)
+{
+	SpriteBlit s;
+	s.rle = rle;
+	s.width = spr->Width;
+	s.height = spr->Height;
+	s.transindex = data->transindex;
+	s.col = palette->col;
+	s.tx = tx;
+	s.ty = ty;
+	s.hflip = hflip;
+	s.vflip = vflip;
+	SpriteClip(backBuf, clip, s);
+	s.cover = cover ? cover->pixels : NULL;
+	s.coverw = cover ? cover->Width : 0;
+	s.coverx = cover ? cover->XPos - spr->XPos : 0;
+	s.covery = cover ? cover->YPos - spr->YPos : 0;
+	s.tint = tint;
+	s.mode = ModeFlags[mode];
+	s.shadowcol = 0;
+	if (mode == TEST_TRANSSHADOW) {
+		s.shadowcol = SDL_MapRGBA(backBuf->format, palette->col[1].r/2,
+			palette->col[1].g/2, palette->col[1].b/2, 0);
+	}
+	s.halfmask = (backBuf->format->Rmask >> 1) & backBuf->format->Rmask;
+	s.halfmask |= (backBuf->format->Gmask >> 1) & backBuf->format->Gmask;
+	s.halfmask |= (backBuf->format->Bmask >> 1) & backBuf->format->Bmask;
+	if (sizeof(PixelType) == 2) {
+		s.shadowcol = (Uint16) s.shadowcol;
+		s.halfmask = (Uint16) s.halfmask;
+	}
+	BlitSpriteRLE_sse2<PixelType>(backBuf, s);
+}
+
+static int Compare(const SDL_Surface* a, const SDL_Surface* b, const char* what, int iteration)
+{
+	for (int y = 0; y < a->h; y++) {
+		const Uint8* la = (const Uint8*) a->pixels + y*a->pitch;
+		const Uint8* lb = (const Uint8*) b->pixels + y*b->pitch;
+		int bpp = a->format->BytesPerPixel;
+		for (int x = 0; x < a->w; x++) {
+			if (memcmp(la + x*bpp, lb + x*bpp, bpp)) {
+				printf("%s, %dbpp, iteration %d: pixel %d,%d differs\n",
+					what, a->format->BitsPerPixel, iteration, x, y);
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+template<typename PixelType>
+static int TestSprites(SDL_Surface* scalar, SDL_Surface* sse2, int iteration)
+{
+	TestSprite spr;
+	spr.Width = Random(1, 100);
+	spr.Height = Random(1, 100);
+	spr.XPos = Random(-10, 10);
+	spr.YPos = Random(-10, 10);
+
+	TestBAM data;
+	data.RLE = true;
+	data.transindex = Random(3u) ? 0 : Random(0, 255);
+
+	TestPalette palette;
+	for (int i = 0; i < 256; i++) {
+		palette.col[i].r = (unsigned char) Random(256u);
+		palette.col[i].g = (unsigned char) Random(256u);
+		palette.col[i].b = (unsigned char) Random(256u);
+		palette.col[i].a = 255;
+	}
+
+	Uint8* rle = RandomSprite(spr, data.transindex);
+
+	TestMode mode = (TestMode) Random((unsigned int) TEST_MODES);
+
+	//like SpriteCover::Covers, the cover spans the whole sprite
+	TestCover cover;
+	TestCover* pcover = NULL;
+	if (mode != TEST_HALFTRANS || Random(2u)) {
+		cover.XPos = spr.XPos + Random(0, 5);
+		cover.YPos = spr.YPos + Random(0, 5);
+		cover.Width = spr.Width + (cover.XPos - spr.XPos) + Random(0, 5);
+		cover.Height = spr.Height + (cover.YPos - spr.YPos) + Random(0, 5);
+		cover.pixels = (Uint8*) malloc(cover.Width*cover.Height);
+		//covered blocks, since walls cover areas
+		int blocks = Random(0, 4);
+		memset(cover.pixels, 0, cover.Width*cover.Height);
+		while (blocks--) {
+			int x0 = Random(0, cover.Width - 1), y0 = Random(0, cover.Height - 1);
+			int x1 = Random(x0, cover.Width - 1), y1 = Random(y0, cover.Height - 1);
+			for (int y = y0; y <= y1; y++) {
+				memset(cover.pixels + y*cover.Width + x0, 1, x1 - x0 + 1);
+			}
+		}
+		pcover = &cover;
+	}
+
+	Color tint;
+	tint.r = (unsigned char) Random(256u);
+	tint.g = (unsigned char) Random(256u);
+	tint.b = (unsigned char) Random(256u);
+	tint.a = 255;
+
+	bool hflip = Random(2u) != 0;
+	bool vflip = Random(2u) != 0;
+	//the early returns of BlitGameSprite
+	int tx = Random(1 - spr.Width, scalar->w);
+	int ty = Random(-spr.Height, scalar->h);
+
+	Region clip;
+	Region* pclip = NULL;
+	if (Random(2u)) {
+		clip.x = Random(-10, scalar->w);
+		clip.y = Random(-10, scalar->h);
+		clip.w = Random(-5, scalar->w);
+		clip.h = Random(-5, scalar->h);
+		pclip = &clip;
+	}
+
+	RandomClipRect(scalar);
+	sse2->clip_rect = scalar->clip_rect;
+	FillRandom(scalar);
+	memcpy(sse2->pixels, scalar->pixels, scalar->pitch*scalar->h);
+
+	BlitScalar<PixelType>(scalar, &spr, &data, &palette, pclip, pcover, rle, tx, ty, hflip, vflip, tint, mode);
+	BlitSSE2<PixelType>(sse2, &spr, &data, &palette, pclip, pcover, rle, tx, ty, hflip, vflip, tint, mode);
+
+	int failed = Compare(scalar, sse2, ModeNames[mode], iteration);
+	if (failed) {
+		printf("  sprite %dx%d at %d,%d, flip %d/%d, cover %s, clip %s\n",
+			spr.Width, spr.Height, tx, ty, hflip, vflip,
+			pcover ? "yes" : "no", pclip ? "yes" : "no");
+	}
+
+	if (pcover) {
+		free(cover.pixels);
+	}
+	free(rle);
+	return failed;
+}
+
+template<typename PixelType>
+static int TestTiles(SDL_Surface* scalar, SDL_Surface* sse2, SDL_Surface* tile, int iteration)
+{
+	FillRandom(tile);
+
+	Uint8 key = (Uint8) Random(256u);
+	Uint8 mask[64*64];
+	for (int i = 0; i < 64*64; i++) {
+		mask[i] = Random(2u) ? key : (Uint8) Random(256u);
+	}
+	const Uint8* pmask = Random(2u) ? mask : NULL;
+	bool trans = Random(2u) != 0;
+	//BlitTile copies opaque tiles without a mask
+	if (!trans && !pmask) {
+		pmask = mask;
+	}
+
+	int rx = Random(0, 63);
+	int ry = Random(0, 63);
+	int w = Random(1, 64 - rx);
+	int h = Random(1, 64 - ry);
+	int tx = Random(0, scalar->w - 64);
+	int ty = Random(0, scalar->h - 64);
+
+	FillRandom(scalar);
+	memcpy(sse2->pixels, scalar->pixels, scalar->pitch*scalar->h);
+
+	Uint32 halfmask = 0;
+	if (trans) {
+		TRBlender_HalfTrans B(scalar->format);
+		halfmask = B.mask;
+		BlitTile_cached<PixelType>(scalar, tx, ty, rx, ry, w, h, tile, pmask, key, B);
+	} else {
+		TRBlender_Opaque B(scalar->format);
+		BlitTile_cached<PixelType>(scalar, tx, ty, rx, ry, w, h, tile, pmask, key, B);
+	}
+	BlitTile_sse2<PixelType>(sse2, tx, ty, rx, ry, w, h, tile, pmask, key, halfmask);
+
+	return Compare(scalar, sse2, trans ? "halftrans tile" : "masked tile", iteration);
+}
+
+template<typename PixelType>
+static int TestFormat(int bpp, Uint32 rmask, Uint32 gmask, Uint32 bmask, int iterations)
+{
+	SDL_Surface* scalar = SDL_CreateRGBSurface(SDL_SWSURFACE, 160, 120, bpp, rmask, gmask, bmask, 0);
+	SDL_Surface* sse2 = SDL_CreateRGBSurface(SDL_SWSURFACE, 160, 120, bpp, rmask, gmask, bmask, 0);
+	SDL_Surface* tile = SDL_CreateRGBSurface(SDL_SWSURFACE, 64, 64, bpp, rmask, gmask, bmask, 0);
+	assert(scalar && sse2 && tile);
+
+	int failed = 0;
+	for (int i = 0; i < iterations; i++) {
+		failed += TestSprites<PixelType>(scalar, sse2, i);
+		failed += TestTiles<PixelType>(scalar, sse2, tile, i);
+	}
+
+	SDL_FreeSurface(scalar);
+	SDL_FreeSurface(sse2);
+	SDL_FreeSurface(tile);
+	return failed;
+}
+
+int main(int argc, char** argv)
+{
+	int iterations = argc > 1 ? atoi(argv[1]) : 10000;
+	seed = argc > 2 ? (unsigned int) strtoul(argv[2], NULL, 0) : 1;
+
+	if (!TileSSE2) {
+		printf("The cpu has no SSE2, nothing to test.\n");
+		return 0;
+	}
+
+	int failed = 0;
+	failed += TestFormat<Uint32>(32, 0xff0000, 0xff00, 0xff, iterations);
+	failed += TestFormat<Uint16>(16, 0xf800, 0x7e0, 0x1f, iterations);
+	failed += TestFormat<Uint16>(16, 0x7c00, 0x3e0, 0x1f, iterations);
+
+	printf("%d of %d blits differ.\n", failed, 3*2*iterations);
+	return failed ? 1 : 0;
+}
+
+#else
+
+int main(int, char**)
+{
+	printf("Built without SSE2 support, nothing to test.\n");
+	return 0;
+}
+
+#endif
@@ -0,0 +1,315 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2010 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+// SSE2 versions of the most used RLE sprite blits of BlitGameSprite:
+// covered and tinted (with or without the translucent shadow) and half
+// transparent. Every row is decoded and looked up in the palette into
+// small buffers first, then the tint, the blending and the cover test are
+// done 8 pixels at a time. The output is the same as SDLVideoDriver.inl's;
+// SDLVideoSelfTest.cpp compares the two.
+// Needs TileRendererSSE2.inl (and Color, Region) included before.
+
+#ifdef TILE_SSE2
+
+#define SPRITE_SSE2_TINT      1 //tinted
+#define SPRITE_SSE2_SHADOW    2 //palette entry 1 is a translucent shadow
+#define SPRITE_SSE2_HALFTRANS 4 //50% transparent, untinted
+
+struct SpriteBlit {
+	const Uint8* rle;
+	int width, height;
+	int transindex;
+	const Color* col;
+	//the top left corner of the sprite on the target
+	int tx, ty;
+	bool hflip, vflip;
+	//already clipped to the clip rect of the target
+	int clipx, clipy, clipw, cliph;
+	//the cover spans the whole sprite (see SpriteCover::Covers), NULL if none
+	const Uint8* cover;
+	int coverw, coverx, covery;
+	Color tint;
+	Uint32 shadowcol;
+	//the half transparency mask, see BlitGameSprite
+	Uint32 halfmask;
+	unsigned int mode;
+};
+
+//the clipping of SDLVideoDriver.inl
+static void SpriteClip(SDL_Surface* target, const Region* clip, SpriteBlit& s)
+{
+	if (clip) {
+		s.clipx = clip->x;
+		s.clipy = clip->y;
+		s.clipw = clip->w;
+		s.cliph = clip->h;
+	} else {
+		s.clipx = 0;
+		s.clipy = 0;
+		s.clipw = target->w;
+		s.cliph = target->h;
+	}
+	SDL_Rect cliprect;
+	SDL_GetClipRect(target, &cliprect);
+	if (cliprect.x > s.clipx) {
+		s.clipw -= (cliprect.x - s.clipx);
+		s.clipx = cliprect.x;
+	}
+	if (cliprect.y > s.clipy) {
+		s.cliph -= (cliprect.y - s.clipy);
+		s.clipy = cliprect.y;
+	}
+	if (s.clipx+s.clipw > cliprect.x+cliprect.w) {
+		s.clipw = cliprect.x+cliprect.w-s.clipx;
+	}
+	if (s.clipy+s.cliph > cliprect.y+cliprect.h) {
+		s.cliph = cliprect.y+cliprect.h-s.clipy;
+	}
+}
+
+//the decoded pixels of a row: what to draw, and the palette colours
+struct SpriteRow {
+	Uint8* kind; //0 nothing, 1 colour, 2 shadow
+	Uint16* r;
+	Uint16* g;
+	Uint16* b;
+	int size;
+};
+
+static SpriteRow SpriteRowBuffer = { NULL, NULL, NULL, NULL, 0 };
+
+//only the main thread draws, so the buffers are shared
+static void SpriteRowReserve(int n)
+{
+	if (n <= SpriteRowBuffer.size)
+		return;
+	free(SpriteRowBuffer.kind);
+	free(SpriteRowBuffer.r);
+	SpriteRowBuffer.kind = (Uint8*) malloc(n);
+	SpriteRowBuffer.r = (Uint16*) malloc(3*n*sizeof(Uint16));
+	SpriteRowBuffer.g = SpriteRowBuffer.r + n;
+	SpriteRowBuffer.b = SpriteRowBuffer.g + n;
+	SpriteRowBuffer.size = n;
+}
+
+//the same formulas as the BLENDPIXEL variants of SDLVideoDriver.inl
+template<typename PixelType>
+static inline PixelType SpritePixel(const SpriteBlit& s, const SDL_PixelFormat* f,
+	Uint8 kind, Uint16 r, Uint16 g, Uint16 b, PixelType v)
+{
+	if (kind == 2) {
+		return (PixelType) (((v >> 1)&s.halfmask) + s.shadowcol);
+	}
+	if (s.mode & SPRITE_SSE2_HALFTRANS) {
+		PixelType p = (PixelType) ((r >> f->Rloss) << f->Rshift
+			| (g >> f->Gloss) << f->Gshift
+			| (b >> f->Bloss) << f->Bshift);
+		return (PixelType) (((v >> 1)&s.halfmask) + ((p >> 1)&s.halfmask));
+	}
+	return (PixelType) (((s.tint.r*r) >> (f->Rloss+8)) << f->Rshift
+		| ((s.tint.g*g) >> (f->Gloss+8)) << f->Gshift
+		| ((s.tint.b*b) >> (f->Bloss+8)) << f->Bshift);
+}
+
+//one colour channel of 8 pixels, shifted to its place (in 16 bit lanes)
+SSE2_TARGET static inline __m128i SpriteChannel_sse2(const Uint16* c, __m128i tint, int loss)
+{
+	__m128i v = _mm_mullo_epi16(_mm_loadu_si128((const __m128i*) c), tint);
+	return _mm_srl_epi16(v, _mm_cvtsi32_si128(loss + 8));
+}
+
+SSE2_TARGET static inline __m128i Select_sse2(__m128i sel, __m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_and_si128(sel, a), _mm_andnot_si128(sel, b));
+}
+
+//8 decoded pixels at pix, kind and draw are 8 bytes in the low half
+template<typename PixelType>
+SSE2_TARGET static inline void SpriteBlend_sse2(PixelType* pix, const SpriteBlit& s,
+	const SDL_PixelFormat* f, const SpriteRow& row, int i, __m128i draw, __m128i shadow,
+	__m128i tr, __m128i tg, __m128i tb)
+{
+	__m128i r = SpriteChannel_sse2(row.r + i, tr, f->Rloss);
+	__m128i g = SpriteChannel_sse2(row.g + i, tg, f->Gloss);
+	__m128i b = SpriteChannel_sse2(row.b + i, tb, f->Bloss);
+	__m128i rs = _mm_cvtsi32_si128(f->Rshift);
+	__m128i gs = _mm_cvtsi32_si128(f->Gshift);
+	__m128i bs = _mm_cvtsi32_si128(f->Bshift);
+	bool half = (s.mode & SPRITE_SSE2_HALFTRANS) != 0;
+
+	if (sizeof(PixelType) == 2) {
+		__m128i vhalf = _mm_set1_epi16((short) s.halfmask);
+		__m128i p = _mm_or_si128(_mm_sll_epi16(r, rs),
+			_mm_or_si128(_mm_sll_epi16(g, gs), _mm_sll_epi16(b, bs)));
+		__m128i v = _mm_loadu_si128((const __m128i*) pix);
+		if (half) {
+			p = HalfTrans_sse2<Uint16>(p, v, vhalf);
+		}
+		if (s.mode & SPRITE_SSE2_SHADOW) {
+			__m128i sh = _mm_add_epi16(_mm_and_si128(_mm_srli_epi16(v, 1), vhalf),
+				_mm_set1_epi16((short) s.shadowcol));
+			p = Select_sse2(_mm_unpacklo_epi8(shadow, shadow), sh, p);
+		}
+		p = Select_sse2(_mm_unpacklo_epi8(draw, draw), p, v);
+		_mm_storeu_si128((__m128i*) pix, p);
+		return;
+	}
+
+	__m128i zero = _mm_setzero_si128();
+	__m128i vhalf = _mm_set1_epi32(s.halfmask);
+	__m128i vshadow = _mm_set1_epi32(s.shadowcol);
+	draw = _mm_unpacklo_epi8(draw, draw);
+	shadow = _mm_unpacklo_epi8(shadow, shadow);
+	for (int h = 0; h < 2; h++) {
+		__m128i p, d, sd;
+		if (h) {
+			p = _mm_or_si128(_mm_sll_epi32(_mm_unpackhi_epi16(r, zero), rs),
+				_mm_or_si128(_mm_sll_epi32(_mm_unpackhi_epi16(g, zero), gs),
+				_mm_sll_epi32(_mm_unpackhi_epi16(b, zero), bs)));
+			d = _mm_unpackhi_epi16(draw, draw);
+			sd = _mm_unpackhi_epi16(shadow, shadow);
+		} else {
+			p = _mm_or_si128(_mm_sll_epi32(_mm_unpacklo_epi16(r, zero), rs),
+				_mm_or_si128(_mm_sll_epi32(_mm_unpacklo_epi16(g, zero), gs),
+				_mm_sll_epi32(_mm_unpacklo_epi16(b, zero), bs)));
+			d = _mm_unpacklo_epi16(draw, draw);
+			sd = _mm_unpacklo_epi16(shadow, shadow);
+		}
+		PixelType* dst = pix + 4*h;
+		__m128i v = _mm_loadu_si128((const __m128i*) dst);
+		if (half) {
+			p = HalfTrans_sse2<Uint32>(p, v, vhalf);
+		}
+		if (s.mode & SPRITE_SSE2_SHADOW) {
+			__m128i sh = _mm_add_epi32(_mm_and_si128(_mm_srli_epi32(v, 1), vhalf), vshadow);
+			p = Select_sse2(sd, sh, p);
+		}
+		_mm_storeu_si128((__m128i*) dst, Select_sse2(d, p, v));
+	}
+}
+
+//walks the RLE data like SDLVideoDriver.inl (transparent runs may go on
+//in the next row), so flipping only changes where the pixels are stored
+template<typename PixelType>
+SSE2_TARGET static void BlitSpriteRLE_sse2(SDL_Surface* target, const SpriteBlit& s)
+{
+	const int xneg = s.hflip ? -1 : 0;
+	const int yneg = s.vflip ? -1 : 0;
+#define XNEG(x) (((x)+xneg)^xneg)
+#define YNEG(y) (((y)+yneg)^yneg)
+
+	//the visible columns
+	int sx0 = s.tx > s.clipx ? s.tx : s.clipx;
+	int sx1 = s.tx + s.width < s.clipx + s.clipw ? s.tx + s.width : s.clipx + s.clipw;
+	int n = sx1 - sx0;
+	if (n <= 0) {
+		return;
+	}
+	SpriteRowReserve(n);
+	const SpriteRow& row = SpriteRowBuffer;
+	const SDL_PixelFormat* f = target->format;
+	const int pitch = target->pitch / sizeof(PixelType);
+	const bool shadowmode = (s.mode & SPRITE_SSE2_SHADOW) != 0;
+
+	//the untinted half transparent sprites are multiplied by 256
+	Uint16 tintr = 256, tintg = 256, tintb = 256;
+	if (s.mode & SPRITE_SSE2_TINT) {
+		tintr = s.tint.r;
+		tintg = s.tint.g;
+		tintb = s.tint.b;
+	}
+	__m128i tr = _mm_set1_epi16((short) tintr);
+	__m128i tg = _mm_set1_epi16((short) tintg);
+	__m128i tb = _mm_set1_epi16((short) tintb);
+	__m128i zero = _mm_setzero_si128();
+	__m128i two = _mm_set1_epi8(2);
+	__m128i ones = _mm_cmpeq_epi8(zero, zero);
+
+	int y = s.ty - yneg*(s.height-1);
+	int endy = y + YNEG(s.height);
+	if (yneg) {
+		if (endy < s.clipy)
+			endy = s.clipy - 1;
+	} else {
+		if (endy > s.clipy + s.cliph)
+			endy = s.clipy + s.cliph;
+	}
+
+	const Uint8* src = s.rle;
+	int translength = 0;
+	for (; YNEG(endy - y) > 0; y += YNEG(1)) {
+		bool visible = yneg ? y < s.clipy + s.cliph : y >= s.clipy;
+		int x = s.tx + translength - xneg*(s.width-1);
+		int endx = s.tx - xneg*(s.width-1) + XNEG(s.width);
+		if (visible) {
+			memset(row.kind, 0, n);
+		}
+		while (XNEG(endx - x) > 0) {
+			Uint8 p = *src++;
+			if (p == (Uint8) s.transindex) {
+				x += XNEG((*src++) + 1);
+				continue;
+			}
+			if (visible && x >= sx0 && x < sx1) {
+				int i = x - sx0;
+				row.kind[i] = (shadowmode && p == 1) ? 2 : 1;
+				row.r[i] = s.col[p].r;
+				row.g[i] = s.col[p].g;
+				row.b[i] = s.col[p].b;
+			}
+			x += XNEG(1);
+		}
+		translength = x - endx;
+		if (!visible) {
+			continue;
+		}
+
+		PixelType* pix = (PixelType*) target->pixels + y*pitch + sx0;
+		const Uint8* cov = 0;
+		if (s.cover) {
+			cov = s.cover + (s.covery + y - s.ty)*s.coverw + s.coverx + (sx0 - s.tx);
+		}
+		int i = 0;
+		for (; i + 8 <= n; i += 8) {
+			__m128i kind = _mm_loadl_epi64((const __m128i*) (row.kind + i));
+			__m128i draw = _mm_cmpeq_epi8(kind, zero);
+			if (cov) {
+				__m128i c = _mm_loadl_epi64((const __m128i*) (cov + i));
+				draw = _mm_andnot_si128(draw, _mm_cmpeq_epi8(c, zero));
+			} else {
+				draw = _mm_andnot_si128(draw, ones);
+			}
+			//only the low 8 bytes are pixels
+			if (!(_mm_movemask_epi8(draw) & 0xff))
+				continue;
+			__m128i shadow = _mm_cmpeq_epi8(kind, two);
+			SpriteBlend_sse2<PixelType>(pix + i, s, f, row, i, draw, shadow, tr, tg, tb);
+		}
+		for (; i < n; i++) {
+			if (!row.kind[i] || (cov && cov[i]))
+				continue;
+			pix[i] = SpritePixel<PixelType>(s, f, row.kind[i], row.r[i], row.g[i], row.b[i], pix[i]);
+		}
+	}
+#undef XNEG
+#undef YNEG
+}
+
+#endif
@@ -120,3 +120,68 @@ static void BlitTile_internal(SDL_Surface* target,
 	}
 }
 
+//the tile is already in the format of the target, so only the
+//blending (or the mask) has to be done per pixel
+template<typename PixelType, class Blender>
+static void BlitTile_cached(SDL_Surface* target,
+			int tx, int ty,
+			int rx, int ry,
+			int w, int h,
+			const SDL_Surface* tile,
+			const Uint8* mask, Uint8 mask_key,
+			Blender& blend, PixelType /*dummy*/=0)
+{
+	PixelType* buf_line = (PixelType*)(target->pixels) + (ty+ry)*(target->pitch / sizeof(PixelType));
+	const PixelType* data_line = (const PixelType*)(tile->pixels) + ry*(tile->pitch / sizeof(PixelType));
+
+	if (mask) {
+		const Uint8* mask_line = mask + ry*64;
+		for (int y = 0; y < h; ++y) {
+			PixelType* buf = buf_line + tx + rx;
+			const PixelType* data = data_line + rx;
+			mask = mask_line + rx;
+			for (int x = 0; x < w; ++x) {
+				PixelType p = *data++;
+				Uint8 m = *mask++;
+				if (m == mask_key)
+					*buf = (PixelType)blend(p,*buf);
+				buf++;
+			}
+			buf_line += target->pitch / sizeof(PixelType);
+			mask_line += 64;
+			data_line += tile->pitch / sizeof(PixelType);
+		}
+
+	} else {
+
+		for (int y = 0; y < h; ++y) {
+			PixelType* buf = buf_line + tx + rx;
+			const PixelType* data = data_line + rx;
+			for (int x = 0; x < w; ++x) {
+				*buf = (PixelType)blend(*data++,*buf);
+				buf++;
+			}
+			buf_line += target->pitch / sizeof(PixelType);
+			data_line += tile->pitch / sizeof(PixelType);
+		}
+
+	}
+}
+
+//opaque tile without a mask: just copy the rows
+static void BlitTile_copy(SDL_Surface* target,
+			int tx, int ty,
+			int rx, int ry,
+			int w, int h,
+			const SDL_Surface* tile)
+{
+	int bpp = target->format->BytesPerPixel;
+	Uint8* buf_line = (Uint8*)(target->pixels) + (ty+ry)*target->pitch + (tx+rx)*bpp;
+	const Uint8* data_line = (const Uint8*)(tile->pixels) + ry*tile->pitch + rx*bpp;
+
+	for (int y = 0; y < h; ++y) {
+		memcpy(buf_line, data_line, w*bpp);
+		buf_line += target->pitch;
+		data_line += tile->pitch;
+	}
+}
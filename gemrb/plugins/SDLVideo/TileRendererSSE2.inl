@@ -0,0 +1,136 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2010 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+// SSE2 versions of BlitTile_cached, for x86 compilers with intrinsics.
+// They are only used if the cpu has SSE2 (checked once at startup), and
+// produce exactly the same pixels as the templates in TileRenderer.inl.
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define TILE_SSE2 1
+#include <cpuid.h>
+#include <emmintrin.h>
+//allows building the kernels without -msse2
+#define SSE2_TARGET __attribute__((target("sse2")))
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#define TILE_SSE2 1
+#include <emmintrin.h>
+#include <intrin.h>
+#define SSE2_TARGET
+#endif
+
+#ifdef TILE_SSE2
+
+static bool CPUHasSSE2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	return (info[3] & (1<<26)) != 0;
+#else
+	unsigned int eax, ebx, ecx, edx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return false;
+	return (edx & bit_SSE2) != 0;
+#endif
+}
+
+static const bool TileSSE2 = CPUHasSSE2();
+
+//16 bytes of pixels: 4 in 32 bit mode, 8 in 16 bit mode
+template<typename PixelType>
+SSE2_TARGET static inline __m128i HalfTrans_sse2(__m128i p, __m128i v, __m128i halfmask)
+{
+	if (sizeof(PixelType) == 4) {
+		return _mm_add_epi32(_mm_and_si128(_mm_srli_epi32(p, 1), halfmask),
+			_mm_and_si128(_mm_srli_epi32(v, 1), halfmask));
+	}
+	return _mm_add_epi16(_mm_and_si128(_mm_srli_epi16(p, 1), halfmask),
+		_mm_and_si128(_mm_srli_epi16(v, 1), halfmask));
+}
+
+//all bits set in the pixels where the mask matches the key
+template<typename PixelType>
+SSE2_TARGET static inline __m128i MaskSelect_sse2(const Uint8* mask, __m128i key)
+{
+	__m128i m;
+	if (sizeof(PixelType) == 4) {
+		int bytes;
+		memcpy(&bytes, mask, 4);
+		m = _mm_cmpeq_epi8(_mm_cvtsi32_si128(bytes), key);
+		m = _mm_unpacklo_epi8(m, m);
+		return _mm_unpacklo_epi16(m, m);
+	}
+	m = _mm_cmpeq_epi8(_mm_loadl_epi64((const __m128i*) mask), key);
+	return _mm_unpacklo_epi8(m, m);
+}
+
+//halfmask is the mask of TRBlender_HalfTrans, or 0 for opaque tiles
+template<typename PixelType>
+SSE2_TARGET static void BlitTile_sse2(SDL_Surface* target,
+			int tx, int ty,
+			int rx, int ry,
+			int w, int h,
+			const SDL_Surface* tile,
+			const Uint8* mask, Uint8 mask_key,
+			Uint32 halfmask)
+{
+	const int step = 16 / sizeof(PixelType);
+	PixelType* buf_line = (PixelType*)(target->pixels) + (ty+ry)*(target->pitch / sizeof(PixelType));
+	const PixelType* data_line = (const PixelType*)(tile->pixels) + ry*(tile->pitch / sizeof(PixelType));
+	const Uint8* mask_line = mask ? mask + ry*64 : 0;
+
+	__m128i vhalf = sizeof(PixelType) == 4 ? _mm_set1_epi32(halfmask) : _mm_set1_epi16((short) halfmask);
+	__m128i vkey = _mm_set1_epi8((char) mask_key);
+
+	for (int y = 0; y < h; ++y) {
+		PixelType* buf = buf_line + tx + rx;
+		const PixelType* data = data_line + rx;
+		const Uint8* m = mask_line ? mask_line + rx : 0;
+		int x = 0;
+		for (; x + step <= w; x += step) {
+			__m128i p = _mm_loadu_si128((const __m128i*) (data + x));
+			__m128i v = _mm_loadu_si128((const __m128i*) (buf + x));
+			if (halfmask) {
+				p = HalfTrans_sse2<PixelType>(p, v, vhalf);
+			}
+			if (m) {
+				__m128i sel = MaskSelect_sse2<PixelType>(m + x, vkey);
+				p = _mm_or_si128(_mm_and_si128(sel, p), _mm_andnot_si128(sel, v));
+			}
+			_mm_storeu_si128((__m128i*) (buf + x), p);
+		}
+		//the remaining pixels, like BlitTile_cached
+		for (; x < w; ++x) {
+			if (m && m[x] != mask_key)
+				continue;
+			Uint32 p = data[x];
+			if (halfmask) {
+				p = ((p>>1)&halfmask) + ((buf[x]>>1)&halfmask);
+			}
+			buf[x] = (PixelType) p;
+		}
+		buf_line += target->pitch / sizeof(PixelType);
+		data_line += tile->pitch / sizeof(PixelType);
+		if (mask_line)
+			mask_line += 64;
+	}
+}
+
+#endif